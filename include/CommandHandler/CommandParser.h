@@ -2,9 +2,9 @@
 
 #include "Command.h"
 #include "Message.h"
-#include "Epoll.h"
+#include "ReactorGroup.h"
 
 class CommandParser{
     public:
-        CommandPtr parse(std::string& raw_message, IncomingMessage& incomming, EpollInstancePtr epoll_instance);
+        CommandPtr parse(std::string& raw_message, IncomingMessage& incomming, ReactorGroupPtr reactor_group);
 };
\ No newline at end of file
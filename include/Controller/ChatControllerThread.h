@@ -3,15 +3,16 @@
 #include "MessageQueue.h"
 #include "Message.h"
 #include "MessageThreadHandler.h"
+#include "BaseThreadHandler.h"
 #include "CommandParser.h"
-#include "Epoll.h"
+#include "ReactorGroup.h"
 
 class ChatControllerThread{
     private:
         std::shared_ptr<MessageQueue<Message>> incoming_queue;
         std::shared_ptr<MessageQueue<HandlerResponsePtr>> response_queue;
-        std::unordered_map<CommandType, std::shared_ptr<MessageQueue<HandlerRequestPtr>>> handler_queues;
-        EpollInstancePtr epoll_instance;
+        std::unordered_map<CommandType, BaseThreadHandlerPtr> handlers;
+        ReactorGroupPtr reactor_group;
         std::thread worker_thread;
         std::atomic<bool> running{false};
 
@@ -20,8 +21,8 @@ class ChatControllerThread{
         // void handleDisconnect(const ClientDisconnected& disc);
 
     public:
-        ChatControllerThread(std::shared_ptr<MessageQueue<Message>> incoming_queue, std::shared_ptr<MessageQueue<HandlerResponsePtr>> response_queue, EpollInstancePtr epoll_instance);
-        void registerHandlerQueue(CommandType type, std::shared_ptr<MessageQueue<HandlerRequestPtr>> queue);
+        ChatControllerThread(std::shared_ptr<MessageQueue<Message>> incoming_queue, std::shared_ptr<MessageQueue<HandlerResponsePtr>> response_queue, ReactorGroupPtr reactor_group);
+        void registerHandler(CommandType type, BaseThreadHandlerPtr handler);
         void start();
         void stop();
 };
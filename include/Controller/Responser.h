@@ -3,28 +3,48 @@
 #include "MessageQueue.h"
 #include "MessageThreadHandler.h"
 #include "ThreadPool.h"
-#include "Epoll.h"
+#include "ReactorGroup.h"
 
 class Responser{
     private:
         std::shared_ptr<MessageQueue<HandlerResponsePtr>> response_queue;
-        EpollInstancePtr epoll_instance;
+        ReactorGroupPtr reactor_group;
         std::thread worker_thread;
         std::atomic<bool> running{false};
 
+        // Responses of the current batch, concatenated per connection so each
+        // connection gets one queued write and one EPOLLOUT arm per batch.
+        // Room broadcasts are not staged: every member queues a reference to
+        // one shared payload, after whatever was staged for it before.
+        struct StagedWrite{
+            ConnectionPtr conn;
+            std::string data;
+            size_t responses = 0;
+        };
+        std::unordered_map<Connection*, StagedWrite> staged_writes;
+
         void run();
         void sendBackToClient(HandlerResponsePtr resp);
         void sendToClient(HandlerResponsePtr resp);
         void broadcastToRoom(HandlerResponsePtr resp);
 
-        void sendWithEpoll(ConnectionPtr conn, int fd, const std::string& message);
-        void handleWritable(int fd);
-        bool trySend(int fd, const char* data, size_t len, size_t& sent);
+        void stageWrite(const ConnectionPtr& conn, const std::string& message);
+        void flushStagedWrites();
+        void flushStagedWrite(const ConnectionPtr& conn);
+        void sendWithEpoll(ConnectionPtr conn, int fd, std::string message);
+        void sendShared(const ConnectionPtr& conn, const std::shared_ptr<const std::string>& payload);
+        void armWrite(const ConnectionPtr& conn, int fd);
+        void handleWritable(EventLoop* owner, int fd);
 
     public:
-        Responser(std::shared_ptr<MessageQueue<HandlerResponsePtr>> resp_queue, EpollInstancePtr epoll);
+        Responser(std::shared_ptr<MessageQueue<HandlerResponsePtr>> resp_queue, ReactorGroupPtr reactors);
         void start();
         void stop();
+
+        // Queues message straight onto conn's write queue and arms EPOLLOUT;
+        // callable from any thread. Skips staging, so it is not ordered
+        // against responses of the batch in progress.
+        void deliver(ConnectionPtr conn, std::string message);
 };
 
 using ResponserPtr = std::shared_ptr<Responser>;
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <optional>
+
+struct CachedCredentials{
+    int id;
+    std::string password_hash;
+    std::string last_login;
+};
+
+struct CredentialCacheConfig{
+    size_t capacity = 10000;                    // 0 disables the cache
+    std::chrono::milliseconds negative_ttl{30000};
+};
+
+// Bounded LRU of username -> credentials kept in front of the database.
+// Usernames that do not exist are cached too ("negative" entries), for
+// negative_ttl, so floods of logins for unknown names stay off the DB.
+//
+// A loader takes generation() before reading the DB and passes it to
+// store(); if the user was invalidated in between, the stale row is not
+// cached.
+class CredentialCache{
+    public:
+        enum class Lookup{
+            MISS,
+            FOUND,
+            NOT_FOUND
+        };
+
+    private:
+        struct Entry{
+            std::string username;
+            std::optional<CachedCredentials> credentials;   // nullopt: no such user
+            std::chrono::steady_clock::time_point expires;  // negative entries only
+        };
+
+        std::list<Entry> lru;   // most recently used first
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        std::mutex mtx;
+        CredentialCacheConfig config;
+        uint64_t generation_counter = 0;
+
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> negative_hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> evictions{0};
+
+    public:
+        explicit CredentialCache(const CredentialCacheConfig& config = CredentialCacheConfig{});
+
+        void configure(const CredentialCacheConfig& config);
+
+        // FOUND fills credentials
+        Lookup lookup(const std::string& username, CachedCredentials& credentials);
+        uint64_t generation();
+        void store(const std::string& username, const std::optional<CachedCredentials>& credentials, uint64_t generation);
+        void invalidate(const std::string& username);
+        void recordLogin(const std::string& username);
+        void clear();
+
+        uint64_t getHitCount() const { return hits.load(std::memory_order_relaxed); }
+        uint64_t getNegativeHitCount() const { return negative_hits.load(std::memory_order_relaxed); }
+        uint64_t getMissCount() const { return misses.load(std::memory_order_relaxed); }
+        uint64_t getEvictionCount() const { return evictions.load(std::memory_order_relaxed); }
+        size_t size();
+};
@@ -6,6 +6,10 @@
 #include <mutex>
 #include <optional>
 #include <vector>
+#include <array>
+#include <chrono>
+#include <strings.h>
+#include "MessageId.h"
 
 struct User{
     int id;
@@ -16,8 +20,8 @@ struct User{
 };
 
 struct PendingMessageRecord{
-    int id;
-    std::string message_id;
+    int64_t id;
+    MessageId message_id;
     int sender_id;
     int receiver_id;
     std::string message_content;
@@ -27,32 +31,156 @@ struct PendingMessageRecord{
     int retry_count;
 };
 
+// What startup recovery found in pending_messages
+struct PendingRecovery{
+    std::optional<MessageId> last_message_id;   // highest id ever stored, deleted rows included
+    size_t undelivered = 0;                     // rows still 'pending' or 'sent'
+    size_t receivers = 0;                       // users they are waiting for
+};
+
+// Size of the database file and what pending_messages holds
+struct StorageStats{
+    int64_t page_size = 0;
+    int64_t page_count = 0;
+    int64_t freelist_count = 0;
+    std::vector<std::pair<std::string, int64_t>> rows_by_status;
+};
+
+// Pragmas applied when the database is opened. What survives a crash:
+//   STRICT    rollback journal, synchronous=FULL. A transaction is on disk
+//             when COMMIT returns and survives power loss; writers block
+//             readers and every commit pays two or more fsyncs.
+//   BALANCED  WAL, synchronous=NORMAL. Survives a process crash with nothing
+//             lost; power loss or an OS crash can drop the last commits
+//             since the previous WAL sync but never corrupts the file.
+//             Readers do not block the writer. The default.
+//   FAST      WAL, synchronous=OFF, temp tables in memory. Survives a
+//             process crash; power loss or an OS crash can lose recent
+//             commits and may corrupt the database. Benchmarks and
+//             throwaway deployments only.
+enum class DurabilityProfile{
+    STRICT,
+    BALANCED,
+    FAST
+};
+
+const char* durabilityProfileName(DurabilityProfile profile);
+std::optional<DurabilityProfile> parseDurabilityProfile(const std::string& name);
+
 class DataBaseManager{
     private:
+        // Statements prepared once and reused; see STATEMENT_SQL
+        enum class Statement{
+            BEGIN,
+            COMMIT,
+            ROLLBACK,
+            REGISTER_USER,
+            USERNAME_EXISTS,
+            UPDATE_LAST_LOGIN,
+            GET_USER,
+            ADD_PENDING_MESSAGE,
+            UPDATE_MESSAGE_STATUS,
+            DELETE_PENDING_MESSAGE,
+            INCREMENT_RETRY_COUNT,
+            GET_PENDING_MESSAGES_FOR_USER,
+            LAST_PENDING_MESSAGE_ROW,
+            LAST_MESSAGE_ID,
+            COUNT_UNDELIVERED_MESSAGES,
+            DELETE_EXPIRED_MESSAGES,
+            COUNT_MESSAGES_BY_STATUS,
+            SAVE_MESSAGE_ID_HIGH_WATER,
+            COUNT
+        };
+
+        // Checks a statement out of the cache and resets it, clearing the
+        // bindings, when it goes out of scope
+        class StatementHandle{
+            private:
+                DataBaseManager* owner;
+                sqlite3_stmt* stmt;
+
+            public:
+                StatementHandle(DataBaseManager* owner, sqlite3_stmt* stmt) : owner(owner), stmt(stmt) {}
+                StatementHandle(const StatementHandle&) = delete;
+                StatementHandle& operator=(const StatementHandle&) = delete;
+                ~StatementHandle();
+
+                sqlite3_stmt* get() const { return stmt; }
+                explicit operator bool() const { return stmt != nullptr; }
+        };
+
         sqlite3* db;
         std::mutex db_mutex;
         std::string db_path;
+        std::array<sqlite3_stmt*, static_cast<size_t>(Statement::COUNT)> statements{};
+        bool cache_statements = true;
+        DurabilityProfile durability = DurabilityProfile::BALANCED;
+        std::string journal_mode;
+        bool incremental_vacuum = false;
         
-        std::string hashPassword(const std::string& password);
+        bool applyDurabilityProfile();
+        bool applyAutoVacuum();
+        int64_t queryPragma(const char* sql);
+        bool applyCachePragmas();
+        bool migratePendingMessageIds();
+        bool saveMessageIdHighWater();
+        StatementHandle statement(Statement which);
+        bool execute(Statement which);
+        void finalizeStatements();
         
     public:
         DataBaseManager(const std::string& db_file);
         ~DataBaseManager();
         
         static DataBaseManager& getInstance();
+        static std::string hashPassword(const std::string& password);
         
+        // Takes effect at initialize()
+        void setDurabilityProfile(DurabilityProfile profile) { durability = profile; }
+        DurabilityProfile getDurabilityProfile() const { return durability; }
+
         bool initialize();
+        // Opens an existing database for reading only, with the cache and
+        // busy settings of the profile; the schema must already exist
+        bool initializeReadOnly();
+        // Readers run alongside the writer only in WAL mode
+        bool usesWal() const { return strcasecmp(journal_mode.c_str(), "wal") == 0; }
+        bool usesIncrementalVacuum() const { return incremental_vacuum; }
         bool registerUser(const std::string& username, const std::string& password);
-        bool verifyLogin(const std::string& username, const std::string& password);
         bool usernameExists(const std::string& username);
         bool updateLastLogin(const std::string& username);
-        std::optional<User> getUser(const std::string& username);
+        // nullopt when there is no such user or the query failed; error, if
+        // given, tells the two apart
+        std::optional<User> getUser(const std::string& username, bool* error = nullptr);
+
+        // Explicit transaction around several of the calls below; only safe
+        // while a single thread owns the connection (the DB thread)
+        bool beginTransaction();
+        bool commitTransaction();
+        void rollbackTransaction();
+
+        // Off: prepare and finalize on every call (for benchmarks)
+        void setStatementCaching(bool enabled);
+
+        bool addPendingMessage(MessageId message_id, int sender_id, int receiver_id, const std::string& message_content);
+        bool updateMessageStatus(MessageId message_id, const std::string& status);
+        bool updateMessageStatus(const std::vector<MessageId>& message_ids, const std::string& status);
+        bool deletePendingMessage(MessageId message_id);
+        bool incrementRetryCount(MessageId message_id);
+        // Up to limit undelivered rows for user_id with after_id < id <= until_id, in id order
+        std::vector<PendingMessageRecord> getPendingMessagesForUser(int user_id, int64_t after_id, int64_t until_id, size_t limit);
+        int64_t getLastPendingMessageRow(int user_id);
+        // Startup, before any message id is handed out; one read transaction
+        bool recoverPendingMessages(PendingRecovery& recovery);
 
-        bool addPendingMessage(const std::string& message_id, int sender_id, int receiver_id, const std::string& message_content);
-        bool updateMessageStatus(const std::string& message_id, const std::string& status);
-        bool deletePendingMessage(const std::string& message_id);
-        bool incrementRetryCount(const std::string& message_id);
-        std::vector<PendingMessageRecord> getPendingMessagesForUser(int user_id); // NEW: Get pending messages for specific user
+        // Retention: deletes up to limit rows in status whose last status
+        // change is older than keep, in one statement. Returns the rows
+        // deleted, or -1.
+        int64_t deleteExpiredMessages(const std::string& status, std::chrono::seconds keep, size_t limit);
+        // Hands up to pages free pages back to the file system; a no-op
+        // unless the file uses incremental auto-vacuum
+        bool incrementalVacuum(size_t pages);
+        bool getStorageStats(StorageStats& stats);
 };
 
 using DatabaseManagerPtr = std::shared_ptr<DataBaseManager>;
\ No newline at end of file
@@ -1,20 +1,30 @@
 #pragma once
 
 #include "DataBaseManager.h"
+#include "CredentialCache.h"
 #include "MessageQueue.h"
 #include <thread>
 #include <atomic>
 #include <functional>
 #include <memory>
+#include <chrono>
+#include <coroutine>
+#include <vector>
 
 enum class DBOperationType{
     REGISTER_USER,
     VERIFY_LOGIN,
     GET_USER,
+    AUTHENTICATE_USER,      // verify + stamp last_login; message is the user id
+    TOUCH_LAST_LOGIN,       // queued by logins; callers need not submit it
     ADD_PENDING_MESSAGE,
     UPDATE_MESSAGE_STATUS,
     DELETE_PENDING_MESSAGE,
-    GET_PENDING_MESSAGES_FOR_USER
+    GET_PENDING_MESSAGES_FOR_USER,
+    RECOVER_PENDING_MESSAGES,   // startup only; fills DBRequest::recovery
+    DELETE_EXPIRED_MESSAGES,    // one retention chunk, see PendingMessageCompactor
+    INCREMENTAL_VACUUM,
+    GET_STORAGE_STATS
 };
 
 struct DBRequest{
@@ -27,31 +37,142 @@ struct DBRequest{
 
     int sender_id;
     int receiver_id;
-    std::string message_id;
+    MessageId message_id = 0;
+    std::vector<MessageId> message_ids;    // UPDATE_MESSAGE_STATUS applies to all of them when set
     std::string message_content;
     std::string status;
     std::vector<PendingMessageRecord> pending_messages;
+
+    // GET_PENDING_MESSAGES_FOR_USER pages through rows after replay_after up
+    // to replay_until; replay_until 0 is resolved to the user's last row
+    int64_t replay_after = 0;
+    int64_t replay_until = 0;
+    size_t replay_limit = 0;
+
+    PendingRecovery recovery;
+
+    // DELETE_EXPIRED_MESSAGES removes up to limit rows in status older than
+    // retention and reports them in affected; INCREMENTAL_VACUUM frees up
+    // to limit pages
+    std::chrono::seconds retention{0};
+    size_t limit = 0;
+    int64_t affected = 0;
+    StorageStats storage;
 };
 
 using DBRequestPtr = std::shared_ptr<DBRequest>;
 
+struct DBResult{
+    bool success = false;
+    std::string message;
+};
+
+class DataBaseThread;
+
+// co_await db_thread->execute(req, timeout) submits req and suspends until
+// its callback fires or the timeout passes. A coroutine suspended on a pool
+// worker is resumed on that pool; anywhere else it resumes on whichever
+// thread finished the wait.
+class DBAwaitable{
+    private:
+        struct State;
+
+        DataBaseThread* db_thread;
+        DBRequestPtr req;
+        std::chrono::milliseconds timeout;
+        std::shared_ptr<State> state;
+
+    public:
+        DBAwaitable(DataBaseThread* db_thread, DBRequestPtr req, std::chrono::milliseconds timeout);
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h);
+        DBResult await_resume();
+};
+
+// Writes to pending_messages are group-committed: consecutive ones share a
+// single transaction, closed when the group reaches max_batch requests, when
+// max_delay has passed since its first request, or when a request of another
+// kind comes next. Their callbacks run after the commit.
+struct GroupCommitConfig{
+    size_t max_batch = 64;                      // 1 = commit every write on its own
+    std::chrono::milliseconds max_delay{2};
+};
+
+// One writer thread owns the read-write connection. In WAL mode a few reader
+// threads, each with its own read-only connection, serve the read operations
+// from a shared queue so lookups and logins do not wait behind writes.
+// Routing is by DBOperationType (see isReadOnly); replay page reads pass
+// through the writer's queue first so they see the pending messages queued
+// before them (see isOrderedRead). A login's last_login stamp is queued to
+// the writer as TOUCH_LAST_LOGIN instead of being written before the reply;
+// a login the writer serves itself adds the stamp to its open group. Logins
+// and user lookups that hit the credential cache are answered on the
+// submitting thread without touching SQLite.
+//
+// Both queues are unbounded, so submitRequest never blocks: callbacks run
+// on the DB threads submit more requests, sometimes while holding locks
+// their callers need.
 class DataBaseThread{
     private:
+        std::string db_file;
         std::shared_ptr<MessageQueue<DBRequestPtr>> request_queue;
+        std::shared_ptr<MessageQueue<DBRequestPtr>> read_queue;
         std::thread worker_thread;
+        std::vector<std::thread> reader_threads;
         std::atomic<bool> running{false};
         DatabaseManagerPtr db_manager;
+        size_t reader_count = 2;
+        bool cache_statements = true;
+        bool readers_enabled = false;
+        GroupCommitConfig group_commit;
+        std::atomic<uint64_t> commit_count{0};
+        std::atomic<uint64_t> grouped_write_count{0};
+        std::atomic<uint64_t> read_count{0};
+        CredentialCache credential_cache;
+
+        // Writer thread only: the open group and when it must be committed
+        std::vector<DBRequestPtr> group;
+        std::chrono::steady_clock::time_point group_deadline;
         
         void run();
-        void processRequest(DBRequestPtr req);
+        void runReader(DatabaseManagerPtr reader);
+        void processRequest(DataBaseManager& db, DBRequestPtr req);
+        DBResult applyRequest(DataBaseManager& db, DBRequest& req);
+        void addToGroup(DBRequestPtr req);
+        void commitGroup();
+        void touchLastLogin(const std::string& username);
+        std::optional<CachedCredentials> loadCredentials(DataBaseManager& db, const std::string& username, bool& error);
+        DBResult answerCredentials(DBRequest& req, const std::optional<CachedCredentials>& credentials);
+        static bool isReadOnly(DBOperationType type);
+        static bool isOrderedRead(DBOperationType type);
+        static bool isCredentialLookup(DBOperationType type);
+        static bool isGroupCommitted(DBOperationType type);
         
     public:
-        DataBaseThread();
+        explicit DataBaseThread(const std::string& db_file = "../DataBase/chat_server.db");
         ~DataBaseThread();
         
+        // Call before start()
+        void setGroupCommit(const GroupCommitConfig& config) { group_commit = config; }
+        void setDurabilityProfile(DurabilityProfile profile) { db_manager->setDurabilityProfile(profile); }
+        // 0 serves reads on the writer thread too
+        void setReaderCount(size_t count) { reader_count = count; }
+        void setCredentialCache(const CredentialCacheConfig& config) { credential_cache.configure(config); }
+        // Off: every connection prepares and finalizes per call (for benchmarks)
+        void setStatementCaching(bool enabled) { cache_statements = enabled; }
+
         void start();
         void stop();
         void submitRequest(DBRequestPtr req);
+        // A non-positive timeout waits for the callback however long it takes
+        DBAwaitable execute(DBRequestPtr req, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+        std::string getBatchHistogram() const { return request_queue->formatBatchHistogram(); }
+        uint64_t getCommitCount() const { return commit_count.load(std::memory_order_relaxed); }
+        uint64_t getGroupedWriteCount() const { return grouped_write_count.load(std::memory_order_relaxed); }
+        uint64_t getReadCount() const { return read_count.load(std::memory_order_relaxed); }
+        size_t getReaderCount() const { return readers_enabled ? reader_threads.size() : 0; }
+        CredentialCache& getCredentialCache() { return credential_cache; }
 };
 
 using DataBaseThreadPtr = std::shared_ptr<DataBaseThread>;
\ No newline at end of file
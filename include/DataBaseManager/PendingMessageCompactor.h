@@ -0,0 +1,69 @@
+#pragma once
+
+#include "DataBaseThread.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Rows in status are deleted once their last status change is keep old.
+// 'pending' and 'sent' rows are still owed to someone; leave them out.
+struct RetentionRule{
+    std::string status;
+    std::chrono::seconds keep;
+};
+
+struct CompactionConfig{
+    std::vector<RetentionRule> retention{
+        {"acknowledged", std::chrono::hours(1)},
+        {"failed", std::chrono::hours(24 * 7)},
+    };
+    std::chrono::seconds interval{300};
+    size_t chunk_rows = 500;                    // rows per DELETE, each its own transaction
+    size_t vacuum_pages = 256;                  // pages per incremental_vacuum step
+    std::chrono::milliseconds chunk_pause{10};  // between steps, so other writes get the writer
+};
+
+// Keeps pending_messages from growing without bound. Every interval it
+// deletes expired rows per RetentionRule, chunk_rows at a time, each chunk a
+// separate request on the DB writer queue so no single one holds the writer
+// for long, then returns the freed pages with incremental vacuum and logs
+// table size, row counts and pages reclaimed.
+class PendingMessageCompactor{
+    private:
+        DataBaseThreadPtr db_thread;
+        CompactionConfig config;
+        std::thread worker_thread;
+        std::mutex mtx;
+        std::condition_variable wake;
+        bool stop_requested = false;
+        std::atomic<uint64_t> pass_count{0};
+        std::atomic<uint64_t> deleted_rows{0};
+        std::atomic<uint64_t> reclaimed_pages{0};
+
+        void run();
+        bool call(DBRequestPtr req);
+        // False once stop() was called
+        bool pause(std::chrono::milliseconds duration);
+        bool loadStats(StorageStats& stats);
+
+    public:
+        PendingMessageCompactor(DataBaseThreadPtr db_thread, const CompactionConfig& config = CompactionConfig());
+        ~PendingMessageCompactor();
+
+        void start();
+        void stop();
+
+        // One full pass on the calling thread
+        void compact();
+
+        uint64_t getPassCount() const { return pass_count.load(std::memory_order_relaxed); }
+        uint64_t getDeletedRows() const { return deleted_rows.load(std::memory_order_relaxed); }
+        uint64_t getReclaimedPages() const { return reclaimed_pages.load(std::memory_order_relaxed); }
+};
+
+using PendingMessageCompactorPtr = std::shared_ptr<PendingMessageCompactor>;
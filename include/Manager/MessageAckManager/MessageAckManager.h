@@ -9,10 +9,12 @@
 #include <thread>
 #include "Connection.h"
 #include "Responser.h"
-#include "DataBaseThread.h"
+#include "OfflineMessageStore.h"
+#include "MessageId.h"
+#include "TimingWheel.h"
 
 struct PendingMessage{
-    std::string message_id;
+    MessageId message_id;
     HandlerResponsePtr responser;
     ConnectionPtr connection;
     std::chrono::system_clock::time_point send_time;
@@ -21,18 +23,50 @@ struct PendingMessage{
     int sender_id;
     int receiver_id;
     std::string message_content;
+    TimingWheel<MessageId>::Handle timer;   // ACK timeout
+    uint64_t replay = 0;                    // generation of the replay that sent it; 0 if live
     
-    PendingMessage() : retry_count(0), max_retries(3), sender_id(-1), receiver_id(-1) {}
+    PendingMessage() : message_id(0), retry_count(0), max_retries(3), sender_id(-1), receiver_id(-1) {}
+};
+
+// Offline backlog of one user, replayed a page at a time after login. A page
+// is fetched only while fewer than REPLAY_WINDOW replayed messages are
+// unacknowledged, so the backlog moves at the pace the client reads it.
+struct ReplayCursor{
+    ConnectionPtr connection;
+    uint64_t generation = 0;
+    int64_t after_id = 0;       // last store position handed out
+    int64_t until_id = 0;       // last position at login; 0 until the first page
+    size_t in_flight = 0;       // replayed, neither acknowledged nor failed
+    size_t replayed = 0;
+    bool fetching = false;
+    bool exhausted = false;
 };
 
 class MessageAckManager{
     private:
-        std::unordered_map<std::string, PendingMessage> pending_messages;
+        std::unordered_map<MessageId, PendingMessage> pending_messages;
+        std::unordered_map<int, ReplayCursor> replays;     // by receiver user_id
+        uint64_t replay_generation = 0;
         std::mutex pending_mutex;
+        TimingWheel<MessageId> ack_timers;
+        std::vector<MessageId> expired_timers;
+        std::chrono::steady_clock::time_point last_stats_log;
         std::atomic<uint64_t> message_id_counter{0};
-        DataBaseThreadPtr db_thread;
+        OfflineMessageStorePtr offline_store;
+        ResponserPtr response_dispatcher;
+        std::shared_ptr<ThreadPool> executor;
 
         const int ACK_TIMEOUT_MS = 5000; // 5s
+        static constexpr std::chrono::milliseconds DEFAULT_TIMER_RESOLUTION{100};
+        static constexpr size_t TIMER_SLOTS = 512;
+        // Queued writes a connection may hold before resends to it are
+        // deferred to the next timeout instead of piling up behind them
+        static constexpr size_t MAX_RESEND_BACKLOG = 64;
+        // Widest range one batched ACK may name; bounds the time under the lock
+        static constexpr MessageId MAX_ACK_RANGE = 4096;
+        static constexpr size_t REPLAY_WINDOW = 64;
+        static constexpr size_t REPLAY_REFILL = REPLAY_WINDOW / 2;
         
         MessageAckManager();
         ~MessageAckManager();
@@ -40,20 +74,50 @@ class MessageAckManager{
         MessageAckManager(const MessageAckManager&) = delete;
         MessageAckManager& operator=(const MessageAckManager&) = delete;
 
+        // Caller holds pending_mutex
+        void trackPending(PendingMessage& pending);
+        // Caller holds pending_mutex; frees the replay window slot of a
+        // message leaving pending_messages. Returns the user whose replay
+        // should fetch its next page, or -1.
+        int releaseReplaySlot(const PendingMessage& pending);
+
+        void fetchReplayPage(int user_id);
+        void deliverReplayPage(int user_id, uint64_t generation, OfflinePage& page);
+
+        bool isBacklogged(const ConnectionPtr& conn);
+
     public:
         static MessageAckManager& getInstance();
 
-        void setDatabaseThread(DataBaseThreadPtr db_thread);
+        // Where pending messages are persisted and offline backlogs replayed from
+        void setOfflineStore(OfflineMessageStorePtr store);
+        // Resends and offline replays are queued through it
+        void setResponseDispatcher(ResponserPtr dispatcher);
+        // Replay pages are delivered on it rather than on the store thread
+        // that loaded them; without one they are delivered in place
+        void setExecutor(std::shared_ptr<ThreadPool> pool);
+        // How often checkTimeouts() should run and the granularity of ACK
+        // timeouts; only changes while nothing is pending
+        bool setTimerResolution(std::chrono::milliseconds resolution);
+        std::chrono::milliseconds getTimerResolution();
 
-        std::string generateMessageId();
-        void addPendingMessage(const std::string& msg_id, HandlerResponsePtr response, ConnectionPtr conn, int sender_id, int receiver_id, const std::string& message_content);
-        void acknowledgeMessage(const std::string& msg_id);
+        MessageId generateMessageId();
+        void addPendingMessage(MessageId msg_id, HandlerResponsePtr response, ConnectionPtr conn, int sender_id, int receiver_id, const std::string& message_content);
+        void acknowledgeMessage(MessageId msg_id);
+        // Batched ACK: only messages sent on conn are acknowledged, under one
+        // lock and with one DB update. Returns how many were pending.
+        size_t acknowledgeMessages(const std::vector<MessageIdRange>& ranges, const ConnectionPtr& conn);
         void checkTimeouts();
-        void resendMessage(const PendingMessage& msg);
+        void resendMessage(const ConnectionPtr& conn, MessageId msg_id, const std::string& message_content, int retry);
 
         void persistPendingMessage(const PendingMessage& msg);
-        void updateMessageStatusInDB(const std::string& msg_id, const std::string& status);
-        void removeMessageFromDB(const std::string& msg_id);
-        //void loadPendingMessagesFromDB();  // Load on startup
+        void updateMessageStatusInStore(MessageId msg_id, const std::string& status);
+        void updateMessageStatusInStore(std::vector<MessageId> msg_ids, const std::string& status);
+        void removeMessageFromStore(MessageId msg_id);
+        // Startup, before listening: resumes the message id sequence past
+        // every stored id and counts what is waiting for delivery. Blocks
+        // until the store is done. Undelivered messages, 'sent' ones
+        // included, stay in the store; each user's login replays them.
+        bool recoverPendingMessages();
         void sendPendingMessagesToUser(int user_id, int fd, ConnectionPtr conn);
 };
\ No newline at end of file
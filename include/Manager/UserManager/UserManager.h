@@ -1,32 +1,78 @@
 #pragma once
 
-#include <string>
-#include <unordered_map>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <mutex>
 #include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+// Who is logged in on which connection. Lookups by fd, which every message
+// makes several of, read a per-fd slot without taking a lock: isLoggedIn()
+// and getUserId() are a single atomic load, getUsername() copies the name
+// under the slot's sequence counter and only retries while that same fd is
+// logging in or out. Lookups by username take the shared lock of one of
+// USERNAME_SHARDS shards. loginUser() and logoutUser() lock the fd's slot
+// and the username's shard, nothing else.
 class UserManager{
+    public:
+        // Usernames are 3-20 characters at registration
+        static constexpr size_t MAX_USERNAME = 31;
+
     private:
-        std::unordered_map<int, std::string> fd_to_username;
-        std::unordered_map<std::string, int> username_to_fd;
-        std::unordered_map<int, int> fd_to_userid;
-        std::mutex user_mutex;
-        
+        static constexpr size_t USERNAME_WORDS = (MAX_USERNAME + 1) / sizeof(uint64_t);
+        static constexpr size_t SLOTS_PER_CHUNK = 1024;
+        static constexpr size_t SLOT_CHUNKS = 1024;          // fds below 1M
+        static constexpr size_t USERNAME_SHARDS = 16;
+
+        struct FdSlot{
+            std::atomic<uint32_t> sequence{0};              // odd while a writer holds the slot
+            std::atomic<int> user_id{-1};                   // -1: not logged in
+            std::array<std::atomic<uint64_t>, USERNAME_WORDS> name{};  // length byte, then the characters
+        };
+
+        struct alignas(64) UsernameShard{
+            std::shared_mutex mutex;
+            std::unordered_map<std::string, int> fds;
+        };
+
+        // Chunks are allocated on first use and kept until destruction, so
+        // a reader never sees one go away
+        std::array<std::atomic<FdSlot*>, SLOT_CHUNKS> slot_chunks{};
+        std::mutex chunk_mutex;
+        std::array<UsernameShard, USERNAME_SHARDS> username_shards;
+
+        FdSlot* findSlot(int fd) const;
+        FdSlot* slotFor(int fd);
+        UsernameShard& shardFor(const std::string& username);
+
+        static void lockSlot(FdSlot& slot);
+        static void unlockSlot(FdSlot& slot);
+        static std::string decodeName(const std::array<uint64_t, USERNAME_WORDS>& words);
+        static void writeName(FdSlot& slot, const std::string& username);
+
     public:
         UserManager() = default;
-        ~UserManager() = default;
-        
+        ~UserManager();
+
+        UserManager(const UserManager&) = delete;
+        UserManager& operator=(const UserManager&) = delete;
+
         static UserManager& getInstance();
-        
-        void loginUser(int fd, std::string& username, int user_id);
+
+        // Fails if the username is already bound to another connection, or
+        // is longer than MAX_USERNAME
+        bool loginUser(int fd, std::string& username, int user_id);
         void logoutUser(int fd);
-        
+
         std::optional<std::string> getUsername(int fd);
         std::optional<int> getFd(std::string& username);
         std::optional<int> getUserId(int fd);
         bool isLoggedIn(int fd);
         bool isUsernameLoggedIn(std::string& username);
-        
+
         std::vector<std::pair<int, std::string>> getAllLoggedInUsers();
-};
\ No newline at end of file
+};
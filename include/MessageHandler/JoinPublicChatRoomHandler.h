@@ -4,7 +4,7 @@
 
 class JoinPublicChatHandler : public MessageHandler{
     public:
-        std::string handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance = nullptr) override;
+        std::string handleMessage(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group = nullptr) override;
 };
 
 using JoinPublicChatHandlerPtr = std::shared_ptr<JoinPublicChatHandler>;
\ No newline at end of file
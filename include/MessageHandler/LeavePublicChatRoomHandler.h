@@ -4,7 +4,7 @@
 
 class LeavePublicChatHandler : public MessageHandler{
     public:
-        std::string handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance = nullptr) override;
+        std::string handleMessage(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group = nullptr) override;
 };
 
 using LeavePublicChatHandlerPtr = std::shared_ptr<LeavePublicChatHandler>;
\ No newline at end of file
@@ -4,7 +4,7 @@
 
 class ListUsersHandler : public MessageHandler{
     public:
-        std::string handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance) override;
+        std::string handleMessage(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group) override;
 };
 
 using ListUsersHandlerPtr = std::shared_ptr<ListUsersHandler>;
\ No newline at end of file
@@ -3,13 +3,14 @@
 #include "MessageHandler.h"
 #include "DataBaseThread.h"
 
-class LoginChatHandler : public MessageHandler{
+class LoginChatHandler : public AsyncMessageHandler{
     private:
+        static constexpr std::chrono::milliseconds DB_TIMEOUT{5000};
         DataBaseThreadPtr db_thread;
          
     public:
         LoginChatHandler(DataBaseThreadPtr db_thread);
-        std::string handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance = nullptr) override;
+        Task<std::string> handleMessageTask(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group) override;
 };
 
 using LoginChatHandlerPtr = std::shared_ptr<LoginChatHandler>;
\ No newline at end of file
@@ -4,7 +4,7 @@
 
 class LogoutChatHandler : public MessageHandler{
     public:
-        std::string handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance = nullptr) override;
+        std::string handleMessage(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group = nullptr) override;
 };
 
 using LogoutChatHandlerPtr = std::shared_ptr<LogoutChatHandler>;
\ No newline at end of file
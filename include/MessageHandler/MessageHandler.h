@@ -2,12 +2,28 @@
 
 #include <Connection.h>
 #include <Command.h>
-#include <Epoll.h>
+#include <ReactorGroup.h>
+#include <Task.h>
 
 class MessageHandler{
     public:
         virtual ~MessageHandler() = default;
-        virtual std::string handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance = nullptr) = 0;
+        virtual std::string handleMessage(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group = nullptr) = 0;
+
+        // Coroutine entry point used by the executor. Handlers that wait on
+        // other threads override it and co_await instead of blocking; the
+        // default answers inline.
+        virtual Task<std::string> handleMessageTask(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group){
+            co_return handleMessage(conn, command, reactor_group);
+        }
+};
+
+// Base for handlers written as coroutines; the synchronous entry point runs
+// the coroutine and waits for it, so never call it from an executor worker.
+class AsyncMessageHandler : public MessageHandler{
+    public:
+        std::string handleMessage(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group = nullptr) override;
+        Task<std::string> handleMessageTask(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group) override = 0;
 };
 
-using MessageHandlerPtr = std::shared_ptr<MessageHandler>;
\ No newline at end of file
+using MessageHandlerPtr = std::shared_ptr<MessageHandler>;
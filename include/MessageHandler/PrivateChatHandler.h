@@ -4,7 +4,7 @@
 
 class PrivateChatHandler : public MessageHandler{
     public:
-        std::string handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance) override;
+        std::string handleMessage(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group) override;
 };
 
 using PrivateChatHandlerPtr = std::shared_ptr<PrivateChatHandler>;
\ No newline at end of file
@@ -4,7 +4,7 @@
 
 class PublicChatHandler : public MessageHandler{
     public:
-        std::string handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance = nullptr) override;
+        std::string handleMessage(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group = nullptr) override;
 };
 
 using PublicChatHandlerPtr = std::shared_ptr<PublicChatHandler>;
\ No newline at end of file
@@ -3,13 +3,14 @@
 #include "MessageHandler.h"
 #include "DataBaseThread.h"
 
-class RegisterAccountHandler : public MessageHandler{
+class RegisterAccountHandler : public AsyncMessageHandler{
     private:
+        static constexpr std::chrono::milliseconds DB_TIMEOUT{5000};
         DataBaseThreadPtr db_thread;
 
     public:
         RegisterAccountHandler(DataBaseThreadPtr db_thread);
-        std::string handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance = nullptr) override;
+        Task<std::string> handleMessageTask(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group) override;
 };
 
 using RegisterAccountHandlerPtr = std::shared_ptr<RegisterAccountHandler>;
\ No newline at end of file
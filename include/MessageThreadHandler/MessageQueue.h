@@ -6,9 +6,76 @@
 #include <optional>
 #include <memory>
 #include <chrono>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <string>
 
+constexpr size_t DEFAULT_POP_BATCH = 32;
+
+// Queue between two pipeline stages. pop() with a negative timeout waits
+// until an item arrives or the queue is stopped; items pushed before stop()
+// are still handed out, pushes after it are dropped. popBatch() waits the
+// same way for the first item, then takes whatever else is ready, up to max.
 template<typename T>
 class MessageQueue{
+    public:
+        // Batch sizes handed out by popBatch(), bucketed by powers of two:
+        // 1, 2-3, 4-7, ... , 128+
+        static constexpr size_t BATCH_BUCKETS = 8;
+
+    private:
+        std::array<std::atomic<uint64_t>, BATCH_BUCKETS> batch_histogram{};
+
+    protected:
+        void recordBatch(size_t n){
+            if(n == 0) return;
+            size_t bucket = 0;
+            while(bucket + 1 < BATCH_BUCKETS && (n >> (bucket + 1)) != 0){
+                bucket++;
+            }
+            batch_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+        }
+
+    public:
+        virtual ~MessageQueue() = default;
+
+        virtual void push(T item) = 0;
+        // Non-blocking push; false only when a bounded queue is full, in
+        // which case item is left untouched
+        virtual bool offer(T& item) = 0;
+        virtual std::optional<T> pop(int timeout_ms = 10) = 0;
+        virtual size_t popBatch(std::vector<T>& out, size_t max, int timeout_ms = 10) = 0;
+        virtual void stop() = 0;
+        virtual size_t size() = 0;
+        virtual bool isStopped() = 0;
+
+        // e.g. "1:120 2-3:14 4-7:2"; empty buckets are left out
+        std::string formatBatchHistogram() const{
+            std::string result;
+            for(size_t i = 0; i < BATCH_BUCKETS; i++){
+                uint64_t count = batch_histogram[i].load(std::memory_order_relaxed);
+                if(count == 0) continue;
+
+                size_t low = size_t(1) << i;
+                std::string label = std::to_string(low);
+                if(i + 1 == BATCH_BUCKETS){
+                    label += "+";
+                }
+                else if(low > 1){
+                    label += "-" + std::to_string((low << 1) - 1);
+                }
+
+                if(!result.empty()) result += " ";
+                result += label + ":" + std::to_string(count);
+            }
+            return result.empty() ? "-" : result;
+        }
+};
+
+// Unbounded multi-producer/multi-consumer queue behind a mutex
+template<typename T>
+class LockedMessageQueue : public MessageQueue<T>{
     private:
         std::queue<T> queue;
         std::mutex mtx;
@@ -16,7 +83,7 @@ class MessageQueue{
         bool stopped = false;
 
     public:
-        void push(T item){
+        void push(T item) override{
             {
                 std::lock_guard<std::mutex> lock(mtx);
                 if(stopped) return;
@@ -25,31 +92,57 @@ class MessageQueue{
             cv.notify_one();
         }
 
-        std::optional<T> pop(int timeout_ms = 10){
+        bool offer(T& item) override{
+            push(std::move(item));
+            return true;
+        }
+
+        std::optional<T> pop(int timeout_ms = 10) override{
             std::unique_lock<std::mutex> lock(mtx);
-            
+
             if(timeout_ms < 0){
                 cv.wait(lock, [this]{ return stopped || !queue.empty(); });
-            } 
+            }
             else{
                 cv.wait_for(lock, std::chrono::milliseconds(timeout_ms),
                     [this]{ return stopped || !queue.empty(); });
             }
-            
+
             if(stopped && queue.empty()){
                 return std::nullopt;
             }
-            
+
             if(queue.empty()){
                 return std::nullopt;
             }
-            
+
             T item = std::move(queue.front());
             queue.pop();
             return item;
         }
 
-        void stop(){
+        size_t popBatch(std::vector<T>& out, size_t max, int timeout_ms = 10) override{
+            std::unique_lock<std::mutex> lock(mtx);
+
+            if(timeout_ms < 0){
+                cv.wait(lock, [this]{ return stopped || !queue.empty(); });
+            }
+            else{
+                cv.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                    [this]{ return stopped || !queue.empty(); });
+            }
+
+            size_t taken = 0;
+            while(taken < max && !queue.empty()){
+                out.push_back(std::move(queue.front()));
+                queue.pop();
+                taken++;
+            }
+            this->recordBatch(taken);
+            return taken;
+        }
+
+        void stop() override{
             {
                 std::lock_guard<std::mutex> lock(mtx);
                 stopped = true;
@@ -57,12 +150,13 @@ class MessageQueue{
             cv.notify_all();
         }
 
-        size_t size(){
+        size_t size() override{
             std::lock_guard<std::mutex> lock(mtx);
             return queue.size();
         }
-        
-        bool isStopped(){
+
+        bool isStopped() override{
+            std::lock_guard<std::mutex> lock(mtx);
             return stopped;
         }
-};
\ No newline at end of file
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "ParkingMessageQueue.h"
+#include <cstdint>
+#include <new>
+
+// Bounded lock-free ring for many producers and one consumer. Each slot
+// carries a sequence number (Vyukov's bounded queue): producers claim a slot
+// with a CAS on the enqueue position, the consumer owns the dequeue side.
+template<typename T>
+class MpscMessageQueue : public ParkingMessageQueue<T>{
+    private:
+        struct Cell{
+            std::atomic<size_t> sequence;
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+
+        size_t capacity;
+        size_t mask;
+        std::unique_ptr<Cell[]> cells;
+        alignas(64) std::atomic<size_t> enqueue_pos{0};
+        alignas(64) std::atomic<size_t> dequeue_pos{0};
+
+        static size_t roundUp(size_t n){
+            size_t cap = 2;
+            while(cap < n) cap <<= 1;
+            return cap;
+        }
+
+    protected:
+        bool tryPush(T& item) override{
+            size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+            while(true){
+                Cell& cell = cells[pos & mask];
+                size_t seq = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+                if(diff == 0){
+                    if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                        new (cell.storage) T(std::move(item));
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if(diff < 0){
+                    return false;
+                }
+                else{
+                    pos = enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        std::optional<T> tryPop() override{
+            size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+            Cell& cell = cells[pos & mask];
+            if(cell.sequence.load(std::memory_order_acquire) != pos + 1){
+                return std::nullopt;
+            }
+
+            T* slot = std::launder(reinterpret_cast<T*>(cell.storage));
+            std::optional<T> item(std::move(*slot));
+            slot->~T();
+            cell.sequence.store(pos + capacity, std::memory_order_release);
+            dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+            return item;
+        }
+
+    public:
+        explicit MpscMessageQueue(size_t min_capacity = 16384)
+            : capacity(roundUp(min_capacity)),
+              mask(capacity - 1),
+              cells(new Cell[capacity]){
+            for(size_t i = 0; i < capacity; i++){
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        ~MpscMessageQueue(){
+            while(tryPop()){}
+        }
+
+        size_t size() override{
+            size_t tail = enqueue_pos.load(std::memory_order_relaxed);
+            size_t head = dequeue_pos.load(std::memory_order_relaxed);
+            return tail > head ? tail - head : 0;
+        }
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "MessageQueue.h"
+#include <atomic>
+#include <thread>
+#include <climits>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Lets the single consumer of a queue sleep on a futex. The consumer calls
+// prepare(), re-checks the queue, then park()s; producers call notify() after
+// publishing and only pay for a syscall when the consumer is asleep.
+class ConsumerParker{
+    private:
+        std::atomic<uint32_t> epoch{0};
+        std::atomic<bool> sleeping{false};
+
+        void wake(int count){
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+        }
+
+    public:
+        uint32_t prepare(){
+            uint32_t token = epoch.load(std::memory_order_acquire);
+            sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return token;
+        }
+
+        void cancel(){
+            sleeping.store(false, std::memory_order_relaxed);
+        }
+
+        void park(uint32_t token, int timeout_ms){
+            timespec ts{};
+            timespec* timeout = nullptr;
+            if(timeout_ms >= 0){
+                ts.tv_sec = timeout_ms / 1000;
+                ts.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000;
+                timeout = &ts;
+            }
+            // Returns at once if a producer bumped the epoch since prepare()
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch), FUTEX_WAIT_PRIVATE, token, timeout, nullptr, 0);
+            sleeping.store(false, std::memory_order_relaxed);
+        }
+
+        void notify(){
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(sleeping.load(std::memory_order_relaxed)){
+                epoch.fetch_add(1, std::memory_order_release);
+                wake(1);
+            }
+        }
+
+        void notifyAll(){
+            epoch.fetch_add(1, std::memory_order_release);
+            wake(INT_MAX);
+        }
+};
+
+// Shared push/pop/stop logic of the bounded ring queues. Subclasses provide
+// the non-blocking ring operations; a full ring makes producers back off
+// until the consumer frees a slot. Only use them where no producer is the
+// consumer itself, or holds a lock the consumer needs to make progress.
+template<typename T>
+class ParkingMessageQueue : public MessageQueue<T>{
+    private:
+        ConsumerParker parker;
+        std::atomic<bool> stopped{false};
+
+    protected:
+        virtual bool tryPush(T& item) = 0;
+        virtual std::optional<T> tryPop() = 0;
+
+    public:
+        void push(T item) override{
+            if(stopped.load(std::memory_order_acquire)) return;
+
+            int spins = 0;
+            while(!tryPush(item)){
+                if(stopped.load(std::memory_order_acquire)) return;
+                if(++spins < 64){
+                    std::this_thread::yield();
+                }
+                else{
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+            }
+            parker.notify();
+        }
+
+        bool offer(T& item) override{
+            if(stopped.load(std::memory_order_acquire)) return true;
+            if(!tryPush(item)) return false;
+            parker.notify();
+            return true;
+        }
+
+        std::optional<T> pop(int timeout_ms = 10) override{
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms < 0 ? 0 : timeout_ms);
+
+            while(true){
+                if(auto item = tryPop()){
+                    return item;
+                }
+                if(stopped.load(std::memory_order_acquire) || timeout_ms == 0){
+                    return std::nullopt;
+                }
+
+                uint32_t token = parker.prepare();
+                if(auto item = tryPop()){
+                    parker.cancel();
+                    return item;
+                }
+                if(stopped.load(std::memory_order_acquire)){
+                    parker.cancel();
+                    return std::nullopt;
+                }
+
+                int wait_ms = -1;
+                if(timeout_ms > 0){
+                    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                    if(remaining <= 0){
+                        parker.cancel();
+                        return std::nullopt;
+                    }
+                    wait_ms = static_cast<int>(remaining);
+                }
+                parker.park(token, wait_ms);
+            }
+        }
+
+        size_t popBatch(std::vector<T>& out, size_t max, int timeout_ms = 10) override{
+            if(max == 0) return 0;
+
+            auto first = pop(timeout_ms);
+            if(!first){
+                return 0;
+            }
+            out.push_back(std::move(*first));
+
+            size_t taken = 1;
+            while(taken < max){
+                auto item = tryPop();
+                if(!item) break;
+                out.push_back(std::move(*item));
+                taken++;
+            }
+            this->recordBatch(taken);
+            return taken;
+        }
+
+        void stop() override{
+            stopped.store(true, std::memory_order_release);
+            parker.notifyAll();
+        }
+
+        bool isStopped() override{
+            return stopped.load(std::memory_order_acquire);
+        }
+};
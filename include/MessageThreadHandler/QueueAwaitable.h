@@ -0,0 +1,51 @@
+#pragma once
+
+#include "MessageQueue.h"
+#include "ThreadPool.h"
+#include <coroutine>
+
+// co_await sendTo(queue, item) pushes without blocking a worker: when a
+// bounded queue is full the coroutine is parked on the pool's timer and
+// retries. Off the pool it falls back to the blocking push().
+template<typename T>
+class QueueSendAwaitable{
+    private:
+        static constexpr std::chrono::milliseconds RETRY_DELAY{1};
+
+        std::shared_ptr<MessageQueue<T>> queue;
+        T item;
+
+        void retry(std::coroutine_handle<> h, ThreadPool* pool){
+            pool->submitAfter(RETRY_DELAY, [this, h, pool]{
+                if(queue->offer(item)){
+                    h.resume();
+                }
+                else{
+                    retry(h, pool);
+                }
+            });
+        }
+
+    public:
+        QueueSendAwaitable(std::shared_ptr<MessageQueue<T>> queue, T item)
+            : queue(std::move(queue)), item(std::move(item)) {}
+
+        bool await_ready(){ return queue->offer(item); }
+
+        bool await_suspend(std::coroutine_handle<> h){
+            auto pool = ThreadPool::current();
+            if(!pool){
+                queue->push(std::move(item));
+                return false;
+            }
+            retry(h, pool);
+            return true;
+        }
+
+        void await_resume() const noexcept {}
+};
+
+template<typename T, typename Q>
+QueueSendAwaitable<T> sendTo(std::shared_ptr<Q> queue, T item){
+    return QueueSendAwaitable<T>(std::move(queue), std::move(item));
+}
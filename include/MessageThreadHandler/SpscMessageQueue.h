@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ParkingMessageQueue.h"
+#include <new>
+
+// Bounded lock-free ring for exactly one producer thread and one consumer
+// thread. Each side caches the other's index and only re-reads it when the
+// ring looks full (producer) or empty (consumer).
+template<typename T>
+class SpscMessageQueue : public ParkingMessageQueue<T>{
+    private:
+        struct Slot{
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+
+        size_t capacity;
+        size_t mask;
+        std::unique_ptr<Slot[]> slots;
+
+        alignas(64) std::atomic<size_t> tail{0};   // written by the producer
+        size_t head_cache = 0;
+        alignas(64) std::atomic<size_t> head{0};   // written by the consumer
+        size_t tail_cache = 0;
+
+        static size_t roundUp(size_t n){
+            size_t cap = 2;
+            while(cap < n) cap <<= 1;
+            return cap;
+        }
+
+    protected:
+        bool tryPush(T& item) override{
+            size_t t = tail.load(std::memory_order_relaxed);
+            if(t - head_cache >= capacity){
+                head_cache = head.load(std::memory_order_acquire);
+                if(t - head_cache >= capacity){
+                    return false;
+                }
+            }
+
+            new (slots[t & mask].storage) T(std::move(item));
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        std::optional<T> tryPop() override{
+            size_t h = head.load(std::memory_order_relaxed);
+            if(h == tail_cache){
+                tail_cache = tail.load(std::memory_order_acquire);
+                if(h == tail_cache){
+                    return std::nullopt;
+                }
+            }
+
+            T* slot = std::launder(reinterpret_cast<T*>(slots[h & mask].storage));
+            std::optional<T> item(std::move(*slot));
+            slot->~T();
+            head.store(h + 1, std::memory_order_release);
+            return item;
+        }
+
+    public:
+        explicit SpscMessageQueue(size_t min_capacity = 16384)
+            : capacity(roundUp(min_capacity)),
+              mask(capacity - 1),
+              slots(new Slot[capacity]) {}
+
+        ~SpscMessageQueue(){
+            while(tryPop()){}
+        }
+
+        size_t size() override{
+            size_t t = tail.load(std::memory_order_relaxed);
+            size_t h = head.load(std::memory_order_relaxed);
+            return t > h ? t - h : 0;
+        }
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "DataBaseManager.h"
+#include "MessageId.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Page of one receiver's undelivered messages, oldest first: store
+// positions in (after, until], at most limit of them. A zero until is
+// replaced with the receiver's newest position at the time of the read, so
+// later pages stop where the first one saw the backlog end.
+struct OfflinePage{
+    int receiver_id = -1;
+    int64_t after = 0;
+    int64_t until = 0;
+    size_t limit = 0;
+    std::vector<PendingMessageRecord> messages;
+};
+
+// Where messages wait between being sent and being acknowledged, and what
+// a login replays. Every call is asynchronous and answers through its
+// callback on a store thread; recover() alone blocks. Statuses are those of
+// PendingMessageRecord: 'pending' and 'sent' are still owed to the
+// receiver, 'acknowledged' and 'failed' are done with.
+class OfflineMessageStore{
+    public:
+        using Callback = std::function<void(bool success, std::string& message)>;
+        using PageCallback = std::function<void(bool success, OfflinePage& page)>;
+
+        virtual ~OfflineMessageStore() = default;
+
+        virtual const char* name() const = 0;
+
+        virtual void append(MessageId msg_id, int sender_id, int receiver_id, const std::string& content, Callback done) = 0;
+        // A single message marked 'sent' also counts a retry
+        virtual void updateStatus(MessageId msg_id, const std::string& status, Callback done) = 0;
+        virtual void updateStatus(std::vector<MessageId> msg_ids, const std::string& status, Callback done) = 0;
+        virtual void remove(MessageId msg_id, Callback done) = 0;
+        virtual void fetchPage(OfflinePage page, PageCallback done) = 0;
+        // Startup: the highest message id stored and what awaits delivery
+        virtual bool recover(PendingRecovery& recovery) = 0;
+};
+
+using OfflineMessageStorePtr = std::shared_ptr<OfflineMessageStore>;
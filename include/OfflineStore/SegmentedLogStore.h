@@ -0,0 +1,171 @@
+#pragma once
+
+#include "OfflineMessageStore.h"
+#include "MessageQueue.h"
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <thread>
+#include <unordered_map>
+
+struct SegmentedLogConfig{
+    std::filesystem::path directory = "../DataBase/offline_log";
+    uint64_t segment_bytes = 64ull << 20;    // a segment is sealed once it passes this
+    bool sync_writes = false;               // fdatasync every batch before its callbacks
+};
+
+// Append-only offline store. Messages and status changes are records
+// appended to numbered segment files, each record prefixed with its length
+// and a CRC-32C. Memory holds only an index: every undelivered message's
+// segment and offset, and per receiver the undelivered messages in log
+// order; the head of that list is the receiver's consumer offset. Content
+// is read back from disk when a page is replayed.
+//
+// A sealed segment is deleted once it and every older segment hold no
+// undelivered message; going oldest first keeps every status record that
+// still matters on disk. 'pending' and 'sent' are tracked in memory only
+// since both mean "replay at login"; only 'acknowledged', 'failed' and
+// removal are written.
+//
+// Startup reads every segment back, checking each record's CRC. A torn
+// record at the end of the newest segment is cut off; elsewhere the rest of
+// the segment is skipped and reported.
+//
+// One thread owns the files. It serializes the writes of a queue batch into
+// one write() and answers page reads after them. The queue is unbounded:
+// page callbacks run on this thread and queue more operations, and callers
+// may hold locks those callbacks take. A batch whose write fails is cut
+// off the segment again and its index changes are undone, so the store
+// matches what its callers were told.
+class SegmentedLogStore : public OfflineMessageStore{
+    public:
+        struct Stats{
+            uint64_t appended = 0;
+            uint64_t completed = 0;
+            uint64_t segments = 0;
+            uint64_t reclaimed_segments = 0;
+            uint64_t disk_bytes = 0;
+            uint64_t undelivered = 0;
+        };
+
+    private:
+        enum class RecordType : uint8_t{
+            MESSAGE = 1,
+            STATUS = 2,
+        };
+
+        enum class Status : uint8_t{
+            PENDING = 0,
+            SENT = 1,
+            ACKNOWLEDGED = 2,
+            FAILED = 3,
+            REMOVED = 4,
+        };
+
+        struct Operation{
+            enum class Kind{ APPEND, STATUS, FETCH, RECOVER } kind;
+            MessageId message_id = 0;
+            int sender_id = -1;
+            int receiver_id = -1;
+            std::string content;
+            std::vector<MessageId> message_ids;
+            Status status = Status::PENDING;
+            bool count_retry = false;
+            OfflinePage page;
+            PendingRecovery* recovery = nullptr;
+            Callback done;
+            PageCallback page_done;
+        };
+        using OperationPtr = std::shared_ptr<Operation>;
+
+        struct Entry{
+            int64_t position;
+            uint64_t segment;
+            uint64_t offset;        // of the content
+            uint32_t length;
+            int sender_id;
+            int receiver_id;
+            Status status;
+            int retry_count;
+        };
+
+        struct Segment{
+            int fd = -1;
+            uint64_t size = 0;
+            size_t undelivered = 0;
+        };
+
+        // Index changes of the batch not yet written, undone if the write fails
+        struct Undo{
+            MessageId message_id;
+            Entry entry;
+            bool appended;          // false: the batch completed it
+        };
+
+        SegmentedLogConfig config;
+        std::shared_ptr<MessageQueue<OperationPtr>> queue;
+        std::thread worker_thread;
+        std::atomic<bool> running{false};
+
+        // Owned by the worker thread (and start() before it runs)
+        std::map<uint64_t, Segment> segments;
+        std::unordered_map<MessageId, Entry> entries;
+        std::unordered_map<int, std::map<int64_t, MessageId>> by_receiver;
+        int64_t next_position = 1;
+        std::optional<MessageId> last_message_id;
+        std::string write_buffer;
+        std::vector<std::pair<Callback, bool>> completions;     // true: waits for the write
+        std::vector<Undo> undo_log;
+        bool tail_clean = true;     // false: a failed write left bytes past the active segment's size
+
+        std::atomic<uint64_t> appended{0};
+        std::atomic<uint64_t> completed{0};
+        std::atomic<uint64_t> segment_count{0};
+        std::atomic<uint64_t> reclaimed_segments{0};
+        std::atomic<uint64_t> disk_bytes{0};
+        std::atomic<uint64_t> undelivered{0};
+
+        static std::optional<Status> parseStatus(const std::string& status);
+        std::filesystem::path segmentPath(uint64_t number) const;
+
+        bool load();
+        bool loadSegment(uint64_t number, bool newest);
+        void applyMessage(uint64_t segment, uint64_t offset, const char* payload, uint32_t length);
+        void applyStatus(const char* payload, uint32_t length);
+        bool openSegment(uint64_t number);
+
+        void run();
+        void submit(OperationPtr op);
+        void submitStatus(std::vector<MessageId> msg_ids, const std::string& status, bool count_retry, Callback done);
+        void process(Operation& op);
+        void appendRecord(RecordType type, const std::string& payload);
+        void index(MessageId msg_id, const Entry& entry);
+        void unindex(const Entry& entry, MessageId msg_id);
+        void complete(Entry& entry, MessageId msg_id);
+        bool flush();
+        bool discardTail();
+        void rollback();
+        void reclaim();
+        void readPage(OfflinePage& page);
+
+    public:
+        explicit SegmentedLogStore(const SegmentedLogConfig& config = SegmentedLogConfig());
+        ~SegmentedLogStore();
+
+        // Opens or creates the directory and reads the log back
+        bool start();
+        void stop();
+
+        const char* name() const override { return "log"; }
+
+        void append(MessageId msg_id, int sender_id, int receiver_id, const std::string& content, Callback done) override;
+        void updateStatus(MessageId msg_id, const std::string& status, Callback done) override;
+        void updateStatus(std::vector<MessageId> msg_ids, const std::string& status, Callback done) override;
+        void remove(MessageId msg_id, Callback done) override;
+        void fetchPage(OfflinePage page, PageCallback done) override;
+        bool recover(PendingRecovery& recovery) override;
+
+        Stats getStats() const;
+};
+
+using SegmentedLogStorePtr = std::shared_ptr<SegmentedLogStore>;
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "OfflineMessageStore.h"
+#include "DataBaseThread.h"
+
+// pending_messages in SQLite, through the DataBaseThread queue: one row per
+// message, updated in place as its status changes. Rows are positioned by
+// their rowid.
+class SqliteOfflineStore : public OfflineMessageStore{
+    private:
+        DataBaseThreadPtr db_thread;
+
+        void submit(DBRequestPtr req, Callback done);
+
+    public:
+        explicit SqliteOfflineStore(DataBaseThreadPtr db_thread);
+
+        const char* name() const override { return "sqlite"; }
+
+        void append(MessageId msg_id, int sender_id, int receiver_id, const std::string& content, Callback done) override;
+        void updateStatus(MessageId msg_id, const std::string& status, Callback done) override;
+        void updateStatus(std::vector<MessageId> msg_ids, const std::string& status, Callback done) override;
+        void remove(MessageId msg_id, Callback done) override;
+        void fetchPage(OfflinePage page, PageCallback done) override;
+        bool recover(PendingRecovery& recovery) override;
+};
@@ -1,20 +1,51 @@
 #pragma once
 
-#include <unordered_set>
+#include "Connection.h"
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 
+struct RoomMember{
+    int fd;
+    ConnectionPtr connection;
+};
+
+// Members as of one join or leave. Never changed once published.
+struct RoomSnapshot{
+    uint64_t version = 0;
+    std::vector<RoomMember> members;
+};
+
+using RoomSnapshotPtr = std::shared_ptr<const RoomSnapshot>;
+
+// Broadcasts read the current snapshot with one atomic load and walk its
+// member array without locking the room or looking connections up. Join
+// and leave copy the array under room_mutex and publish the copy, so they
+// cost O(members); rooms change far less often than they are spoken in.
+//
+// A connection that closes between its join check and join() can miss the
+// reactor's leave(fd) and stay behind; broadcasts find it closed and remove
+// it with the leave overload that checks it is still the same connection.
 class PublicChatRoom{
     private:
-        std::unordered_set<int> participants;
-        std::mutex room_mutex;
+        std::atomic<RoomSnapshotPtr> snapshot{std::make_shared<const RoomSnapshot>()};
+        std::unordered_map<int, size_t> positions;     // fd -> index in the current snapshot
+        std::mutex room_mutex;                          // writers only
+
+        void removeAt(std::unordered_map<int, size_t>::iterator it);
+
     public:
         PublicChatRoom() = default;
         ~PublicChatRoom() = default;
 
         static PublicChatRoom& getInstance();
-        void join(int fd);
+        void join(ConnectionPtr conn);
         void leave(int fd);
-        std::unordered_set<int> getParticipants();
+        // Leaves only if fd still belongs to connection; false otherwise
+        bool leave(int fd, const Connection* connection);
+        RoomSnapshotPtr getParticipants() const;
         bool isParticipant(int fd);
-        size_t getParticipantsCount();
-};
\ No newline at end of file
+        size_t getParticipantsCount() const;
+};
@@ -13,6 +13,7 @@
 #include <csignal>
 
 #include "EpollThread.h"
+#include "ReactorGroup.h"
 #include "ChatControllerThread.h"
 #include "PublicChatThreadHandler.h"
 #include "PublicChatHandler.h"
@@ -47,25 +48,38 @@
 #include "MessageAckManager.h"
 #include "MessageAckManagerThreadHandler.h"
 
-#define BUFFER_SIZE 4096
 #define MAX_EVENTS 1024
-constexpr size_t MAX_MESSAGE_SIZE = 1024 * 1024;  // 1MB limit
+
+// Per-shard load counters, read by the monitor loop in main
+struct ShardStats{
+    std::atomic<uint64_t> accepted{0};
+    std::atomic<uint64_t> messages_routed{0};
+};
 
 class TCPServer : public std::enable_shared_from_this<TCPServer>{
     private:
         int listen_fd;
-        EpollInstancePtr epoll_instance;
+        EventLoopPtr event_loop;
         std::shared_ptr<MessageQueue<Message>> to_router_queue;
+        ResponserPtr responser;
+        ShardStats stats;
 
-        void onAccept(int fd);
+        void onAccept(int clientFd);
         void onRead(int clientFd);
 
     public:
-        TCPServer(const sockaddr_in& addr, EpollInstancePtr epoll, std::shared_ptr<MessageQueue<Message>> to_router);
+        TCPServer(const sockaddr_in& addr, EventLoopPtr loop, std::shared_ptr<MessageQueue<Message>> to_router, bool reuse_port = false);
         ~TCPServer();
 
+        // Writes the server makes on its own (rate-limit warnings) go through
+        // the connection's write queue like every response; call before start
+        void setResponser(ResponserPtr dispatcher) { responser = std::move(dispatcher); }
+
         void startServer();
         void stopServer();
+
+        const ShardStats& getStats() const { return stats; }
+        int getShardId() const { return event_loop->getShardId(); }
 };
 
 using TCPServerPtr = std::shared_ptr<TCPServer>;
\ No newline at end of file
@@ -21,19 +21,50 @@
 #include <variant>
 #include <thread>
 #include <deque>
+#include <vector>
+#include <climits>
+#include <sys/uio.h>
+#include "ReadBuffer.h"
+#include "Session.h"
+
+// One queued write. Unicast responses own their bytes; a broadcast queues
+// the same shared payload on every member rather than a copy for each.
+struct WriteSegment{
+    std::string owned;
+    std::shared_ptr<const std::string> shared;
+
+    WriteSegment() = default;
+    explicit WriteSegment(std::string data) : owned(std::move(data)) {}
+    explicit WriteSegment(std::shared_ptr<const std::string> data) : shared(std::move(data)) {}
+
+    const char* data() const { return shared ? shared->data() : owned.data(); }
+    size_t size() const { return shared ? shared->size() : owned.size(); }
+    bool empty() const { return size() == 0; }
+    // Drops bytes already sent; a shared payload is copied, not trimmed
+    void dropPrefix(size_t n){
+        if(shared){
+            owned.assign(shared->data() + n, shared->size() - n);
+            shared.reset();
+        }
+        else{
+            owned.erase(0, n);
+        }
+    }
+};
 
 class Connection{
     private:
         std::atomic<int> fd;
         std::atomic<bool> closed{false};
+        std::atomic<int> shard{0};
         mutable std::mutex close_mutex;
 
-        std::deque<std::string> write_queue;
+        std::deque<WriteSegment> write_queue;
         std::mutex write_mutex;
         std::atomic<bool> writing{false};
-        std::string partial_write;
+        size_t write_offset = 0;    // bytes of write_queue.front() already sent
 
-        std::string read_buffer;
+        ReadBuffer read_buffer;
         std::mutex read_mutex;
 
         std::deque<std::chrono::steady_clock::time_point> message_timestamps;
@@ -44,6 +75,8 @@ class Connection{
         std::chrono::steady_clock::time_point last_activity;
         std::mutex activity_mutex;
 
+        Session session;
+
     public:
         explicit Connection(int socket_fd);
         ~Connection();
@@ -58,23 +91,50 @@ class Connection{
         bool isClosed();
         void close();
 
+        // Reactor shard that owns this socket, fixed at accept time
+        int getShard() const { return shard.load(std::memory_order_acquire); }
+        void setShard(int id) { shard.store(id, std::memory_order_release); }
+
+        // Not moved with the socket: a session starts on a fresh connection
+        Session& getSession() { return session; }
+
         // Write
         void queueWrite(std::string data);
+        void queueWrite(std::shared_ptr<const std::string> data);
         bool hasWriteData();
-        std::string popWriteData();
+        WriteSegment popWriteData();
+        // Puts back what a send of popped segments left unsent, ahead of
+        // anything queued since; sent is the byte count that did go out
+        void requeueUnsent(std::vector<WriteSegment>& segments, size_t sent);
         size_t getWriteQueueSize();
         void clearWriteQueue();
 
         bool isWriting() const { return writing.load(); }
         void setWriting(bool val) { writing.store(val); }
+        // Claims the right to arm write notifications; false if already armed
+        bool beginWriting(){
+            bool expected = false;
+            return writing.compare_exchange_strong(expected, true);
+        }
 
-        void setPartialWrite(std::string data) { partial_write = std::move(data); }
-        std::string getPartialWrite() { return std::move(partial_write); }
-        bool hasPartialWrite() const { return !partial_write.empty(); }
+        // Sends the write queue with sendmsg, up to IOV_MAX segments per call,
+        // until it drains or the socket would block. A partially sent head
+        // segment stays queued and the next flush resumes at write_offset.
+        struct WriteResult{
+            enum Status{ DRAINED, WOULD_BLOCK, FAILED } status = DRAINED;
+            int error = 0;
+            size_t bytes = 0;
+            size_t syscalls = 0;
+            size_t segments = 0;
+        };
+        WriteResult flushWriteQueue();
 
-        // Read
-        void appendReadBuffer(const std::string& data);
-        std::string extractCompleteMessage();
+        // Read. Only the owning reactor thread fills and drains the buffer, so
+        // a message view stays valid until it next reads from the socket.
+        char* prepareRead(size_t min_space, size_t& available);
+        void commitRead(size_t n);
+        void appendReadBuffer(const char* data, size_t len);
+        bool nextMessage(std::string_view& message);
         void clearReadBuffer();
         size_t getReadBufferSize();
         
@@ -1,38 +1,43 @@
 #pragma once
 
-#include "Connection.h"
+#include "EventLoop.h"
 #include "unordered_set"
 #define MAX_EVENTS 1024
 
-class EpollInstance : public std::enable_shared_from_this<EpollInstance>{
+class EpollInstance : public EventLoop{
     private:
-        using Callback = std::function<void(int)>;
-
         int epfd;
         std::unordered_set<int> epoll_fds;
+        std::unordered_map<int, Callback> accept_handlers;
         std::unordered_map<int, Callback> read_handlers;
         std::unordered_map<int, Callback> write_handlers;
         std::unordered_map<int, ConnectionPtr> connections;
         std::mutex handlers_mutex;
         std::atomic<bool> should_stop{false};
 
+        void acceptClients(int listen_fd, const Callback& on_client);
+        bool readFromSocket(int fd, ConnectionPtr conn);
+
     public:
-        EpollInstance();
+        explicit EpollInstance(int shard_id = 0);
         ~EpollInstance();
 
-        void addFd(int fd, Callback cb, ConnectionPtr conn = nullptr);
-        void removeFd(int fd);
+        void addListener(int listen_fd, Callback on_client) override;
+        void addFd(int fd, Callback cb, ConnectionPtr conn = nullptr) override;
+        void removeFd(int fd) override;
         
-        void enableWrite(int fd, Callback write_cb);
-        void disableWrite(int fd);
-        bool isWriteEnabled(int fd);
+        void enableWrite(int fd, Callback write_cb) override;
+        void disableWrite(int fd) override;
+        bool isWriteEnabled(int fd) override;
 
-        ConnectionPtr getConnection(int fd);
-        void run();
-        void stop();
-        bool isStopped();
-        bool isEpollMember(int fd);
-        std::vector<ConnectionPtr> getAllConnections();
+        ConnectionPtr getConnection(int fd) override;
+        void run() override;
+        void stop() override;
+        bool isStopped() override;
+        bool isEpollMember(int fd) override;
+        std::vector<ConnectionPtr> getAllConnections() override;
+        size_t getConnectionCount() override;
+        const char* getBackendName() const override { return "epoll"; }
 };
 
-using EpollInstancePtr = std::shared_ptr<EpollInstance>;
\ No newline at end of file
+using EpollInstancePtr = std::shared_ptr<EpollInstance>;
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "Epoll.h"
+#include "EventLoop.h"
 #include "MessageQueue.h"
 #include "Message.h"
 #include <thread>
@@ -8,16 +8,18 @@
 
 class EpollThread{
     private:
-        EpollInstancePtr epoll_instance;
+        EventLoopPtr event_loop;
         std::thread worker_thread;
         std::atomic<bool> running{false};   
+        int cpu_id;     // -1 = no affinity
     
         void run();
+        void applyAffinity();
     public:
-        EpollThread(EpollInstancePtr epoll);
+        EpollThread(EventLoopPtr loop, int cpu_id = -1);
         void start();
         void stop();
-        EpollInstancePtr getEpoll();
+        EventLoopPtr getEventLoop();
 };
 
-using EpollThreadPtr = std::shared_ptr<EpollThread>;
\ No newline at end of file
+using EpollThreadPtr = std::shared_ptr<EpollThread>;
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Connection.h"
+#include <vector>
+#include <string>
+
+#define BUFFER_SIZE 4096
+constexpr size_t MAX_MESSAGE_SIZE = 1024 * 1024;  // 1MB limit
+
+enum class EventBackend{
+    EPOLL,
+    IO_URING
+};
+
+// Common surface of the reactor backends. The backend owns socket reads and
+// accepts: listeners report each accepted client fd, and a connection's read
+// callback runs after new bytes were appended to its read buffer. Write
+// callbacks run on the reactor thread once the socket can take more data.
+class EventLoop : public std::enable_shared_from_this<EventLoop>{
+    public:
+        using Callback = std::function<void(int)>;
+
+    protected:
+        int shard_id;
+        std::atomic<uint64_t> bytes_read{0};
+        std::atomic<uint64_t> write_calls{0};       // sendmsg calls / send submissions
+        std::atomic<uint64_t> write_segments{0};    // queued strings they carried
+
+    public:
+        explicit EventLoop(int shard_id) : shard_id(shard_id) {}
+        virtual ~EventLoop() = default;
+
+        virtual void addListener(int listen_fd, Callback on_client) = 0;
+        virtual void addFd(int fd, Callback read_cb, ConnectionPtr conn = nullptr) = 0;
+        virtual void removeFd(int fd) = 0;
+
+        virtual void enableWrite(int fd, Callback write_cb) = 0;
+        virtual void disableWrite(int fd) = 0;
+        virtual bool isWriteEnabled(int fd) = 0;
+
+        virtual ConnectionPtr getConnection(int fd) = 0;
+        virtual void run() = 0;
+        virtual void stop() = 0;
+        virtual bool isStopped() = 0;
+        virtual bool isEpollMember(int fd) = 0;
+        virtual std::vector<ConnectionPtr> getAllConnections() = 0;
+        virtual size_t getConnectionCount() = 0;
+        virtual const char* getBackendName() const = 0;
+
+        int getShardId() const { return shard_id; }
+        uint64_t getBytesRead() const { return bytes_read.load(std::memory_order_relaxed); }
+
+        void recordWrites(size_t calls, size_t segments){
+            write_calls.fetch_add(calls, std::memory_order_relaxed);
+            write_segments.fetch_add(segments, std::memory_order_relaxed);
+        }
+        uint64_t getWriteCalls() const { return write_calls.load(std::memory_order_relaxed); }
+        double getSegmentsPerWrite() const{
+            uint64_t calls = getWriteCalls();
+            return calls ? static_cast<double>(write_segments.load(std::memory_order_relaxed)) / calls : 0.0;
+        }
+
+        // Creates the requested backend, falling back to epoll when the
+        // kernel cannot run it.
+        static std::shared_ptr<EventLoop> create(EventBackend backend, int shard_id);
+};
+
+using EventLoopPtr = std::shared_ptr<EventLoop>;
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "EventLoop.h"
+#include <linux/io_uring.h>
+#include <unordered_map>
+
+#define URING_ENTRIES 1024
+#define URING_BUFFER_COUNT 512      // provided recv buffers, power of two
+
+// io_uring backend: one multishot accept per listener, one multishot recv per
+// connection reading into a registered provided-buffer ring, and write queues
+// flushed as one MSG_WAITALL sendmsg over up to IOV_MAX queued strings. The
+// write callback runs once a flush has drained the connection's queue.
+class IoUringInstance : public EventLoop{
+    private:
+        enum class Op : uint8_t{
+            ACCEPT = 1,
+            RECV,
+            SEND,
+            FLUSH,
+            CANCEL,
+            WAKE
+        };
+
+        struct FdState{
+            uint32_t generation = 0;
+            bool listener = false;
+            Callback on_client;
+            Callback read_cb;
+            Callback write_cb;
+            ConnectionPtr conn;
+            std::vector<WriteSegment> inflight; // buffers owned by the kernel until the send completes
+            std::vector<iovec> inflight_iov;
+            std::unique_ptr<msghdr> inflight_msg;
+            bool send_pending = false;
+            bool flush_queued = false;
+            int outstanding = 0;                // submitted SQEs without a final CQE
+        };
+
+        int ring_fd;
+        unsigned sq_entries;
+        unsigned* sq_head;
+        unsigned* sq_tail;
+        unsigned* sq_mask;
+        unsigned* sq_array;
+        unsigned sq_tail_local;
+        io_uring_sqe* sqes;
+        unsigned* cq_head;
+        unsigned* cq_tail;
+        unsigned* cq_mask;
+        io_uring_cqe* cqes;
+
+        void* sq_ring_ptr;
+        size_t sq_ring_size;
+        void* cq_ring_ptr;
+        size_t cq_ring_size;
+        size_t sqes_size;
+
+        io_uring_buf_ring* buf_ring;
+        size_t buf_ring_size;
+        char* buf_pool;
+        uint16_t buf_tail;
+
+        std::atomic<bool> multishot_accept{true};
+        std::atomic<bool> multishot_recv{true};
+
+        std::unordered_map<int, FdState> fds;
+        std::unordered_map<uint64_t, FdState> retired;   // closed fds with SQEs still in flight
+        uint32_t next_generation = 1;
+        std::mutex handlers_mutex;
+        std::mutex sq_mutex;
+        std::atomic<bool> should_stop{false};
+
+        void setupRing();
+        void setupBufferRing();
+        void teardown();
+
+        static uint64_t encode(Op op, uint32_t generation, int fd);
+        io_uring_sqe* getSqe();
+        void submit();
+
+        void armAccept(int fd, FdState& state);
+        void armRecv(int fd, FdState& state);
+        void postNop(Op op, int fd, uint32_t generation);
+        void recycleBuffer(uint16_t bid);
+        void flushWrites(int fd);
+
+        void handleCompletion(const io_uring_cqe& cqe);
+        void handleAccept(int fd, uint32_t generation, const io_uring_cqe& cqe);
+        void handleRecv(int fd, uint32_t generation, const io_uring_cqe& cqe);
+        void handleSend(int fd, uint32_t generation, const io_uring_cqe& cqe);
+        void reapCompletions(int timeout_ms);
+
+    public:
+        explicit IoUringInstance(int shard_id = 0);
+        ~IoUringInstance();
+
+        void addListener(int listen_fd, Callback on_client) override;
+        void addFd(int fd, Callback cb, ConnectionPtr conn = nullptr) override;
+        void removeFd(int fd) override;
+
+        void enableWrite(int fd, Callback write_cb) override;
+        void disableWrite(int fd) override;
+        bool isWriteEnabled(int fd) override;
+
+        ConnectionPtr getConnection(int fd) override;
+        void run() override;
+        void stop() override;
+        bool isStopped() override;
+        bool isEpollMember(int fd) override;
+        std::vector<ConnectionPtr> getAllConnections() override;
+        size_t getConnectionCount() override;
+        const char* getBackendName() const override { return "io_uring"; }
+};
+
+using IoUringInstancePtr = std::shared_ptr<IoUringInstance>;
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "EventLoop.h"
+#include "EpollThread.h"
+#include <vector>
+
+// Owns the reactor shards (one EventLoop + EpollThread each). A connection
+// is registered on exactly one shard for its whole life; lookups that only
+// know the fd search every shard, EPOLLOUT is armed on the shard recorded on
+// the Connection.
+class ReactorGroup{
+    private:
+        std::vector<EpollThreadPtr> shards;
+
+    public:
+        ReactorGroup(size_t shard_count, bool pin_cpus, EventBackend backend = EventBackend::EPOLL);
+
+        size_t size() const { return shards.size(); }
+        EventLoopPtr getShard(size_t index);
+        EventLoopPtr getOwner(int fd);
+        EventLoopPtr getOwner(ConnectionPtr conn);
+
+        void start();
+        void stop();
+        bool isStopped();
+
+        ConnectionPtr getConnection(int fd);
+        bool isEpollMember(int fd);
+        std::vector<ConnectionPtr> getAllConnections();
+};
+
+using ReactorGroupPtr = std::shared_ptr<ReactorGroup>;
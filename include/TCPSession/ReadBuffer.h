@@ -0,0 +1,44 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <cstddef>
+
+// Growable slab for inbound bytes. recv() writes straight into the free
+// space after the tail, consumed lines only advance the head, and the live
+// region is moved back to the front lazily when space runs out. Views
+// returned by nextLine() stay valid until the next prepare()/append().
+class ReadBuffer{
+    private:
+        static constexpr size_t INITIAL_CAPACITY = 4096;
+        static constexpr size_t SHRINK_THRESHOLD = 64 * 1024;
+
+        std::unique_ptr<char[]> data;
+        size_t capacity = 0;
+        size_t head = 0;        // first unconsumed byte
+        size_t tail = 0;        // end of received bytes
+        size_t scanned = 0;     // bytes after head known to hold no delimiter
+
+        void reserve(size_t min_space);
+
+    public:
+        ReadBuffer() = default;
+        ReadBuffer(const ReadBuffer&) = delete;
+        ReadBuffer& operator=(const ReadBuffer&) = delete;
+
+        // Returns at least min_space writable bytes after the tail; the
+        // actual amount is stored in available.
+        char* prepare(size_t min_space, size_t& available);
+        void commit(size_t n);
+        void append(const char* src, size_t n);
+
+        // Pops the next '\n'-terminated line (without the delimiter).
+        bool nextLine(std::string_view& line);
+
+        size_t size() const { return tail - head; }
+        void clear();
+
+        // Position of the first '\n' in [begin, end), or end. Uses AVX2 when
+        // the CPU has it, SSE2 otherwise.
+        static const char* findNewline(const char* begin, const char* end);
+};
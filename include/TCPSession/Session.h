@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Who is on a connection and which rooms it is in, kept on the Connection
+// so the router, the handlers and the Responser answer "am I logged in, as
+// whom, am I in the room" with an atomic load instead of a global lookup.
+// The login, logout, join and leave handlers update it next to UserManager
+// and PublicChatRoom, which stay the source of truth for lookups of other
+// users (by username, room members).
+//
+// Usernames are interned: the session points at one shared copy per name
+// that lives until exit, so reading it needs no copy and no lock.
+class Session{
+    public:
+        enum Room : uint32_t{
+            PUBLIC_CHAT_ROOM = 1u << 0,
+        };
+
+    private:
+        std::atomic<int> user_id{-1};                       // -1: not logged in
+        std::atomic<const std::string*> username{nullptr};  // set before user_id
+        std::atomic<uint32_t> rooms{0};
+
+    public:
+        Session() = default;
+
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+
+        static const std::string* intern(const std::string& name);
+
+        void login(int id, const std::string& name){
+            username.store(intern(name), std::memory_order_relaxed);
+            user_id.store(id, std::memory_order_release);
+        }
+        void logout(){ user_id.store(-1, std::memory_order_release); }
+
+        bool isLoggedIn() const { return user_id.load(std::memory_order_acquire) >= 0; }
+        int getUserId() const { return user_id.load(std::memory_order_acquire); }
+        // Empty when not logged in
+        const std::string& getUsername() const;
+
+        // False if the membership was already in that state
+        bool joinRoom(Room room){ return !(rooms.fetch_or(room, std::memory_order_acq_rel) & room); }
+        bool leaveRoom(Room room){ return rooms.fetch_and(~static_cast<uint32_t>(room), std::memory_order_acq_rel) & room; }
+        bool inRoom(Room room) const { return rooms.load(std::memory_order_acquire) & room; }
+
+        void clear(){
+            logout();
+            rooms.store(0, std::memory_order_release);
+        }
+};
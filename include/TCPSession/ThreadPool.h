@@ -1,28 +1,143 @@
 #pragma once
 
 #include <vector>
+#include <deque>
 #include <thread>
-#include <queue>
 #include <functional>
 #include <mutex>
 #include <condition_variable>
 #include <memory>
 #include <atomic>
-#include <iostream>
+#include <unordered_map>
+#include <array>
+#include <map>
+#include <chrono>
+#include <coroutine>
 
+// Work-stealing executor. Every worker owns a deque: tasks submitted from a
+// worker go to its own deque, tasks from other threads are spread round-robin.
+// Owners serve their deque FIFO; a worker whose deque is empty steals from the
+// back of the others' before parking.
+//
+// submitOrdered() runs tasks sharing a key one at a time, in submission order,
+// on whichever worker is free; different keys run in parallel.
+// submitOrderedAsync() is the same for tasks that finish on another thread:
+// the key's next task waits until the task's Resume has been called.
+// submitAfter() hands a task to the workers once a delay has passed; a single
+// timer thread keeps the deadlines. cancel() drops a timer that has not fired.
+//
+// Coroutines running on a worker can co_await schedule() to hop onto the
+// pool and sleepFor() to wait without holding a worker.
 class ThreadPool{
+    public:
+        using Task = std::function<void()>;
+        using Resume = std::function<void()>;           // call exactly once, from any thread
+        using AsyncTask = std::function<void(Resume)>;
+
+        struct TimerHandle{
+            std::chrono::steady_clock::time_point deadline;
+            uint64_t id = 0;        // 0: no timer
+        };
+
     private:
+        static constexpr size_t STRAND_STRIPES = 64;
+        static constexpr size_t STRAND_BATCH = 16;     // tasks run per turn before a strand yields
+
+        struct alignas(64) WorkQueue{
+            std::mutex mtx;
+            std::deque<Task> tasks;
+        };
+
+        struct StrandTask{
+            Task task;
+            AsyncTask async_task;
+        };
+
+        struct Strand{
+            std::deque<StrandTask> tasks;
+            bool scheduled = false;     // a runner is queued or running, or an async task is pending
+            bool in_turn = false;       // a runner is executing a task right now
+            bool suspended = false;     // an async task has not resumed yet
+        };
+
+        struct StrandStripe{
+            std::mutex mtx;
+            std::unordered_map<uint64_t, std::shared_ptr<Strand>> strands;
+        };
+
+        std::vector<std::unique_ptr<WorkQueue>> queues;
         std::vector<std::thread> workers;
-        std::queue<std::function<void()>> tasks;
-        std::mutex mtx;
-        std::condition_variable cv;
-        std::atomic<bool> stop{false};
+        std::array<StrandStripe, STRAND_STRIPES> stripes;
+
+        std::atomic<size_t> pending{0};
+        std::atomic<size_t> next_queue{0};
+        std::atomic<int> idle{0};
+        std::mutex park_mtx;
+        std::condition_variable park_cv;
+        std::atomic<bool> stopping{false};
+
+        std::map<std::pair<std::chrono::steady_clock::time_point, uint64_t>, Task> timers;
+        uint64_t next_timer_id = 1;
+        std::mutex timer_mtx;
+        std::condition_variable timer_cv;
+        std::thread timer_thread;
+
+        std::atomic<uint64_t> executed{0};     // a strand turn counts once
+        std::atomic<uint64_t> stolen{0};
+
+        void workerLoop(size_t index);
+        void timerLoop();
+        bool popLocal(size_t index, Task& task);
+        bool steal(size_t index, Task& task);
+        void runTask(Task& task);
+        void runStrand(uint64_t key, std::shared_ptr<Strand> strand);
+        void resumeStrand(uint64_t key, std::shared_ptr<Strand> strand);
+        void enqueueStrand(uint64_t key, StrandTask entry);
+        StrandStripe& stripeOf(uint64_t key);
 
     public:
-        explicit ThreadPool(size_t n);
+        // n == 0 sizes the pool to the number of cores
+        explicit ThreadPool(size_t n = 0);
         ~ThreadPool();
 
-        void submit(std::function<void()> task);
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        void submit(Task task);
+        void submitOrdered(uint64_t key, Task task);
+        void submitOrderedAsync(uint64_t key, AsyncTask task);
+        TimerHandle submitAfter(std::chrono::milliseconds delay, Task task);
+        // False if the timer already fired or was cancelled
+        bool cancel(const TimerHandle& timer);
+
+        // Pool of the calling worker thread, nullptr elsewhere
+        static ThreadPool* current();
+
+        struct ScheduleAwaitable{
+            ThreadPool* pool;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h){ pool->submit([h]{ h.resume(); }); }
+            void await_resume() const noexcept {}
+        };
+
+        struct SleepAwaitable{
+            ThreadPool* pool;
+            std::chrono::milliseconds delay;
+            bool await_ready() const noexcept { return delay.count() <= 0; }
+            void await_suspend(std::coroutine_handle<> h){ pool->submitAfter(delay, [h]{ h.resume(); }); }
+            void await_resume() const noexcept {}
+        };
+
+        ScheduleAwaitable schedule(){ return ScheduleAwaitable{this}; }
+        SleepAwaitable sleepFor(std::chrono::milliseconds delay){ return SleepAwaitable{this, delay}; }
+
+        // Runs what is already queued, then joins the workers
+        void stop();
+
+        size_t size() const { return workers.size(); }
+        size_t getPendingCount() const { return pending.load(std::memory_order_relaxed); }
+        uint64_t getExecutedCount() const { return executed.load(std::memory_order_relaxed); }
+        uint64_t getStolenCount() const { return stolen.load(std::memory_order_relaxed); }
 };
 
 using ThreadPoolPtr = std::shared_ptr<ThreadPool>;
@@ -3,29 +3,43 @@
 #include "MessageHandler.h"
 #include "MessageThreadHandler.h"
 #include "MessageQueue.h"
+#include "ThreadPool.h"
+#include "ReactorGroup.h"
+#include "Task.h"
 
+// Adapter between the router and the shared executor: dispatch() schedules
+// the command behind earlier requests from the same connection and runs the
+// handler's coroutine on a pool worker. The reply goes to the Responser
+// whenever the coroutine finishes; the connection's next command waits for
+// it, while the worker moves on. Subclasses only decide where the reply goes.
 class BaseThreadHandler{
     protected:
         MessageHandlerPtr message_handler;
-        std::shared_ptr<MessageQueue<HandlerRequestPtr>> request_queue;
+        ThreadPoolPtr executor;
         std::shared_ptr<MessageQueue<HandlerResponsePtr>> response_queue;
-        std::thread worker_thread;
+        ReactorGroupPtr reactor_group;
         std::atomic<bool> running{false};
         std::string handler_name;
-        
+
     protected:
-        virtual void run() = 0;
+        virtual void route(const HandlerRequest& req, HandlerResponse& resp) = 0;
+
+    private:
+        Task<void> process(HandlerRequestPtr req);
 
     public:
         BaseThreadHandler(MessageHandlerPtr message_handler,
-                          std::shared_ptr<MessageQueue<HandlerRequestPtr>> request_queue,
+                          ThreadPoolPtr executor,
                           std::shared_ptr<MessageQueue<HandlerResponsePtr>> response_queue,
-                          const std::string& handler_name);
+                          const std::string& handler_name,
+                          ReactorGroupPtr reactor_group = nullptr);
 
         virtual ~BaseThreadHandler();
-        
+
+        void dispatch(HandlerRequestPtr req);
+
         void start();
         void stop();
 };
 
-using BaseThreadHandlerPtr = std::shared_ptr<BaseThreadHandler>;
\ No newline at end of file
+using BaseThreadHandlerPtr = std::shared_ptr<BaseThreadHandler>;
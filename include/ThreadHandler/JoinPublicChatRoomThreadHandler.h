@@ -7,15 +7,12 @@
 #include "Logger.h"
 
 class JoinPublicChatThreadHandler : public BaseThreadHandler{
-    private:
-        std::shared_ptr<JoinPublicChatHandler> join_handler;
-        
     protected:
-        void run() override;
+        void route(const HandlerRequest& req, HandlerResponse& resp) override;
         
     public:
         JoinPublicChatThreadHandler(std::shared_ptr<JoinPublicChatHandler> handler,
-                                    std::shared_ptr<MessageQueue<HandlerRequestPtr>> req_queue,
+                                    ThreadPoolPtr executor,
                                     std::shared_ptr<MessageQueue<HandlerResponsePtr>> resp_queue);
 };
 
@@ -7,15 +7,12 @@
 #include "Logger.h"
 
 class LeavePublicChatThreadHandler : public BaseThreadHandler{
-    private:
-        std::shared_ptr<LeavePublicChatHandler> leave_handler;
-        
     protected:
-        void run() override;
+        void route(const HandlerRequest& req, HandlerResponse& resp) override;
         
     public:
         LeavePublicChatThreadHandler(std::shared_ptr<LeavePublicChatHandler> handler,
-                                     std::shared_ptr<MessageQueue<HandlerRequestPtr>> req_queue,
+                                     ThreadPoolPtr executor,
                                      std::shared_ptr<MessageQueue<HandlerResponsePtr>> resp_queue);
 };
 
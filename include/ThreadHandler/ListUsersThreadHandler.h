@@ -4,21 +4,18 @@
 #include "ListUsersHandler.h"
 #include "MessageQueue.h"
 #include "MessageThreadHandler.h"
-#include "Epoll.h"
+#include "ReactorGroup.h"
 #include "Logger.h"
 
 class ListUsersThreadHandler : public BaseThreadHandler{
-    private:
-        std::shared_ptr<ListUsersHandler> list_users_handler;
-        std::shared_ptr<EpollInstance> epoll_instance;
     protected:
-        void run() override;
+        void route(const HandlerRequest& req, HandlerResponse& resp) override;
 
     public:
         ListUsersThreadHandler(std::shared_ptr<ListUsersHandler> handler,
-                               std::shared_ptr<MessageQueue<HandlerRequestPtr>> req_queue,
+                               ThreadPoolPtr executor,
                                std::shared_ptr<MessageQueue<HandlerResponsePtr>> resp_queue,
-                               std::shared_ptr<EpollInstance> epoll_instance);
+                               ReactorGroupPtr reactor_group);
 };
 
 using ListUsersHandlerThreadPtr = std::shared_ptr<ListUsersThreadHandler>;
\ No newline at end of file
@@ -7,15 +7,12 @@
 #include "Logger.h"
 
 class LoginChatThreadHandler : public BaseThreadHandler{
-    private:
-        std::shared_ptr<LoginChatHandler> login_handler;
-        
     protected:
-        void run() override;
+        void route(const HandlerRequest& req, HandlerResponse& resp) override;
         
     public:
         LoginChatThreadHandler(std::shared_ptr<LoginChatHandler> handler,
-                          std::shared_ptr<MessageQueue<HandlerRequestPtr>> req_queue,
+                          ThreadPoolPtr executor,
                           std::shared_ptr<MessageQueue<HandlerResponsePtr>> resp_queue);
 };
 
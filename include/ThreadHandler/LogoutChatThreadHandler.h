@@ -7,15 +7,12 @@
 #include "Logger.h"
 
 class LogoutChatThreadHandler : public BaseThreadHandler{
-    private:
-        std::shared_ptr<LogoutChatHandler> logout_handler;
-        
     protected:
-        void run() override;
+        void route(const HandlerRequest& req, HandlerResponse& resp) override;
         
     public:
         LogoutChatThreadHandler(std::shared_ptr<LogoutChatHandler> handler,
-                                std::shared_ptr<MessageQueue<HandlerRequestPtr>> req_queue,
+                                ThreadPoolPtr executor,
                                 std::shared_ptr<MessageQueue<HandlerResponsePtr>> resp_queue);
 };
 
@@ -4,21 +4,18 @@
 #include "PrivateChatHandler.h"
 #include "MessageQueue.h"
 #include "MessageThreadHandler.h"
-#include "Epoll.h"
+#include "ReactorGroup.h"
 #include "Logger.h"
 
 class PrivateChatThreadHandler : public BaseThreadHandler{
-    private:
-        std::shared_ptr<PrivateChatHandler> private_chat_handler;
-        std::shared_ptr<EpollInstance> epoll_instance;
     protected:
-        void run() override;
+        void route(const HandlerRequest& req, HandlerResponse& resp) override;
 
     public:
         PrivateChatThreadHandler(std::shared_ptr<PrivateChatHandler> handler,
-                                 std::shared_ptr<MessageQueue<HandlerRequestPtr>> req_queue,
+                                 ThreadPoolPtr executor,
                                  std::shared_ptr<MessageQueue<HandlerResponsePtr>> resp_queue,
-                                 std::shared_ptr<EpollInstance> epoll_instance);
+                                 ReactorGroupPtr reactor_group);
 };
 
 using PrivateChatHandlerThreadPtr = std::shared_ptr<PrivateChatThreadHandler>;
\ No newline at end of file
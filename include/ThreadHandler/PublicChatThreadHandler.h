@@ -8,15 +8,12 @@
 #include "Logger.h"
 
 class PublicChatThreadHandler : public BaseThreadHandler{
-    private:
-        std::shared_ptr<PublicChatHandler> public_chat_handler;
-        
     protected:
-        void run() override;
+        void route(const HandlerRequest& req, HandlerResponse& resp) override;
         
     public:
         PublicChatThreadHandler(std::shared_ptr<PublicChatHandler> handler,
-                                std::shared_ptr<MessageQueue<HandlerRequestPtr>> req_queue,
+                                ThreadPoolPtr executor,
                                 std::shared_ptr<MessageQueue<HandlerResponsePtr>> resp_queue);
 };
 
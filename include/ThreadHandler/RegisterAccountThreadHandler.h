@@ -5,15 +5,12 @@
 #include "MessageHandler.h"
 
 class RegisterAccountThreadHandler : public BaseThreadHandler{
-    private:
-        std::shared_ptr<RegisterAccountHandler> register_account_handler;
-        
     protected:
-        void run() override;
+        void route(const HandlerRequest& req, HandlerResponse& resp) override;
         
     public:
         RegisterAccountThreadHandler(std::shared_ptr<RegisterAccountHandler> handler,
-                                std::shared_ptr<MessageQueue<HandlerRequestPtr>> req_queue,
+                                ThreadPoolPtr executor,
                                 std::shared_ptr<MessageQueue<HandlerResponsePtr>> resp_queue);
 };
 
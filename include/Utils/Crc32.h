@@ -0,0 +1,32 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli), table-driven. crc32c(data, n, crc32c(prefix, m))
+// continues a running checksum over prefix then data.
+namespace Crc32{
+    constexpr std::array<uint32_t, 256> makeTable(){
+        std::array<uint32_t, 256> table{};
+        for(uint32_t i = 0; i < 256; i++){
+            uint32_t crc = i;
+            for(int bit = 0; bit < 8; bit++){
+                crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78u : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+
+    inline constexpr std::array<uint32_t, 256> TABLE = makeTable();
+
+    inline uint32_t crc32c(const void* data, size_t length, uint32_t previous = 0){
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        uint32_t crc = ~previous;
+        for(size_t i = 0; i < length; i++){
+            crc = TABLE[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+}
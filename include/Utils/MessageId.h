@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Message ids are plain 64-bit counters inside the server and in the
+// database. Only the wire uses text: "MSG_" and ten zero-padded digits,
+// e.g. MSG_0000000042, which is what clients validate and echo back in
+// "ACK|MSG_0000000042".
+using MessageId = uint64_t;
+
+struct MessageIdRange{
+    MessageId first;
+    MessageId last;     // inclusive
+};
+
+class MessageIdFormat{
+    public:
+        static constexpr size_t DIGITS = 10;
+        static constexpr size_t WIDTH = 4 + DIGITS;
+
+        // Writes exactly WIDTH chars; ids wrap at 10^DIGITS on the wire
+        static void write(MessageId id, char* out){
+            std::memcpy(out, "MSG_", 4);
+            for(size_t i = WIDTH; i > 4; i--){
+                out[i - 1] = static_cast<char>('0' + id % 10);
+                id /= 10;
+            }
+        }
+
+        static std::string toString(MessageId id){
+            std::string text(WIDTH, '\0');
+            write(id, text.data());
+            return text;
+        }
+
+        // "MSG_<id>|<content>\n" in one allocation
+        static std::string frame(MessageId id, std::string_view content){
+            std::string framed(WIDTH + 1 + content.size() + 1, '\0');
+            write(id, framed.data());
+            framed[WIDTH] = '|';
+            std::memcpy(framed.data() + WIDTH + 1, content.data(), content.size());
+            framed.back() = '\n';
+            return framed;
+        }
+
+        static std::optional<MessageId> parse(std::string_view text){
+            if(text.size() != WIDTH || text.compare(0, 4, "MSG_") != 0){
+                return std::nullopt;
+            }
+            MessageId id = 0;
+            for(size_t i = 4; i < WIDTH; i++){
+                unsigned digit = static_cast<unsigned char>(text[i]) - '0';
+                if(digit > 9) return std::nullopt;
+                id = id * 10 + digit;
+            }
+            return id;
+        }
+
+        // Batched ACK payload: ids and inclusive ranges separated by commas,
+        // e.g. "MSG_0000000042-MSG_0000000045,MSG_0000000050"
+        static void appendRange(std::string& out, const MessageIdRange& range){
+            if(!out.empty()) out += ',';
+            size_t at = out.size();
+            out.resize(at + WIDTH);
+            write(range.first, out.data() + at);
+            if(range.last != range.first){
+                out += '-';
+                at = out.size();
+                out.resize(at + WIDTH);
+                write(range.last, out.data() + at);
+            }
+        }
+
+        static bool parseList(std::string_view text, std::vector<MessageIdRange>& ranges){
+            while(!text.empty()){
+                size_t comma = text.find(',');
+                std::string_view item = text.substr(0, comma);
+                text = comma == std::string_view::npos ? std::string_view() : text.substr(comma + 1);
+
+                size_t dash = item.find('-');
+                auto first = parse(item.substr(0, dash));
+                auto last = dash == std::string_view::npos ? first : parse(item.substr(dash + 1));
+                if(!first || !last || *last < *first){
+                    return false;
+                }
+                ranges.push_back(MessageIdRange{*first, *last});
+            }
+            return true;
+        }
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <type_traits>
+
+// Lazily started coroutine producing a T. Awaiting a Task from another
+// coroutine runs it and resumes the awaiter when it finishes (symmetric
+// transfer, no extra thread hop). start() runs a top-level Task detached and
+// reports the outcome through callbacks; whichever thread completes the last
+// awaited operation runs them.
+template<typename T = void>
+class Task;
+
+namespace TaskDetail{
+    struct FinalAwaiter{
+        bool await_ready() noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept{
+            auto continuation = h.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    struct PromiseBase{
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+    };
+
+    template<typename T>
+    struct Promise : PromiseBase{
+        std::optional<T> value;
+
+        Task<T> get_return_object() noexcept;
+
+        template<typename U>
+        void return_value(U&& v){
+            value.emplace(std::forward<U>(v));
+        }
+
+        T result(){
+            if(error) std::rethrow_exception(error);
+            return std::move(*value);
+        }
+    };
+
+    template<>
+    struct Promise<void> : PromiseBase{
+        Task<void> get_return_object() noexcept;
+
+        void return_void() noexcept {}
+
+        void result(){
+            if(error) std::rethrow_exception(error);
+        }
+    };
+
+    // Frame that starts eagerly and frees itself when done
+    struct Detached{
+        struct promise_type{
+            Detached get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+}
+
+template<typename T>
+class [[nodiscard]] Task{
+    public:
+        using promise_type = TaskDetail::Promise<T>;
+        using Handle = std::coroutine_handle<promise_type>;
+
+    private:
+        Handle handle;
+
+        struct Awaiter{
+            Handle handle;
+
+            bool await_ready() noexcept { return !handle || handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept{
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume(){ return handle.promise().result(); }
+        };
+
+        template<typename Done, typename Fail>
+        static TaskDetail::Detached drive(Task task, Done done, Fail fail){
+            std::exception_ptr error;
+            if constexpr (std::is_void_v<T>){
+                try{
+                    co_await std::move(task);
+                }
+                catch(...){
+                    error = std::current_exception();
+                }
+                if(!error){
+                    done();
+                    co_return;
+                }
+            }
+            else{
+                std::optional<T> value;
+                try{
+                    value.emplace(co_await std::move(task));
+                }
+                catch(...){
+                    error = std::current_exception();
+                }
+                if(!error){
+                    done(std::move(*value));
+                    co_return;
+                }
+            }
+            fail(error);
+        }
+
+    public:
+        explicit Task(Handle handle) noexcept : handle(handle) {}
+        Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        Task& operator=(Task&& other) noexcept{
+            if(this != &other){
+                if(handle) handle.destroy();
+                handle = std::exchange(other.handle, nullptr);
+            }
+            return *this;
+        }
+
+        ~Task(){
+            if(handle) handle.destroy();
+        }
+
+        Awaiter operator co_await() && noexcept { return Awaiter{handle}; }
+
+        // done(T) or done() on success, fail(std::exception_ptr) otherwise
+        template<typename Done, typename Fail>
+        void start(Done done, Fail fail) &&{
+            drive(std::move(*this), std::move(done), std::move(fail));
+        }
+};
+
+namespace TaskDetail{
+    template<typename T>
+    Task<T> Promise<T>::get_return_object() noexcept{
+        return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+    }
+
+    inline Task<void> Promise<void>::get_return_object() noexcept{
+        return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+    }
+}
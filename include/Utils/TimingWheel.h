@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <vector>
+
+// Hashed timing wheel: slots of `tick` each, a timer goes into the slot of
+// its deadline and carries the number of full turns still to wait. advance()
+// only visits the slots whose tick has passed, so its cost follows the
+// timers due (plus those sharing their slots), not the total scheduled.
+// cancel() is O(1) through the Handle returned by schedule().
+//
+// Not thread-safe; the owner serializes access.
+template<typename Key>
+class TimingWheel{
+    public:
+        using Clock = std::chrono::steady_clock;
+
+    private:
+        struct Timer{
+            Key key;
+            uint64_t rounds;
+        };
+        using Bucket = std::list<Timer>;
+
+    public:
+        class Handle{
+            private:
+                friend class TimingWheel;
+                size_t slot = 0;
+                typename Bucket::iterator position;
+                bool active = false;
+
+            public:
+                bool isActive() const { return active; }
+        };
+
+    private:
+        std::chrono::milliseconds tick;
+        std::vector<Bucket> slots;
+        Clock::time_point origin;
+        uint64_t current_tick = 0;     // next tick to process
+        size_t timer_count = 0;
+
+        uint64_t elapsedTicks(Clock::time_point now) const{
+            if(now <= origin) return 0;
+            return static_cast<uint64_t>((now - origin) / tick);
+        }
+
+    public:
+        TimingWheel(std::chrono::milliseconds tick, size_t slot_count, Clock::time_point now = Clock::now())
+            : tick(tick.count() > 0 ? tick : std::chrono::milliseconds(1)),
+              slots(slot_count > 0 ? slot_count : 1),
+              origin(now) {}
+
+        std::chrono::milliseconds resolution() const { return tick; }
+        size_t size() const { return timer_count; }
+
+        // Fires on the first advance() at or after now + delay, rounded up
+        // to the next tick
+        Handle schedule(const Key& key, std::chrono::milliseconds delay, Clock::time_point now = Clock::now()){
+            auto due = std::chrono::duration_cast<std::chrono::milliseconds>(now - origin) + delay;
+            uint64_t deadline = due.count() <= 0 ? 0 : static_cast<uint64_t>((due + tick - std::chrono::milliseconds(1)) / tick);
+            // Tick k is processed once k + 1 ticks have elapsed
+            deadline = deadline > 0 ? deadline - 1 : 0;
+            if(deadline < current_tick) deadline = current_tick;
+
+            Handle handle;
+            handle.slot = deadline % slots.size();
+            Bucket& bucket = slots[handle.slot];
+            handle.position = bucket.insert(bucket.end(), Timer{key, (deadline - current_tick) / slots.size()});
+            handle.active = true;
+            timer_count++;
+            return handle;
+        }
+
+        void cancel(Handle& handle){
+            if(!handle.active) return;
+            slots[handle.slot].erase(handle.position);
+            handle.active = false;
+            timer_count--;
+        }
+
+        // Appends the keys of every timer now due to expired. Their handles
+        // are dead afterwards; owners must not cancel them.
+        void advance(std::vector<Key>& expired, Clock::time_point now = Clock::now()){
+            uint64_t target = elapsedTicks(now);
+            while(current_tick < target){
+                Bucket& bucket = slots[current_tick % slots.size()];
+                for(auto it = bucket.begin(); it != bucket.end();){
+                    if(it->rounds == 0){
+                        expired.push_back(it->key);
+                        it = bucket.erase(it);
+                        timer_count--;
+                    }
+                    else{
+                        it->rounds--;
+                        ++it;
+                    }
+                }
+                current_tick++;
+            }
+        }
+};
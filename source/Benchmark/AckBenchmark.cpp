@@ -0,0 +1,149 @@
+// The in-memory ACK path of MessageAckManager, with string ids as it was
+// and with integer ids as it is now:
+//   insert  generate an id, frame "MSG_<id>|content\n", add to the map
+//   ack     parse "ACK|MSG_<id>" from the wire, find and erase
+// Both run under a mutex as in MessageAckManager; the database is left out.
+//
+// Usage: ack_bench [messages] [in flight]
+
+#include "MessageId.h"
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Pending{
+    std::chrono::system_clock::time_point send_time;
+    int retry_count = 0;
+    int sender_id = 0;
+    int receiver_id = 0;
+    std::string message_content;
+};
+
+class StringIdPath{
+    private:
+        std::unordered_map<std::string, Pending> pending;
+        std::mutex mtx;
+        std::atomic<uint64_t> counter{0};
+
+    public:
+        std::string send(const std::string& content){
+            uint64_t id = counter.fetch_add(1);
+            std::ostringstream oss;
+            oss << "MSG_" << std::setfill('0') << std::setw(10) << id;
+            std::string msg_id = oss.str();
+            std::string framed = msg_id + "|" + content + "\n";
+
+            std::lock_guard<std::mutex> lock(mtx);
+            Pending& p = pending[msg_id];
+            p.send_time = std::chrono::system_clock::now();
+            p.message_content = content;
+            return framed;
+        }
+
+        bool ack(std::string_view line){
+            std::string_view msg_id = line.substr(4);
+            if(msg_id.length() != 14 || msg_id.compare(0, 4, "MSG_") != 0) return false;
+            for(size_t i = 4; i < 14; ++i){
+                if(!std::isdigit(msg_id[i])) return false;
+            }
+            std::string key(msg_id);
+
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = pending.find(key);
+            if(it == pending.end()) return false;
+            pending.erase(it);
+            return true;
+        }
+};
+
+class IntegerIdPath{
+    private:
+        std::unordered_map<MessageId, Pending> pending;
+        std::mutex mtx;
+        std::atomic<MessageId> counter{0};
+
+    public:
+        std::string send(const std::string& content){
+            MessageId msg_id = counter.fetch_add(1, std::memory_order_relaxed);
+            std::string framed = MessageIdFormat::frame(msg_id, content);
+
+            std::lock_guard<std::mutex> lock(mtx);
+            Pending& p = pending[msg_id];
+            p.send_time = std::chrono::system_clock::now();
+            p.message_content = content;
+            return framed;
+        }
+
+        bool ack(std::string_view line){
+            auto msg_id = MessageIdFormat::parse(line.substr(4));
+            if(!msg_id) return false;
+
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = pending.find(*msg_id);
+            if(it == pending.end()) return false;
+            pending.erase(it);
+            return true;
+        }
+};
+
+struct RunResult{
+    double insert_ns = 0;
+    double ack_ns = 0;
+    int failures = 0;
+};
+
+// Keeps `in_flight` messages outstanding, acking the oldest as it sends
+template<typename Path>
+static RunResult run(int messages, int in_flight){
+    Path path;
+    const std::string content = "[2026-01-01 12:00:00] [Private from alice]: see you at five";
+    std::vector<std::string> acks(in_flight);
+    std::chrono::nanoseconds insert_time{0}, ack_time{0};
+    RunResult result;
+
+    for(int i = 0; i < messages + in_flight; i++){
+        std::string& slot = acks[i % in_flight];
+        if(i >= in_flight){
+            auto start = std::chrono::steady_clock::now();
+            if(!path.ack(slot)) result.failures++;
+            ack_time += std::chrono::steady_clock::now() - start;
+        }
+        if(i < messages){
+            auto start = std::chrono::steady_clock::now();
+            std::string framed = path.send(content);
+            insert_time += std::chrono::steady_clock::now() - start;
+            slot = "ACK|" + framed.substr(0, MessageIdFormat::WIDTH);
+        }
+    }
+
+    result.insert_ns = double(insert_time.count()) / messages;
+    result.ack_ns = double(ack_time.count()) / messages;
+    return result;
+}
+
+int main(int argc, char* argv[]){
+    int messages = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int in_flight = argc > 2 ? std::atoi(argv[2]) : 10000;
+    if(in_flight < 1) in_flight = 1;
+
+    RunResult before = run<StringIdPath>(messages, in_flight);
+    RunResult after = run<IntegerIdPath>(messages, in_flight);
+
+    std::printf("%d messages, %d in flight\n", messages, in_flight);
+    std::printf("%-10s %12s %12s\n", "ids", "insert ns", "ack ns");
+    std::printf("%-10s %12.1f %12.1f\n", "string", before.insert_ns, before.ack_ns);
+    std::printf("%-10s %12.1f %12.1f\n", "integer", after.insert_ns, after.ack_ns);
+    std::printf("%-10s %11.2fx %11.2fx\n", "speedup", before.insert_ns / after.insert_ns, before.ack_ns / after.ack_ns);
+    if(before.failures + after.failures > 0){
+        std::fprintf(stderr, "%d failed acks\n", before.failures + after.failures);
+    }
+    return 0;
+}
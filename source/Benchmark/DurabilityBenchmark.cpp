@@ -0,0 +1,118 @@
+// pending_messages throughput under each DurabilityProfile, straight against
+// DataBaseManager:
+//   inserts/s  ADD_PENDING_MESSAGE, one transaction per message
+//   acks/s     status -> "acknowledged", one transaction per message
+//   grouped/s  insert + ack per message, committed in groups of 64 as the
+//              DB thread does by default
+//
+// Put the database on the disk the server will use; on tmpfs every profile
+// looks the same.
+//
+// Usage: durability_bench [messages] [db directory]
+
+#include "DataBaseManager.h"
+#include "Logger.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <unistd.h>
+
+constexpr int GROUP_SIZE = 64;
+
+struct RunResult{
+    double inserts_per_sec = 0;
+    double acks_per_sec = 0;
+    double grouped_per_sec = 0;
+    int failures = 0;
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void removeDatabase(const std::string& path){
+    for(const char* suffix : {"", "-journal", "-wal", "-shm"}){
+        std::filesystem::remove(path + suffix);
+    }
+}
+
+static RunResult run(const std::string& path, DurabilityProfile profile, int messages){
+    removeDatabase(path);
+    RunResult result;
+
+    DataBaseManager db(path);
+    db.setDurabilityProfile(profile);
+    if(!db.initialize()){
+        std::cerr << "Cannot open " << path << std::endl;
+        result.failures = messages;
+        return result;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < messages; i++){
+        if(!db.addPendingMessage(i, 1, 2, "benchmark private message " + std::to_string(i))){
+            result.failures++;
+        }
+    }
+    result.inserts_per_sec = messages / secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < messages; i++){
+        if(!db.updateMessageStatus(i, "acknowledged")){
+            result.failures++;
+        }
+    }
+    result.acks_per_sec = messages / secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for(int first = 0; first < messages; first += GROUP_SIZE){
+        int last = std::min(first + GROUP_SIZE, messages);
+        db.beginTransaction();
+        for(int i = first; i < last; i++){
+            MessageId msg_id = messages + i;
+            if(!db.addPendingMessage(msg_id, 1, 2, "benchmark private message " + std::to_string(i))){
+                result.failures++;
+            }
+            if(!db.updateMessageStatus(msg_id, "acknowledged")){
+                result.failures++;
+            }
+        }
+        if(!db.commitTransaction()){
+            db.rollbackTransaction();
+            result.failures += last - first;
+        }
+    }
+    result.grouped_per_sec = messages / secondsSince(start);
+
+    return result;
+}
+
+int main(int argc, char* argv[]){
+    int messages = argc > 1 ? std::atoi(argv[1]) : 2000;
+    std::filesystem::path dir = argc > 2 ? std::filesystem::path(argv[2]) : std::filesystem::temp_directory_path();
+
+    auto& logger = Logger::getInstance();
+    logger.setLogLevel(LogLevel::ERROR);
+    logger.setFileOutput(false);
+
+    std::string path = (dir / ("durability_bench_" + std::to_string(getpid()) + ".db")).string();
+    const DurabilityProfile profiles[] = {DurabilityProfile::STRICT, DurabilityProfile::BALANCED, DurabilityProfile::FAST};
+
+    std::printf("%d messages in %s\n", messages, dir.c_str());
+    std::printf("%-10s %12s %12s %12s\n", "profile", "inserts/s", "acks/s", "grouped/s");
+    for(DurabilityProfile profile : profiles){
+        RunResult result = run(path, profile, messages);
+        std::printf("%-10s %12.0f %12.0f %12.0f\n", durabilityProfileName(profile),
+                    result.inserts_per_sec, result.acks_per_sec, result.grouped_per_sec);
+        if(result.failures > 0){
+            std::cerr << "  " << result.failures << " failed writes" << std::endl;
+        }
+    }
+    removeDatabase(path);
+
+    logger.flush();
+    logger.stop();
+    return 0;
+}
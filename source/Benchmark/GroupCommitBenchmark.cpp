@@ -0,0 +1,119 @@
+// Private messages per second through DataBaseThread at several group commit
+// batch sizes. Each message costs what the ACK path writes for it: an
+// ADD_PENDING_MESSAGE when it is sent and an UPDATE_MESSAGE_STATUS to
+// "acknowledged" when the receiver ACKs. Sender threads submit without
+// waiting, as MessageAckManager does; a run ends when every callback has
+// fired, i.e. everything is committed.
+//
+// Usage: group_commit_bench [messages] [senders] [db directory]
+
+#include "DataBaseThread.h"
+#include "Logger.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+struct RunResult{
+    double messages_per_sec = 0;
+    double writes_per_commit = 0;
+    int failures = 0;
+};
+
+static RunResult run(const std::string& path, size_t batch_size, int messages, int senders){
+    std::filesystem::remove(path);
+
+    auto db_thread = std::make_shared<DataBaseThread>(path);
+    db_thread->setGroupCommit(GroupCommitConfig{batch_size, std::chrono::milliseconds(2)});
+    db_thread->start();
+
+    std::atomic<int> completed{0};
+    std::atomic<int> failures{0};
+    auto callback = [&](bool success, std::string&){
+        if(!success) failures.fetch_add(1, std::memory_order_relaxed);
+        completed.fetch_add(1, std::memory_order_release);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for(int s = 0; s < senders; s++){
+        threads.emplace_back([&, s]{
+            for(int i = s; i < messages; i += senders){
+                MessageId msg_id = i;
+
+                auto add = std::make_shared<DBRequest>();
+                add->type = DBOperationType::ADD_PENDING_MESSAGE;
+                add->message_id = msg_id;
+                add->sender_id = s;
+                add->receiver_id = (s + 1) % senders;
+                add->message_content = "benchmark private message " + std::to_string(i);
+                add->callback = callback;
+                db_thread->submitRequest(add);
+
+                auto ack = std::make_shared<DBRequest>();
+                ack->type = DBOperationType::UPDATE_MESSAGE_STATUS;
+                ack->message_id = msg_id;
+                ack->status = "acknowledged";
+                ack->callback = callback;
+                db_thread->submitRequest(ack);
+            }
+        });
+    }
+    for(auto& t : threads){
+        t.join();
+    }
+    while(completed.load(std::memory_order_acquire) < messages * 2){
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    RunResult result;
+    result.messages_per_sec = messages / seconds;
+    uint64_t commits = db_thread->getCommitCount();
+    result.writes_per_commit = commits ? double(db_thread->getGroupedWriteCount()) / commits : 0;
+    result.failures = failures.load();
+
+    db_thread->stop();
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-journal");
+    return result;
+}
+
+int main(int argc, char* argv[]){
+    int messages = argc > 1 ? std::atoi(argv[1]) : 5000;
+    int senders = argc > 2 ? std::atoi(argv[2]) : 4;
+    std::filesystem::path dir = argc > 3 ? std::filesystem::path(argv[3]) : std::filesystem::temp_directory_path();
+    if(senders < 1) senders = 1;
+
+    auto& logger = Logger::getInstance();
+    logger.setLogLevel(LogLevel::ERROR);
+    logger.setFileOutput(false);
+
+    std::string path = (dir / ("group_commit_bench_" + std::to_string(getpid()) + ".db")).string();
+    const size_t batch_sizes[] = {1, 8, 32, 128};
+
+    std::printf("%d messages, %d senders\n", messages, senders);
+    std::printf("%-10s %12s %14s %10s\n", "batch", "messages/s", "writes/commit", "speedup");
+
+    double baseline = 0;
+    for(size_t batch_size : batch_sizes){
+        RunResult result = run(path, batch_size, messages, senders);
+        if(baseline == 0) baseline = result.messages_per_sec;
+        std::printf("%-10zu %12.0f %14.1f %9.2fx\n", batch_size, result.messages_per_sec,
+                    result.writes_per_commit, result.messages_per_sec / baseline);
+        if(result.failures > 0){
+            std::cerr << "  " << result.failures << " failed writes" << std::endl;
+        }
+    }
+
+    logger.flush();
+    logger.stop();
+    return 0;
+}
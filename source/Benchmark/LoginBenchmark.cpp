@@ -0,0 +1,125 @@
+// Logins per second through DataBaseThread, the way LoginChatHandler sends
+// them: one AUTHENTICATE_USER request per login, submitted without waiting.
+// The reply is the user id, and the last_login stamp is queued to the
+// writer as TOUCH_LAST_LOGIN. Four setups:
+//   uncached  as writer, but every statement prepared and finalized per call
+//   writer    no read connections, no credential cache: the writer serves all
+//   readers   the read-only connection pool, no credential cache
+//   cached    the pool plus the credential cache, already warm
+//
+// uncached against writer is the prepared statement cache on its own.
+//
+// Each run logs every user in once. It ends when the last reply arrives;
+// the queued last_login stamps are drained when the thread stops.
+//
+// Usage: login_bench [users] [readers]
+
+#include "DataBaseThread.h"
+#include "Logger.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+struct Setup{
+    const char* name;
+    size_t readers;
+    bool cache;
+    bool statements;
+};
+
+static void loginAll(DataBaseThread& db_thread, int users, std::atomic<int>& failures){
+    std::atomic<int> done{0};
+    for(int i = 0; i < users; i++){
+        auto req = std::make_shared<DBRequest>();
+        req->type = DBOperationType::AUTHENTICATE_USER;
+        req->username = "bench_" + std::to_string(i);
+        req->password = "password123";
+        req->callback = [&](bool success, std::string&){
+            if(!success) failures.fetch_add(1, std::memory_order_relaxed);
+            done.fetch_add(1, std::memory_order_release);
+        };
+        db_thread.submitRequest(req);
+    }
+    while(done.load(std::memory_order_acquire) < users){
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+static double run(const std::string& path, int users, const Setup& setup){
+    DataBaseThread db_thread(path);
+    db_thread.setReaderCount(setup.readers);
+    CredentialCacheConfig cache;
+    if(!setup.cache){
+        cache.capacity = 0;
+    }
+    db_thread.setCredentialCache(cache);
+    db_thread.setStatementCaching(setup.statements);
+    db_thread.start();
+
+    std::atomic<int> failures{0};
+    if(setup.cache){
+        loginAll(db_thread, users, failures);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    loginAll(db_thread, users, failures);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    db_thread.stop();
+
+    if(failures.load() > 0){
+        std::cerr << "  " << setup.name << ": " << failures.load() << " failed logins" << std::endl;
+    }
+    return users / seconds;
+}
+
+int main(int argc, char* argv[]){
+    int users = argc > 1 ? std::atoi(argv[1]) : 2000;
+    size_t readers = argc > 2 ? std::atoi(argv[2]) : 2;
+    if(users < 1) users = 1;
+
+    auto& logger = Logger::getInstance();
+    logger.setLogLevel(LogLevel::ERROR);
+    logger.setFileOutput(false);
+
+    std::string path = (std::filesystem::temp_directory_path() / ("login_bench_" + std::to_string(getpid()) + ".db")).string();
+    {
+        DataBaseManager db(path);
+        if(!db.initialize()){
+            std::cerr << "Cannot open " << path << std::endl;
+            return 1;
+        }
+        std::cout << "Registering " << users << " users..." << std::endl;
+        db.beginTransaction();
+        for(int i = 0; i < users; i++){
+            db.registerUser("bench_" + std::to_string(i), "password123");
+        }
+        db.commitTransaction();
+    }
+
+    const Setup setups[] = {
+        {"uncached", 0, false, false},
+        {"writer", 0, false, true},
+        {"readers", readers, false, true},
+        {"cached", readers, true, true},
+    };
+    double baseline = 0;
+    std::printf("%-10s %12s %10s\n", "setup", "logins/s", "speedup");
+    for(const Setup& setup : setups){
+        double rate = run(path, users, setup);
+        if(baseline == 0) baseline = rate;
+        std::printf("%-10s %12.0f %9.2fx\n", setup.name, rate, rate / baseline);
+    }
+
+    for(const char* suffix : {"", "-journal", "-wal", "-shm"}){
+        std::filesystem::remove(path + suffix);
+    }
+
+    logger.flush();
+    logger.stop();
+    return 0;
+}
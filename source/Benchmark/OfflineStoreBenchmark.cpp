@@ -0,0 +1,196 @@
+// The offline message path through each OfflineMessageStore backend: SQLite
+// pending_messages behind DataBaseThread, and the segmented append-only log.
+//   append   every message stored, as addPendingMessage does
+//   replay   the first replay page (64) of every receiver, as at login
+//   ack      every message acknowledged in batches of 64, as batched ACKs are
+// Calls are submitted without waiting, as MessageAckManager does; a phase
+// ends when its last callback has fired. Disk use is taken after append and
+// after ack, once acknowledged log segments are reclaimed.
+//
+// Usage: offline_store_bench [messages] [receivers] [db directory] [strict]
+//   strict   fsync per commit / per log batch instead of the balanced profile
+
+#include "SqliteOfflineStore.h"
+#include "SegmentedLogStore.h"
+#include "Logger.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+constexpr size_t PAGE_SIZE = 64;
+constexpr size_t ACK_BATCH = 64;
+
+struct PhaseResult{
+    double seconds = 0;
+    size_t operations = 0;
+};
+
+struct RunResult{
+    PhaseResult append;
+    PhaseResult replay;
+    PhaseResult ack;
+    uint64_t bytes_after_append = 0;
+    uint64_t bytes_after_ack = 0;
+    int failures = 0;
+};
+
+class Completion{
+    private:
+        std::atomic<size_t> done{0};
+        std::atomic<int>& failures;
+
+    public:
+        explicit Completion(std::atomic<int>& failures) : failures(failures) {}
+
+        void finish(bool success){
+            if(!success) failures.fetch_add(1, std::memory_order_relaxed);
+            done.fetch_add(1, std::memory_order_release);
+        }
+
+        void waitFor(size_t expected){
+            while(done.load(std::memory_order_acquire) < expected){
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint64_t diskUsage(const std::filesystem::path& path){
+    std::error_code ec;
+    if(std::filesystem::is_directory(path, ec)){
+        uint64_t total = 0;
+        for(const auto& file : std::filesystem::directory_iterator(path, ec)){
+            total += file.file_size(ec);
+        }
+        return total;
+    }
+    uint64_t total = 0;
+    for(const char* suffix : {"", "-wal"}){
+        auto size = std::filesystem::file_size(path.string() + suffix, ec);
+        if(!ec) total += size;
+    }
+    return total;
+}
+
+static RunResult run(OfflineMessageStore& store, const std::filesystem::path& footprint, int messages, int receivers){
+    RunResult result;
+    std::atomic<int> failures{0};
+    const std::string content = "[2026-01-01 12:00:00] [Private from alice]: see you at five, usual place";
+
+    Completion appended(failures);
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < messages; i++){
+        store.append(i, 0, i % receivers, content, [&](bool success, std::string&){ appended.finish(success); });
+    }
+    appended.waitFor(messages);
+    result.append = PhaseResult{secondsSince(start), static_cast<size_t>(messages)};
+    result.bytes_after_append = diskUsage(footprint);
+
+    Completion paged(failures);
+    std::atomic<size_t> replayed{0};
+    start = std::chrono::steady_clock::now();
+    for(int r = 0; r < receivers; r++){
+        OfflinePage page;
+        page.receiver_id = r;
+        page.limit = PAGE_SIZE;
+        store.fetchPage(std::move(page), [&](bool success, OfflinePage& loaded){
+            replayed.fetch_add(loaded.messages.size(), std::memory_order_relaxed);
+            paged.finish(success);
+        });
+    }
+    paged.waitFor(receivers);
+    result.replay = PhaseResult{secondsSince(start), replayed.load()};
+
+    Completion acked(failures);
+    size_t batches = 0;
+    start = std::chrono::steady_clock::now();
+    for(int first = 0; first < messages; first += ACK_BATCH){
+        std::vector<MessageId> ids;
+        for(int i = first; i < messages && i < first + static_cast<int>(ACK_BATCH); i++){
+            ids.push_back(i);
+        }
+        store.updateStatus(std::move(ids), "acknowledged", [&](bool success, std::string&){ acked.finish(success); });
+        batches++;
+    }
+    acked.waitFor(batches);
+    result.ack = PhaseResult{secondsSince(start), static_cast<size_t>(messages)};
+    result.bytes_after_ack = diskUsage(footprint);
+
+    result.failures = failures.load();
+    return result;
+}
+
+static void report(const char* name, const RunResult& r){
+    auto rate = [](const PhaseResult& p){ return p.seconds > 0 ? p.operations / p.seconds : 0.0; };
+    std::printf("%-8s %12.0f %12.0f %12.0f %10.1f %10.1f\n", name, rate(r.append), rate(r.replay), rate(r.ack),
+                r.bytes_after_append / 1048576.0, r.bytes_after_ack / 1048576.0);
+    if(r.failures > 0){
+        std::fprintf(stderr, "%s: %d failed calls\n", name, r.failures);
+    }
+}
+
+int main(int argc, char* argv[]){
+    int messages = argc > 1 ? std::atoi(argv[1]) : 200000;
+    int receivers = argc > 2 ? std::atoi(argv[2]) : 1000;
+    std::filesystem::path dir = argc > 3 ? std::filesystem::path(argv[3]) : std::filesystem::temp_directory_path();
+    bool strict = argc > 4 && std::strcmp(argv[4], "strict") == 0;
+    if(receivers < 1) receivers = 1;
+
+    auto& logger = Logger::getInstance();
+    logger.setLogLevel(LogLevel::ERROR);
+    logger.setFileOutput(false);
+
+    std::string base = "offline_store_bench_" + std::to_string(getpid());
+    std::filesystem::path db_path = dir / (base + ".db");
+    std::filesystem::path log_dir = dir / (base + "_log");
+    auto cleanup = [&]{
+        for(const char* suffix : {"", "-journal", "-wal", "-shm"}){
+            std::filesystem::remove(db_path.string() + suffix);
+        }
+        std::filesystem::remove_all(log_dir);
+    };
+    cleanup();
+
+    std::printf("%d messages for %d receivers in %s, %s\n", messages, receivers, dir.c_str(), strict ? "strict" : "balanced");
+    std::printf("%-8s %12s %12s %12s %10s %10s\n", "store", "append/s", "replay/s", "ack/s", "MiB", "MiB acked");
+
+    {
+        auto db_thread = std::make_shared<DataBaseThread>(db_path.string());
+        db_thread->setDurabilityProfile(strict ? DurabilityProfile::STRICT : DurabilityProfile::BALANCED);
+        db_thread->start();
+        SqliteOfflineStore store(db_thread);
+        report(store.name(), run(store, db_path, messages, receivers));
+        db_thread->stop();
+    }
+    {
+        SegmentedLogConfig config;
+        config.directory = log_dir;
+        config.segment_bytes = 8ull << 20;
+        config.sync_writes = strict;
+        SegmentedLogStore store(config);
+        if(!store.start()){
+            std::cerr << "Cannot open " << log_dir << std::endl;
+            cleanup();
+            return 1;
+        }
+        report(store.name(), run(store, log_dir, messages, receivers));
+        auto stats = store.getStats();
+        std::printf("         %llu segments reclaimed, %llu left\n",
+                    static_cast<unsigned long long>(stats.reclaimed_segments), static_cast<unsigned long long>(stats.segments));
+        store.stop();
+    }
+
+    cleanup();
+    logger.flush();
+    logger.stop();
+    return 0;
+}
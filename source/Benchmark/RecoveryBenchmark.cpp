@@ -0,0 +1,152 @@
+// Startup recovery of pending_messages, on a table left behind by a crash:
+// half the rows 'pending', a third 'sent' (in flight when the process died),
+// the rest 'acknowledged'.
+//   load       every undelivered row read into memory and indexed by id,
+//              as rebuilding the ACK map from the table would
+//   recover    DataBaseManager::recoverPendingMessages: last message id and
+//              the undelivered count, what the server does at startup; it
+//              loads no rows, so its rate is of rows counted
+//   page       the first replay page of one user's backlog at login
+//
+// Usage: recovery_bench [rows] [receivers] [db directory]
+
+#include "DataBaseManager.h"
+#include "Logger.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <unistd.h>
+#include <unordered_map>
+
+constexpr int INSERT_BATCH = 10000;
+constexpr size_t REPLAY_PAGE = 64;
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void removeDatabase(const std::string& path){
+    for(const char* suffix : {"", "-journal", "-wal", "-shm"}){
+        std::filesystem::remove(path + suffix);
+    }
+}
+
+static bool populate(DataBaseManager& db, int rows, int receivers){
+    std::vector<MessageId> sent, acknowledged;
+    for(int first = 0; first < rows; first += INSERT_BATCH){
+        int last = std::min(first + INSERT_BATCH, rows);
+        sent.clear();
+        acknowledged.clear();
+
+        db.beginTransaction();
+        for(int i = first; i < last; i++){
+            MessageId msg_id = i;
+            if(!db.addPendingMessage(msg_id, 1, i % receivers, "[2026-01-01 12:00:00] [Private from alice]: message " + std::to_string(i))){
+                db.rollbackTransaction();
+                return false;
+            }
+            if(i % 6 >= 4) sent.push_back(msg_id);
+            else if(i % 6 == 3) acknowledged.push_back(msg_id);
+        }
+        db.updateMessageStatus(sent, "sent");
+        db.updateMessageStatus(acknowledged, "acknowledged");
+        if(!db.commitTransaction()){
+            db.rollbackTransaction();
+            return false;
+        }
+    }
+    return true;
+}
+
+// What loading the table into the ACK manager would take
+static size_t loadAll(const std::string& path){
+    sqlite3* db = nullptr;
+    if(sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK){
+        sqlite3_close(db);
+        return 0;
+    }
+
+    std::unordered_map<MessageId, PendingMessageRecord> loaded;
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db,
+        "SELECT id, message_id, sender_id, receiver_id, message_content, status, "
+        "created_at, last_retry_at, retry_count FROM pending_messages "
+        "WHERE status IN ('pending', 'sent');", -1, &stmt, nullptr);
+    while(stmt && sqlite3_step(stmt) == SQLITE_ROW){
+        PendingMessageRecord rec;
+        rec.id = sqlite3_column_int64(stmt, 0);
+        rec.message_id = static_cast<MessageId>(sqlite3_column_int64(stmt, 1));
+        rec.sender_id = sqlite3_column_int(stmt, 2);
+        rec.receiver_id = sqlite3_column_int(stmt, 3);
+        rec.message_content = (const char*)sqlite3_column_text(stmt, 4);
+        rec.status = (const char*)sqlite3_column_text(stmt, 5);
+        rec.created_at = (const char*)sqlite3_column_text(stmt, 6);
+        rec.last_retry_at = (const char*)sqlite3_column_text(stmt, 7);
+        rec.retry_count = sqlite3_column_int(stmt, 8);
+        loaded.emplace(rec.message_id, std::move(rec));
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return loaded.size();
+}
+
+// recover only counts rows, so its rate is not comparable with the loads
+static void report(const char* name, double seconds, size_t rows, const char* unit){
+    std::printf("%-10s %10.1f ms %12.0f %s\n", name, seconds * 1000, seconds > 0 ? rows / seconds : 0.0, unit);
+}
+
+int main(int argc, char* argv[]){
+    int rows = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int receivers = argc > 2 ? std::atoi(argv[2]) : 10000;
+    std::filesystem::path dir = argc > 3 ? std::filesystem::path(argv[3]) : std::filesystem::temp_directory_path();
+    if(receivers < 1) receivers = 1;
+
+    auto& logger = Logger::getInstance();
+    logger.setLogLevel(LogLevel::ERROR);
+    logger.setFileOutput(false);
+
+    std::string path = (dir / ("recovery_bench_" + std::to_string(getpid()) + ".db")).string();
+    removeDatabase(path);
+
+    DataBaseManager db(path);
+    if(!db.initialize()){
+        std::cerr << "Cannot open " << path << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if(!populate(db, rows, receivers)){
+        std::cerr << "Failed to populate " << path << std::endl;
+        removeDatabase(path);
+        return 1;
+    }
+    std::printf("%d rows for %d receivers in %s, populated in %.1f s\n", rows, receivers, dir.c_str(), secondsSince(start));
+
+    start = std::chrono::steady_clock::now();
+    size_t loaded = loadAll(path);
+    report("load", secondsSince(start), loaded, "rows loaded/s");
+
+    PendingRecovery recovery;
+    start = std::chrono::steady_clock::now();
+    if(db.recoverPendingMessages(recovery)){
+        report("recover", secondsSince(start), recovery.undelivered, "rows counted/s");
+        std::printf("           %zu undelivered for %zu users, next id %llu\n",
+                    recovery.undelivered, recovery.receivers,
+                    static_cast<unsigned long long>(recovery.last_message_id ? *recovery.last_message_id + 1 : 0));
+    }
+    else{
+        std::cerr << "Recovery failed" << std::endl;
+    }
+
+    start = std::chrono::steady_clock::now();
+    int64_t until = db.getLastPendingMessageRow(receivers / 2);
+    auto page = db.getPendingMessagesForUser(receivers / 2, 0, until, REPLAY_PAGE);
+    report("page", secondsSince(start), page.size(), "rows loaded/s");
+
+    removeDatabase(path);
+    logger.flush();
+    logger.stop();
+    return 0;
+}
@@ -0,0 +1,295 @@
+// Public room broadcasts per second, with the room as it was and as it is
+// now. Before: the fd set copied under the room mutex for every broadcast,
+// then each member's connection looked up through ReactorGroup, which asks
+// every reactor in turn under its handlers_mutex. Now: one snapshot load and
+// a walk over its member array. Each delivery only checks isClosed(), so the
+// figures are the fanout overhead, not socket writes.
+//
+// One more thread joins and leaves extra connections at a fixed rate, as
+// users coming and going; their cost is reported per join+leave pair.
+//
+// A second table times the write side of one broadcast on a single thread:
+// queueing a copy of the message for every member, the way the staged
+// per-connection writes did, against queueing one shared payload that every
+// member's write queue references. Queues are cleared between broadcasts.
+//
+// Usage: room_fanout_bench [members] [milliseconds per run] [max broadcasters] [joins per second]
+
+#include "PublicChatRoom.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+constexpr int REACTORS = 4;
+constexpr int CHURN_CONNECTIONS = 64;
+
+class LockedRoom{
+    private:
+        std::unordered_set<int> participants;
+        std::mutex room_mutex;
+
+    public:
+        void join(ConnectionPtr conn){
+            std::lock_guard<std::mutex> lock(room_mutex);
+            participants.insert(conn->getFd());
+        }
+
+        void leave(int fd){
+            std::lock_guard<std::mutex> lock(room_mutex);
+            participants.erase(fd);
+        }
+
+        std::unordered_set<int> getParticipants(){
+            std::lock_guard<std::mutex> lock(room_mutex);
+            return participants;
+        }
+};
+
+// EpollInstance::connections of each reactor, searched like ReactorGroup::getConnection
+class ConnectionTable{
+    private:
+        struct Reactor{
+            std::mutex handlers_mutex;
+            std::unordered_map<int, ConnectionPtr> connections;
+        };
+        Reactor reactors[REACTORS];
+        int next = 0;
+
+    public:
+        void add(ConnectionPtr conn){
+            Reactor& reactor = reactors[next++ % REACTORS];
+            std::lock_guard<std::mutex> lock(reactor.handlers_mutex);
+            reactor.connections[conn->getFd()] = conn;
+        }
+
+        ConnectionPtr get(int fd){
+            for(auto& reactor : reactors){
+                std::lock_guard<std::mutex> lock(reactor.handlers_mutex);
+                auto it = reactor.connections.find(fd);
+                if(it != reactor.connections.end()){
+                    return it->second;
+                }
+            }
+            return nullptr;
+        }
+};
+
+struct LockedFanout{
+    LockedRoom room;
+    ConnectionTable table;
+
+    void add(ConnectionPtr conn){ table.add(conn); }
+    void join(ConnectionPtr conn){ room.join(conn); }
+    void leave(int fd){ room.leave(fd); }
+
+    size_t broadcast(int exclude_fd){
+        size_t delivered = 0;
+        for(int fd : room.getParticipants()){
+            if(fd == exclude_fd) continue;
+            auto conn = table.get(fd);
+            if(!conn || conn->isClosed()) continue;
+            delivered++;
+        }
+        return delivered;
+    }
+};
+
+struct SnapshotFanout{
+    PublicChatRoom room;
+
+    void add(ConnectionPtr){}
+    void join(ConnectionPtr conn){ room.join(std::move(conn)); }
+    void leave(int fd){ room.leave(fd); }
+
+    size_t broadcast(int exclude_fd){
+        size_t delivered = 0;
+        RoomSnapshotPtr snapshot = room.getParticipants();
+        for(const RoomMember& member : snapshot->members){
+            if(member.fd == exclude_fd) continue;
+            if(member.connection->isClosed()) continue;
+            delivered++;
+        }
+        return delivered;
+    }
+};
+
+struct RunResult{
+    double broadcasts_per_sec = 0;
+    double churn_us = 0;
+    uint64_t short_deliveries = 0;
+};
+
+template<typename Fanout>
+static RunResult run(const std::vector<ConnectionPtr>& members, const std::vector<ConnectionPtr>& churners,
+                     int broadcasters, int joins_per_sec, std::chrono::milliseconds duration){
+    Fanout fanout;
+    for(auto& conn : members){
+        fanout.add(conn);
+        fanout.join(conn);
+    }
+    for(auto& conn : churners){
+        fanout.add(conn);
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> broadcasts{0};
+    std::atomic<uint64_t> short_deliveries{0};
+    double churn_us = 0;
+
+    std::thread churn([&]{
+        auto interval = std::chrono::microseconds(1000000 / std::max(joins_per_sec, 1));
+        auto next = std::chrono::steady_clock::now();
+        std::chrono::duration<double, std::micro> spent{0};
+        uint64_t pairs = 0;
+        while(!stop.load(std::memory_order_relaxed)){
+            const ConnectionPtr& conn = churners[pairs % churners.size()];
+            auto start = std::chrono::steady_clock::now();
+            fanout.join(conn);
+            fanout.leave(conn->getFd());
+            spent += std::chrono::steady_clock::now() - start;
+            pairs++;
+            next += interval;
+            std::this_thread::sleep_until(next);
+        }
+        churn_us = pairs ? spent.count() / pairs : 0;
+    });
+
+    std::vector<std::thread> threads;
+    for(int b = 0; b < broadcasters; b++){
+        threads.emplace_back([&, b]{
+            uint64_t done = 0, short_count = 0;
+            size_t sender = b;
+            while(!stop.load(std::memory_order_relaxed)){
+                int exclude_fd = members[sender++ % members.size()]->getFd();
+                if(fanout.broadcast(exclude_fd) < members.size() - 1) short_count++;
+                done++;
+            }
+            broadcasts.fetch_add(done);
+            short_deliveries.fetch_add(short_count);
+        });
+    }
+
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for(auto& t : threads){
+        t.join();
+    }
+    churn.join();
+
+    RunResult result;
+    result.broadcasts_per_sec = broadcasts.load() / std::chrono::duration<double>(duration).count();
+    result.churn_us = churn_us;
+    result.short_deliveries = short_deliveries.load();
+    return result;
+}
+
+// Responser::stageWrite and flushStagedWrites, one broadcast per batch
+static void queueCopies(const std::vector<ConnectionPtr>& members, const std::string& message){
+    struct StagedWrite{
+        ConnectionPtr conn;
+        std::string data;
+    };
+    std::unordered_map<Connection*, StagedWrite> staged;
+    for(const ConnectionPtr& conn : members){
+        StagedWrite& entry = staged[conn.get()];
+        if(!entry.conn){
+            entry.conn = conn;
+        }
+        entry.data += message;
+    }
+    for(auto& pair : staged){
+        pair.second.conn->queueWrite(std::move(pair.second.data));
+    }
+}
+
+static void queueShared(const std::vector<ConnectionPtr>& members, const std::string& message){
+    auto payload = std::make_shared<const std::string>(message);
+    for(const ConnectionPtr& conn : members){
+        conn->queueWrite(payload);
+    }
+}
+
+template<typename Queue>
+static double timeQueueing(const std::vector<ConnectionPtr>& members, const std::string& message, Queue queue,
+                           std::chrono::milliseconds duration){
+    std::chrono::duration<double, std::micro> spent{0};
+    uint64_t broadcasts = 0;
+    auto end = std::chrono::steady_clock::now() + duration;
+    while(std::chrono::steady_clock::now() < end){
+        auto start = std::chrono::steady_clock::now();
+        queue(members, message);
+        spent += std::chrono::steady_clock::now() - start;
+        broadcasts++;
+        for(const ConnectionPtr& conn : members){
+            conn->clearWriteQueue();
+        }
+    }
+    return spent.count() / broadcasts;
+}
+
+// Real sockets, so the connections close cleanly on the way out
+static std::vector<ConnectionPtr> openConnections(int count){
+    std::vector<ConnectionPtr> connections;
+    for(int i = 0; i < count; i++){
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd < 0){
+            break;
+        }
+        connections.push_back(std::make_shared<Connection>(fd));
+    }
+    return connections;
+}
+
+int main(int argc, char* argv[]){
+    int member_count = argc > 1 ? std::atoi(argv[1]) : 10000;
+    auto duration = std::chrono::milliseconds(argc > 2 ? std::atoi(argv[2]) : 1000);
+    int max_broadcasters = argc > 3 ? std::atoi(argv[3]) : static_cast<int>(std::thread::hardware_concurrency());
+    int joins_per_sec = argc > 4 ? std::atoi(argv[4]) : 100;
+    if(member_count < 2) member_count = 2;
+    if(max_broadcasters < 1) max_broadcasters = 1;
+
+    rlimit limit;
+    if(getrlimit(RLIMIT_NOFILE, &limit) == 0){
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    auto members = openConnections(member_count);
+    auto churners = openConnections(CHURN_CONNECTIONS);
+    if(static_cast<int>(members.size()) < member_count || churners.size() < CHURN_CONNECTIONS){
+        std::fprintf(stderr, "Cannot open %d sockets; raise the open file limit\n", member_count + CHURN_CONNECTIONS);
+        return 1;
+    }
+
+    std::printf("%d members, %d joins and leaves per second, %d reactors, %lld ms per run\n",
+                member_count, joins_per_sec, REACTORS, static_cast<long long>(duration.count()));
+    std::printf("%-13s %14s %14s %9s %14s %14s\n", "broadcasters", "locked bc/s", "snapshot bc/s", "speedup", "locked join us", "snap join us");
+    for(int broadcasters = 1; broadcasters <= max_broadcasters; broadcasters *= 2){
+        RunResult before = run<LockedFanout>(members, churners, broadcasters, joins_per_sec, duration);
+        RunResult after = run<SnapshotFanout>(members, churners, broadcasters, joins_per_sec, duration);
+        std::printf("%-13d %14.0f %14.0f %8.2fx %14.1f %14.1f\n", broadcasters, before.broadcasts_per_sec, after.broadcasts_per_sec,
+                    after.broadcasts_per_sec / before.broadcasts_per_sec, before.churn_us, after.churn_us);
+        if(before.short_deliveries + after.short_deliveries > 0){
+            std::fprintf(stderr, "%llu broadcasts missed a member\n", static_cast<unsigned long long>(before.short_deliveries + after.short_deliveries));
+        }
+    }
+
+    std::printf("\n%-13s %14s %14s %9s\n", "message bytes", "copies us", "shared us", "speedup");
+    for(size_t bytes : {64, 512, 4096}){
+        std::string message(bytes - 1, 'x');
+        message += '\n';
+        double copies = timeQueueing(members, message, queueCopies, duration);
+        double shared = timeQueueing(members, message, queueShared, duration);
+        std::printf("%-13zu %14.1f %14.1f %8.2fx\n", bytes, copies, shared, copies / shared);
+    }
+    return 0;
+}
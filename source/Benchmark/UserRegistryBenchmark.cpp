@@ -0,0 +1,178 @@
+// Lookups per second on the user registry while logins and logouts go on,
+// with the three maps behind one mutex as UserManager was, and with
+// UserManager as it is now. Reader threads repeat what one chat message
+// costs: isLoggedIn and getUsername (PublicChatHandler), getUserId twice
+// (Responser::sendToClient) and getFd (the router). One more thread keeps
+// logging users in and out on other fds.
+//
+// Usage: user_registry_bench [users] [milliseconds per run] [max readers]
+
+#include "UserManager.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class LockedUserManager{
+    private:
+        std::unordered_map<int, std::string> fd_to_username;
+        std::unordered_map<std::string, int> username_to_fd;
+        std::unordered_map<int, int> fd_to_userid;
+        std::mutex user_mutex;
+
+    public:
+        bool loginUser(int fd, std::string& username, int user_id){
+            std::lock_guard<std::mutex> lock(user_mutex);
+            auto it = username_to_fd.find(username);
+            if(it != username_to_fd.end() && it->second != fd){
+                return false;
+            }
+            fd_to_username[fd] = username;
+            username_to_fd[username] = fd;
+            fd_to_userid[fd] = user_id;
+            return true;
+        }
+
+        void logoutUser(int fd){
+            std::lock_guard<std::mutex> lock(user_mutex);
+            auto it = fd_to_username.find(fd);
+            if(it != fd_to_username.end()){
+                username_to_fd.erase(it->second);
+                fd_to_username.erase(it);
+            }
+            fd_to_userid.erase(fd);
+        }
+
+        std::optional<std::string> getUsername(int fd){
+            std::lock_guard<std::mutex> lock(user_mutex);
+            auto it = fd_to_username.find(fd);
+            if(it != fd_to_username.end()) return it->second;
+            return std::nullopt;
+        }
+
+        std::optional<int> getFd(std::string& username){
+            std::lock_guard<std::mutex> lock(user_mutex);
+            auto it = username_to_fd.find(username);
+            if(it != username_to_fd.end()) return it->second;
+            return std::nullopt;
+        }
+
+        std::optional<int> getUserId(int fd){
+            std::lock_guard<std::mutex> lock(user_mutex);
+            auto it = fd_to_userid.find(fd);
+            if(it != fd_to_userid.end()) return it->second;
+            return std::nullopt;
+        }
+
+        bool isLoggedIn(int fd){
+            std::lock_guard<std::mutex> lock(user_mutex);
+            return fd_to_username.find(fd) != fd_to_username.end();
+        }
+};
+
+constexpr int FIRST_FD = 16;
+constexpr int CHURN_USERS = 100;
+constexpr int LOOKUPS_PER_MESSAGE = 5;
+
+struct RunResult{
+    double lookups_per_sec = 0;
+    uint64_t logins = 0;
+    uint64_t misses = 0;
+};
+
+template<typename Registry>
+static RunResult run(int users, int readers, std::chrono::milliseconds duration){
+    Registry registry;
+    std::vector<std::string> names;
+    for(int i = 0; i < users + CHURN_USERS; i++){
+        names.push_back("user" + std::to_string(i));
+    }
+    for(int i = 0; i < users; i++){
+        registry.loginUser(FIRST_FD + i, names[i], i + 1);
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> logins{0};
+
+    std::thread churn([&]{
+        uint64_t count = 0;
+        while(!stop.load(std::memory_order_relaxed)){
+            for(int i = users; i < users + CHURN_USERS; i++){
+                registry.loginUser(FIRST_FD + i, names[i], i + 1);
+            }
+            for(int i = users; i < users + CHURN_USERS; i++){
+                registry.logoutUser(FIRST_FD + i);
+            }
+            count += CHURN_USERS;
+        }
+        logins.store(count);
+    });
+
+    std::vector<std::thread> threads;
+    for(int r = 0; r < readers; r++){
+        threads.emplace_back([&, r]{
+            uint64_t state = 0x9E3779B97F4A7C15ull * (r + 1);
+            uint64_t done = 0, missed = 0;
+            while(!stop.load(std::memory_order_relaxed)){
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                int sender = static_cast<int>(state % users);
+                int receiver = static_cast<int>((state >> 32) % users);
+                int fd = FIRST_FD + sender;
+
+                if(!registry.isLoggedIn(fd)) missed++;
+                auto username = registry.getUsername(fd);
+                auto sender_id = registry.getUserId(fd);
+                auto receiver_id = registry.getUserId(FIRST_FD + receiver);
+                auto target = registry.getFd(names[receiver]);
+                if(!username || !sender_id || !receiver_id || !target) missed++;
+                done++;
+            }
+            messages.fetch_add(done);
+            misses.fetch_add(missed);
+        });
+    }
+
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for(auto& t : threads){
+        t.join();
+    }
+    churn.join();
+
+    RunResult result;
+    result.lookups_per_sec = double(messages.load()) * LOOKUPS_PER_MESSAGE / std::chrono::duration<double>(duration).count();
+    result.logins = logins.load();
+    result.misses = misses.load();
+    return result;
+}
+
+int main(int argc, char* argv[]){
+    int users = argc > 1 ? std::atoi(argv[1]) : 1000;
+    auto duration = std::chrono::milliseconds(argc > 2 ? std::atoi(argv[2]) : 500);
+    int max_readers = argc > 3 ? std::atoi(argv[3]) : static_cast<int>(std::thread::hardware_concurrency());
+    if(users < 1) users = 1;
+    if(max_readers < 1) max_readers = 1;
+
+    std::printf("%d users, %d more logging in and out, %lld ms per run\n", users, CHURN_USERS, static_cast<long long>(duration.count()));
+    std::printf("%-8s %16s %16s %9s\n", "readers", "locked lookup/s", "sharded lookup/s", "speedup");
+    for(int readers = 1; readers <= max_readers; readers *= 2){
+        RunResult before = run<LockedUserManager>(users, readers, duration);
+        RunResult after = run<UserManager>(users, readers, duration);
+        std::printf("%-8d %16.0f %16.0f %8.2fx\n", readers, before.lookups_per_sec, after.lookups_per_sec,
+                    after.lookups_per_sec / before.lookups_per_sec);
+        if(before.misses + after.misses > 0){
+            std::fprintf(stderr, "%llu lookups of logged-in users failed\n", static_cast<unsigned long long>(before.misses + after.misses));
+        }
+    }
+    return 0;
+}
@@ -9,12 +9,20 @@
 #include <chrono>
 #include <sstream>
 #include <unordered_set>
+#include <vector>
+#include <algorithm>
+#include "MessageId.h"
 
 constexpr size_t BUFFER_SIZE = 4096;
+// ACKs are held this long and sent together, consecutive ids as ranges
+constexpr auto ACK_FLUSH_INTERVAL = std::chrono::milliseconds(20);
+constexpr size_t MAX_ACKS_PER_LINE = 64;
 
 std::atomic<bool> running{true};
 std::string message_buffer;
 std::unordered_set<std::string> processed_messages;
+std::vector<MessageId> pending_acks;
+std::chrono::steady_clock::time_point first_pending_ack;
 
 void setNonBlocking(int fd){
     int flags = fcntl(fd, F_GETFL, 0);
@@ -23,9 +31,44 @@ void setNonBlocking(int fd){
     }
 }
 
-void sendAck(int sock, const std::string& msg_id){
-    std::string ack = "ACK|" + msg_id + "\n";
-    send(sock, ack.c_str(), ack.size(), MSG_NOSIGNAL);
+void queueAck(const std::string& msg_id){
+    auto id = MessageIdFormat::parse(msg_id);
+    if(!id) return;
+    if(pending_acks.empty()){
+        first_pending_ack = std::chrono::steady_clock::now();
+    }
+    pending_acks.push_back(*id);
+}
+
+bool acksDue(){
+    return !pending_acks.empty() &&
+           (pending_acks.size() >= MAX_ACKS_PER_LINE || std::chrono::steady_clock::now() - first_pending_ack >= ACK_FLUSH_INTERVAL);
+}
+
+// One "ACK|MSG_a-MSG_b,MSG_c,..." line per MAX_ACKS_PER_LINE ranges
+void flushAcks(int sock){
+    std::sort(pending_acks.begin(), pending_acks.end());
+    pending_acks.erase(std::unique(pending_acks.begin(), pending_acks.end()), pending_acks.end());
+
+    std::string payload;
+    size_t ranges = 0;
+    for(size_t i = 0; i < pending_acks.size();){
+        size_t last = i;
+        while(last + 1 < pending_acks.size() && pending_acks[last + 1] == pending_acks[last] + 1){
+            last++;
+        }
+        MessageIdFormat::appendRange(payload, MessageIdRange{pending_acks[i], pending_acks[last]});
+        ranges++;
+        i = last + 1;
+
+        if(ranges == MAX_ACKS_PER_LINE || i == pending_acks.size()){
+            std::string ack = "ACK|" + payload + "\n";
+            send(sock, ack.c_str(), ack.size(), MSG_NOSIGNAL);
+            payload.clear();
+            ranges = 0;
+        }
+    }
+    pending_acks.clear();
 }
 
 bool isValidMessageId(const std::string& msg_id){
@@ -39,10 +82,10 @@ bool isValidMessageId(const std::string& msg_id){
     return true;
 }
 
-void processMessage(int sock, const std::string& msg_id, const std::string& content){
+void processMessage(const std::string& msg_id, const std::string& content){
     if(processed_messages.count(msg_id)){
         std::cout << "[DEBUG] Duplicate message " << msg_id << ", sending ACK again\n";
-        sendAck(sock, msg_id);
+        queueAck(msg_id);
         return;
     }
     
@@ -58,10 +101,10 @@ void processMessage(int sock, const std::string& msg_id, const std::string& cont
         processed_messages.erase(processed_messages.begin(), it);
     }
     
-    sendAck(sock, msg_id);
+    queueAck(msg_id);
 }
 
-void parseBuffer(int sock){
+void parseBuffer(){
     size_t pos;
     while((pos = message_buffer.find('\n')) != std::string::npos){
         std::string line = message_buffer.substr(0, pos);
@@ -81,7 +124,7 @@ void parseBuffer(int sock){
             continue;
         }
         
-        processMessage(sock, msg_id, content);
+        processMessage(msg_id, content);
     }
 }
 
@@ -94,6 +137,9 @@ void receiveThread(int sock){
         
         if(n < 0){
             if(errno == EAGAIN || errno == EWOULDBLOCK){
+                if(acksDue()){
+                    flushAcks(sock);
+                }
                 std::this_thread::sleep_for(std::chrono::milliseconds(10));
                 continue;
             }
@@ -115,7 +161,10 @@ void receiveThread(int sock){
         
         message_buffer.append(buffer, n);
         
-        parseBuffer(sock);
+        parseBuffer();
+        if(acksDue()){
+            flushAcks(sock);
+        }
     }
 }
 
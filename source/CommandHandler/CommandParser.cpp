@@ -1,5 +1,4 @@
 #include "CommandParser.h"
-#include "PublicChatRoom.h"
 
 static std::vector<std::string> parseArguments(const std::string& input){
     std::vector<std::string> args;
@@ -44,7 +43,8 @@ static std::vector<std::string> parseArguments(const std::string& input){
     return args;
 }
 
-CommandPtr CommandParser::parse(std::string& message, IncomingMessage& incomming, EpollInstancePtr epoll_instance){
+CommandPtr CommandParser::parse(std::string& message, IncomingMessage& incomming, ReactorGroupPtr reactor_group){
+    (void)reactor_group;
     auto cmd = std::make_shared<Command>();
     cmd->raw_message = message;
 
@@ -54,24 +54,14 @@ CommandPtr CommandParser::parse(std::string& message, IncomingMessage& incomming
     }
 
     if(message[0] != '/'){
-        if(!epoll_instance){
+        if(!incomming.connection){
             cmd->type = CommandType::UNKNOWN;
             return cmd;
         }
         
-        auto conn = epoll_instance->getConnection(incomming.fd);
-        if(!conn){
-            cmd->type = CommandType::UNKNOWN;
-            return cmd;
-        }
-        
-        auto& room = PublicChatRoom::getInstance();
-        if(!room.isParticipant(conn->getFd())){
-            cmd->type = CommandType::UNKNOWN;
-        }
-        else{
-            cmd->type = CommandType::PUBLIC_CHAT;
-        }
+        // Room membership is checked by the handler, in order with the
+        // connection's earlier /join or /leave
+        cmd->type = CommandType::PUBLIC_CHAT;
         cmd->args.push_back(message);
         return cmd;
     }
@@ -99,10 +89,7 @@ CommandPtr CommandParser::parse(std::string& message, IncomingMessage& incomming
         cmd->type = CommandType::LOGOUT;
     } 
     else if(command_name == "/list_online_users"){
-        auto conn = epoll_instance->getConnection(incomming.fd);
-
-        auto& room = PublicChatRoom::getInstance();
-        if(!room.isParticipant(conn->getFd())){
+        if(!incomming.connection || !incomming.connection->getSession().inRoom(Session::PUBLIC_CHAT_ROOM)){
             cmd->type = CommandType::LIST_ONLINE_USERS;
         }
         else{
@@ -4,13 +4,13 @@
 
 ChatControllerThread::ChatControllerThread(std::shared_ptr<MessageQueue<Message>> incoming_queue, 
                                            std::shared_ptr<MessageQueue<HandlerResponsePtr>> response_queue,
-                                           EpollInstancePtr epoll_instance)
+                                           ReactorGroupPtr reactor_group)
     : incoming_queue(incoming_queue),
     response_queue(response_queue),
-      epoll_instance(epoll_instance) {}
+      reactor_group(reactor_group) {}
 
-void ChatControllerThread::registerHandlerQueue(CommandType type, std::shared_ptr<MessageQueue<HandlerRequestPtr>> queue){
-    handler_queues[type] = queue;
+void ChatControllerThread::registerHandler(CommandType type, BaseThreadHandlerPtr handler){
+    handlers[type] = handler;
 }
 
 void ChatControllerThread::start(){
@@ -23,9 +23,6 @@ void ChatControllerThread::stop(){
     if(incoming_queue){
         incoming_queue->stop();
     }
-    for(auto& pair : handler_queues){
-        pair.second->stop();
-    }
     if(worker_thread.joinable()){
         worker_thread.join();
     }
@@ -33,30 +30,32 @@ void ChatControllerThread::stop(){
 
 void ChatControllerThread::run(){
     CommandParser parser;
+    std::vector<Message> batch;
     while(running.load()){
-        auto msg_opt = incoming_queue->pop(100);        
-        if(!msg_opt.has_value()){
+        batch.clear();
+        if(incoming_queue->popBatch(batch, DEFAULT_POP_BATCH, -1) == 0){
             if(!running.load()){
                 break;
             }
             continue;
         }
 
-        auto msg = msg_opt.value();
-        switch(msg.type){
-            case MessageType::INCOMING_MESSAGE:
-                if(running.load()){
-                    routeMessage(std::get<IncomingMessage>(msg.payload), parser);
-                }
-                break;
-                
-            case MessageType::SHUTDOWN:
-                running.store(false);
-                break;
-                
-            default:
-                LOG_WARNING_STREAM("[Router] Unknown message type: " << static_cast<int>(msg.type));
-                break;
+        for(auto& msg : batch){
+            switch(msg.type){
+                case MessageType::INCOMING_MESSAGE:
+                    if(running.load()){
+                        routeMessage(std::get<IncomingMessage>(msg.payload), parser);
+                    }
+                    break;
+
+                case MessageType::SHUTDOWN:
+                    running.store(false);
+                    break;
+
+                default:
+                    LOG_WARNING_STREAM("[Router] Unknown message type: " << static_cast<int>(msg.type));
+                    break;
+            }
         }
     }
 }
@@ -73,7 +72,7 @@ void ChatControllerThread::routeMessage(IncomingMessage& incoming, CommandParser
     }
 
     std::string content = incoming.content;
-    auto cmd = parser.parse(content, incoming, epoll_instance);
+    auto cmd = parser.parse(content, incoming, reactor_group);
     LOG_DEBUG_STREAM("[Router]: " << static_cast<int>(cmd->type));
 
     if(!cmd){
@@ -81,8 +80,8 @@ void ChatControllerThread::routeMessage(IncomingMessage& incoming, CommandParser
         return;
     }
 
-    auto it = handler_queues.find(cmd->type);
-    if(it == handler_queues.end()){
+    auto it = handlers.find(cmd->type);
+    if(it == handlers.end()){
         LOG_WARNING_STREAM("[Router] Unknown command type: " << static_cast<int>(cmd->type) << " from fd=" << incoming.fd);
         
         if(cmd->type == CommandType::UNKNOWN && incoming.connection && !incoming.connection->isClosed()){
@@ -130,7 +129,7 @@ void ChatControllerThread::routeMessage(IncomingMessage& incoming, CommandParser
     else{
         req->user_desntination = -1;
     }
-    it->second->push(req);
+    it->second->dispatch(req);
     
     LOG_DEBUG_STREAM("[Router] Routed message of " << req->fd << " to handler for type " << static_cast<int>(cmd->type));
 }
\ No newline at end of file
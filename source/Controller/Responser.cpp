@@ -4,9 +4,9 @@
 #include "MessageAckManager.h"
 #include "UserManager.h"
 
-Responser::Responser(std::shared_ptr<MessageQueue<HandlerResponsePtr>> resp_queue, EpollInstancePtr epoll)
+Responser::Responser(std::shared_ptr<MessageQueue<HandlerResponsePtr>> resp_queue, ReactorGroupPtr reactors)
     : response_queue(resp_queue),
-      epoll_instance(epoll) {}
+      reactor_group(reactors) {}
 
 void Responser::start(){
     running.store(true);
@@ -24,142 +24,173 @@ void Responser::stop(){
 }
 
 void Responser::run(){
+    std::vector<HandlerResponsePtr> batch;
     while(running.load()){
-        auto resp_opt = response_queue->pop(100);        
-        if(!resp_opt.has_value()){
+        batch.clear();
+        if(response_queue->popBatch(batch, DEFAULT_POP_BATCH, -1) == 0){
             if(!running.load()){
                 break;
             }
             continue;
         }
-        
-        auto resp = resp_opt.value();
-        if(!resp){
-            LOG_WARNING("Received null response");
-            continue;
-        }
 
-        switch(resp->destination){
-            case ResponseDestination::DIRECT_TO_CLIENT:
-                sendToClient(resp);
-                break;
+        for(auto& resp : batch){
+            if(!resp){
+                LOG_WARNING("Received null response");
+                continue;
+            }
 
-            case ResponseDestination::ERROR_TO_CLIENT:
-                sendBackToClient(resp);
-                break;
-                
-            case ResponseDestination::BACK_TO_CLIENT:
-                sendBackToClient(resp);
-                break;
-                
-            case ResponseDestination::BROADCAST_PUBLIC_CHAT_ROOM:
-                broadcastToRoom(resp);
-                break;
-                
-            default:
-                LOG_ERROR_STREAM("Unknown response destination: " << static_cast<int>(resp->destination));
-                break;
+            switch(resp->destination){
+                case ResponseDestination::DIRECT_TO_CLIENT:
+                    sendToClient(resp);
+                    break;
+
+                case ResponseDestination::ERROR_TO_CLIENT:
+                    sendBackToClient(resp);
+                    break;
+
+                case ResponseDestination::BACK_TO_CLIENT:
+                    sendBackToClient(resp);
+                    break;
+
+                case ResponseDestination::BROADCAST_PUBLIC_CHAT_ROOM:
+                    broadcastToRoom(resp);
+                    break;
+
+                default:
+                    LOG_ERROR_STREAM("Unknown response destination: " << static_cast<int>(resp->destination));
+                    break;
+            }
         }
+
+        flushStagedWrites();
     }
 }
 
-bool Responser::trySend(int fd, const char* data, size_t len, size_t& sent){
-    sent = 0;
+void Responser::stageWrite(const ConnectionPtr& conn, const std::string& message){
+    StagedWrite& staged = staged_writes[conn.get()];
+    if(!staged.conn){
+        staged.conn = conn;
+    }
+    staged.data += message;
+    staged.responses++;
+}
 
-    while(sent < len){
-        ssize_t n = send(fd, data + sent, len - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
-        
-        if(n < 0){
-            if(errno == EAGAIN || errno == EWOULDBLOCK){
-                return true;
-            }
-            else if(errno == EPIPE || errno == ECONNRESET){
-                LOG_DEBUG_STREAM("Connection closed during send (fd=" << fd << ")");
-                return false;
-            }
-            else{
-                LOG_ERROR_STREAM("Send error (fd=" << fd << "): " << strerror(errno));
-                return false;
-            }
-        }
-        else if(n == 0){
-            LOG_WARNING_STREAM("Send returned 0 (fd=" << fd << ")");
-            return false;
+void Responser::flushStagedWrites(){
+    for(auto& pair : staged_writes){
+        StagedWrite& staged = pair.second;
+        int fd = staged.conn->getFd();
+        if(staged.responses > 1){
+            LOG_DEBUG_STREAM("Coalesced " << staged.responses << " responses into one write for fd=" << fd);
         }
-        
-        sent += n;
+        sendWithEpoll(staged.conn, fd, std::move(staged.data));
     }
+    staged_writes.clear();
+}
 
-    return false;
+// Sends what the batch has staged for conn so far, so that a write queued
+// straight after it keeps its place behind those responses
+void Responser::flushStagedWrite(const ConnectionPtr& conn){
+    auto it = staged_writes.find(conn.get());
+    if(it == staged_writes.end()){
+        return;
+    }
+    StagedWrite staged = std::move(it->second);
+    staged_writes.erase(it);
+    sendWithEpoll(staged.conn, staged.conn->getFd(), std::move(staged.data));
+}
+
+void Responser::deliver(ConnectionPtr conn, std::string message){
+    if(!conn){
+        return;
+    }
+    sendWithEpoll(conn, conn->getFd(), std::move(message));
 }
 
-void Responser::sendWithEpoll(ConnectionPtr conn, int fd, const std::string& message){
+void Responser::sendWithEpoll(ConnectionPtr conn, int fd, std::string message){
     if(!conn || conn->isClosed()) {
         LOG_WARNING_STREAM("Cannot send to closed connection fd=" << fd);
         return;
     }
     
-    if(!epoll_instance){
-        LOG_ERROR("Epoll instance is null");
+    if(!reactor_group){
+        LOG_ERROR("Reactor group is null");
         return;
     }
 
-    conn->queueWrite(message);
-    LOG_DEBUG_STREAM("Queued " << message.size() << " bytes to fd=" << fd << " (queue size: " << conn->getWriteQueueSize() << ")");
+    size_t bytes = message.size();
+    conn->queueWrite(std::move(message));
+    LOG_DEBUG_STREAM("Queued " << bytes << " bytes to fd=" << fd << " (queue size: " << conn->getWriteQueueSize() << ")");
     
-    if(!conn->isWriting()){
-        conn->setWriting(true);
-        epoll_instance->enableWrite(fd, [this](int write_fd){
-            this->handleWritable(write_fd);
-        });
-        LOG_DEBUG_STREAM("Enabled EPOLLOUT for fd=" << fd);
+    if(conn->beginWriting()){
+        armWrite(conn, fd);
+    }
+}
+
+// Queues a reference to payload, which every recipient shares
+void Responser::sendShared(const ConnectionPtr& conn, const std::shared_ptr<const std::string>& payload){
+    conn->queueWrite(payload);
+    if(conn->beginWriting()){
+        armWrite(conn, conn->getFd());
     }
 }
 
-void Responser::handleWritable(int fd){
-    auto conn = epoll_instance->getConnection(fd);
+void Responser::armWrite(const ConnectionPtr& conn, int fd){
+    auto owner = reactor_group->getOwner(conn);
+    if(!owner){
+        conn->setWriting(false);
+        LOG_WARNING_STREAM("No reactor shard owns fd=" << fd);
+        return;
+    }
+
+    // The callback lives in the owner's handler table, so a raw pointer
+    // cannot outlive the shard it points to.
+    EventLoop* owner_ptr = owner.get();
+    owner->enableWrite(fd, [this, owner_ptr](int write_fd){
+        this->handleWritable(owner_ptr, write_fd);
+    });
+    LOG_DEBUG_STREAM("Enabled EPOLLOUT for fd=" << fd);
+}
+
+void Responser::handleWritable(EventLoop* owner, int fd){
+    auto conn = owner->getConnection(fd);
     if(!conn || conn->isClosed()){
-        epoll_instance->disableWrite(fd);
+        owner->disableWrite(fd);
         LOG_DEBUG_STREAM("Connection closed, disabled EPOLLOUT for fd=" << fd);
         return;
     }
 
-    if(conn->hasPartialWrite()){
-        std::string data = conn->getPartialWrite();
-        size_t sent = 0;
-        bool would_block = trySend(fd, data.data(), data.size(), sent);
-        
-        if(sent < data.size()){
-            std::string remaining(data.data() + sent, data.size() - sent);
-            conn->setPartialWrite(std::move(remaining));
-            LOG_DEBUG_STREAM("EPOLLOUT fd=" << fd << ": still blocked, sent=" << sent << "/" << data.size());
-            return;
-        }
-        
-        LOG_DEBUG_STREAM("EPOLLOUT fd=" << fd << ": completed partial write (" << data.size() << " bytes)");
-    }
+    auto result = conn->flushWriteQueue();
+    owner->recordWrites(result.syscalls, result.segments);
 
-    while(conn->hasWriteData()){
-        std::string data = conn->popWriteData();
-        LOG_DEBUG_STREAM("EPOLLOUT fd=" << fd << ": attempting to send queued message (" << data.size() << " bytes)");
-        if(data.empty()) break;
-        
-        size_t sent = 0;
-        bool would_block = trySend(fd, data.data(), data.size(), sent);
-        
-        if(sent < data.size()){
-            std::string remaining(data.data() + sent, data.size() - sent);
-            conn->setPartialWrite(std::move(remaining));
-            LOG_DEBUG_STREAM("EPOLLOUT fd=" << fd << ": blocked on queue item, sent=" << sent << "/" << data.size());
+    switch(result.status){
+        case Connection::WriteResult::WOULD_BLOCK:
+            LOG_DEBUG_STREAM("EPOLLOUT fd=" << fd << ": blocked after " << result.bytes << " bytes in " << result.syscalls << " sendmsg call(s)");
             return;
-        }
-        
-        LOG_DEBUG_STREAM("EPOLLOUT fd=" << fd << ": sent queued message (" << data.size() << " bytes)");
+
+        case Connection::WriteResult::FAILED:
+            if(result.error == EPIPE || result.error == ECONNRESET){
+                LOG_DEBUG_STREAM("Connection closed during send (fd=" << fd << ")");
+            }
+            else{
+                LOG_ERROR_STREAM("Send error (fd=" << fd << "): " << strerror(result.error));
+            }
+            break;
+
+        case Connection::WriteResult::DRAINED:
+            LOG_DEBUG_STREAM("EPOLLOUT fd=" << fd << ": sent " << result.bytes << " bytes in " << result.syscalls << " sendmsg call(s), " << result.segments << " segment(s)");
+            break;
     }
 
+    owner->disableWrite(fd);
     conn->setWriting(false);
-    epoll_instance->disableWrite(fd);
     LOG_DEBUG_STREAM("EPOLLOUT fd=" << fd << ": queue empty, disabled EPOLLOUT");
+
+    // A response queued after the flush but before writing was cleared saw
+    // the flag still set and left the arming to us
+    if(result.status == Connection::WriteResult::DRAINED && conn->hasWriteData() && conn->beginWriting()){
+        armWrite(conn, fd);
+    }
 }
 
 void Responser::sendToClient(HandlerResponsePtr resp){
@@ -168,35 +199,31 @@ void Responser::sendToClient(HandlerResponsePtr resp){
         return;
     }
 
-    if(!epoll_instance){
-        LOG_ERROR("Epoll instance is null");
+    if(!reactor_group){
+        LOG_ERROR("Reactor group is null");
         return;
     }
 
     auto& ackMgr = MessageAckManager::getInstance();
-    auto& userMgr = UserManager::getInstance();
     
-    std::string msg_id = ackMgr.generateMessageId();
+    MessageId msg_id = ackMgr.generateMessageId();
+    std::string full_message = MessageIdFormat::frame(msg_id, resp->response_message);
 
-    // Format: MSG_ID|content\n
-    std::string full_message = msg_id + "|" + resp->response_message + "\n";
+    int sender_id = resp->connection->getSession().getUserId();
+    LOG_DEBUG_STREAM("Sender fd=" << resp->fd << " maps to user_id=" << sender_id);
 
-    int sender_id = -1;
-    int receiver_id = -1;
+    int receiver_fd = resp->user_destination;
+    auto target_conn = reactor_group->getConnection(receiver_fd);
 
-    auto sender_user_id = userMgr.getUserId(resp->fd);
-    LOG_DEBUG_STREAM("Sender fd=" << resp->fd << " maps to user_id=" << (sender_user_id.has_value() ? std::to_string(sender_user_id.value()) : "N/A"));
-    if(sender_user_id.has_value()){
-        sender_id = sender_user_id.value();
+    // Gone already: only the registry can still say who was on that fd
+    int receiver_id = -1;
+    if(target_conn){
+        receiver_id = target_conn->getSession().getUserId();
     }
-    
-    auto receiver_user_id = userMgr.getUserId(resp->user_destination);
-    if(receiver_user_id.has_value()){
-        receiver_id = receiver_user_id.value();
+    else{
+        receiver_id = UserManager::getInstance().getUserId(receiver_fd).value_or(-1);
     }
 
-    int receiver_fd = resp->user_destination;
-    auto target_conn = epoll_instance->getConnection(receiver_fd);
     if(!target_conn || target_conn->isClosed()){
         LOG_WARNING_STREAM("Receiver connection closed (fd=" << receiver_fd << "), saving to DB for later");
         
@@ -208,7 +235,7 @@ void Responser::sendToClient(HandlerResponsePtr resp){
 
     ackMgr.addPendingMessage(msg_id, resp, target_conn, sender_id, receiver_id, resp->response_message);
     
-    sendWithEpoll(target_conn, receiver_fd, full_message);
+    stageWrite(target_conn, full_message);
 }
 
 void Responser::sendBackToClient(HandlerResponsePtr resp){
@@ -217,24 +244,18 @@ void Responser::sendBackToClient(HandlerResponsePtr resp){
         return;
     }
     
-    if(!epoll_instance){
-        LOG_ERROR("Epoll instance is null");
+    if(!reactor_group){
+        LOG_ERROR("Reactor group is null");
         return;
     }
     
     auto& ackMgr = MessageAckManager::getInstance();
-    auto& userMgr = UserManager::getInstance();
     
-    std::string msg_id = ackMgr.generateMessageId();
-    std::string full_message = msg_id + "|" + resp->response_message + "\n";
-
-    int sender_id = -1;
-    auto sender_user_id = userMgr.getUserId(resp->fd);
-    if(sender_user_id.has_value()){
-        sender_id = sender_user_id.value();
-    }
+    MessageId msg_id = ackMgr.generateMessageId();
+    std::string full_message = MessageIdFormat::frame(msg_id, resp->response_message);
 
     auto conn = resp->connection;
+    int sender_id = conn->getSession().getUserId();
 
     if(!conn || conn->isClosed()){
         return;
@@ -247,7 +268,7 @@ void Responser::sendBackToClient(HandlerResponsePtr resp){
 
     ackMgr.addPendingMessage(msg_id, resp, conn, sender_id, sender_id, resp->response_message);
 
-    sendWithEpoll(conn, fd, full_message);
+    stageWrite(conn, full_message);
 }
 
 void Responser::broadcastToRoom(HandlerResponsePtr resp){
@@ -256,32 +277,45 @@ void Responser::broadcastToRoom(HandlerResponsePtr resp){
         return;
     }
 
-    if(!epoll_instance){
-        LOG_ERROR("Epoll instance is null");
+    if(!reactor_group){
+        LOG_ERROR("Reactor group is null");
         return;
     }
 
-    auto& room = PublicChatRoom::getInstance();
-    auto members = room.getParticipants();
-    LOG_DEBUG_STREAM("[Broadcast] Sending to " << members.size() << " members in public chat room");
+    // Members that disconnect meanwhile are skipped here and removed by
+    // their reactor, or below if they joined after the reactor's leave
+    auto& public_room = PublicChatRoom::getInstance();
+    RoomSnapshotPtr room = public_room.getParticipants();
+    LOG_DEBUG_STREAM("[Broadcast] Sending to " << room->members.size() << " members in public chat room (version " << room->version << ")");
     
-    std::string broadcast_msg = resp->response_message + "\n";
+    // One payload for the whole room; each member's queue holds a reference
+    auto payload = std::make_shared<const std::string>(resp->response_message + "\n");
 
     int sent_count = 0;
-    for(int member_fd : members){
-        if(resp->exclude_fd >= 0 && member_fd == resp->exclude_fd){
+    std::vector<const RoomMember*> closed;
+    for(const RoomMember& member : room->members){
+        if(resp->exclude_fd >= 0 && member.fd == resp->exclude_fd){
             continue;
         }
         
-        auto conn = epoll_instance->getConnection(member_fd);
-        if(!conn || conn->isClosed()){
-            room.leave(member_fd);
+        if(member.connection->isClosed()){
+            closed.push_back(&member);
             continue;
         }
         
-        sendWithEpoll(conn, member_fd, broadcast_msg);
+        if(!staged_writes.empty()){
+            flushStagedWrite(member.connection);
+        }
+        sendShared(member.connection, payload);
         sent_count++;
     }
     
     LOG_DEBUG_STREAM("[Broadcast] Sent to " << sent_count << " members in room");
+
+    // The snapshot keeps these members alive until the loop is done
+    for(const RoomMember* member : closed){
+        if(public_room.leave(member->fd, member->connection.get())){
+            LOG_DEBUG_STREAM("[Broadcast] Removed closed member fd=" << member->fd);
+        }
+    }
 }
\ No newline at end of file
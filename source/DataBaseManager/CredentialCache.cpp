@@ -0,0 +1,112 @@
+#include "CredentialCache.h"
+#include <ctime>
+
+// Same format and zone as SQLite's CURRENT_TIMESTAMP
+static std::string currentUtcTimestamp(){
+    std::time_t now = std::time(nullptr);
+    std::tm utc;
+    gmtime_r(&now, &utc);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &utc);
+    return buffer;
+}
+
+CredentialCache::CredentialCache(const CredentialCacheConfig& config) : config(config) {}
+
+void CredentialCache::configure(const CredentialCacheConfig& new_config){
+    std::lock_guard<std::mutex> lock(mtx);
+    config = new_config;
+    while(lru.size() > config.capacity){
+        index.erase(lru.back().username);
+        lru.pop_back();
+    }
+}
+
+CredentialCache::Lookup CredentialCache::lookup(const std::string& username, CachedCredentials& credentials){
+    std::lock_guard<std::mutex> lock(mtx);
+
+    auto it = index.find(username);
+    if(it == index.end()){
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return Lookup::MISS;
+    }
+
+    auto entry = it->second;
+    if(!entry->credentials){
+        if(std::chrono::steady_clock::now() >= entry->expires){
+            lru.erase(entry);
+            index.erase(it);
+            misses.fetch_add(1, std::memory_order_relaxed);
+            return Lookup::MISS;
+        }
+        lru.splice(lru.begin(), lru, entry);
+        negative_hits.fetch_add(1, std::memory_order_relaxed);
+        return Lookup::NOT_FOUND;
+    }
+
+    lru.splice(lru.begin(), lru, entry);
+    credentials = *entry->credentials;
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return Lookup::FOUND;
+}
+
+uint64_t CredentialCache::generation(){
+    std::lock_guard<std::mutex> lock(mtx);
+    return generation_counter;
+}
+
+void CredentialCache::store(const std::string& username, const std::optional<CachedCredentials>& credentials, uint64_t generation){
+    std::lock_guard<std::mutex> lock(mtx);
+    if(config.capacity == 0 || generation != generation_counter){
+        return;
+    }
+
+    auto expires = std::chrono::steady_clock::now() + config.negative_ttl;
+    auto it = index.find(username);
+    if(it != index.end()){
+        it->second->credentials = credentials;
+        it->second->expires = expires;
+        lru.splice(lru.begin(), lru, it->second);
+        return;
+    }
+
+    lru.push_front(Entry{username, credentials, expires});
+    index[username] = lru.begin();
+
+    if(lru.size() > config.capacity){
+        index.erase(lru.back().username);
+        lru.pop_back();
+        evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void CredentialCache::invalidate(const std::string& username){
+    std::lock_guard<std::mutex> lock(mtx);
+    generation_counter++;
+
+    auto it = index.find(username);
+    if(it != index.end()){
+        lru.erase(it->second);
+        index.erase(it);
+    }
+}
+
+void CredentialCache::recordLogin(const std::string& username){
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = index.find(username);
+    if(it != index.end() && it->second->credentials){
+        it->second->credentials->last_login = currentUtcTimestamp();
+    }
+}
+
+void CredentialCache::clear(){
+    std::lock_guard<std::mutex> lock(mtx);
+    generation_counter++;
+    lru.clear();
+    index.clear();
+}
+
+size_t CredentialCache::size(){
+    std::lock_guard<std::mutex> lock(mtx);
+    return lru.size();
+}
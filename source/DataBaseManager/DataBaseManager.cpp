@@ -7,12 +7,186 @@
 DataBaseManager::DataBaseManager(const std::string& db_file) : db(nullptr), db_path(db_file) {}
 
 DataBaseManager::~DataBaseManager(){
+    finalizeStatements();
     if(db){
         sqlite3_close(db);
         db = nullptr;
     }
 }
 
+static const char* const STATEMENT_SQL[] = {
+    "BEGIN;",
+    "COMMIT;",
+    "ROLLBACK;",
+    "INSERT INTO users (username, password_hash) VALUES (?, ?);",
+    "SELECT COUNT(*) FROM users WHERE username = ?;",
+    "UPDATE users SET last_login = CURRENT_TIMESTAMP WHERE username = ?;",
+    "SELECT id, username, password_hash, created_at, last_login FROM users WHERE username = ?;",
+    "INSERT INTO pending_messages (message_id, sender_id, receiver_id, message_content, status) "
+    "VALUES (?, ?, ?, ?, 'pending');",
+    "UPDATE pending_messages SET status = ?, last_retry_at = CURRENT_TIMESTAMP "
+    "WHERE message_id = ?;",
+    "DELETE FROM pending_messages WHERE message_id = ?;",
+    "UPDATE pending_messages SET retry_count = retry_count + 1, "
+    "last_retry_at = CURRENT_TIMESTAMP WHERE message_id = ?;",
+    "SELECT id, message_id, sender_id, receiver_id, message_content, status, "
+    "created_at, last_retry_at, retry_count "
+    "FROM pending_messages "
+    "WHERE receiver_id = ? AND status IN ('pending', 'sent') AND id > ? AND id <= ? "
+    "ORDER BY id LIMIT ?;",
+    "SELECT COALESCE(MAX(id), 0) FROM pending_messages "
+    "WHERE receiver_id = ? AND status IN ('pending', 'sent');",
+    "SELECT MAX(last_id) FROM ("
+    "SELECT MAX(message_id) AS last_id FROM pending_messages "
+    "UNION ALL SELECT last_message_id FROM message_id_high_water);",
+    "SELECT COUNT(*), COUNT(DISTINCT receiver_id) FROM pending_messages "
+    "WHERE status IN ('pending', 'sent');",
+    "DELETE FROM pending_messages WHERE id IN ("
+    "SELECT id FROM pending_messages WHERE status = ? AND last_retry_at < datetime('now', ?) LIMIT ?);",
+    "SELECT status, COUNT(*) FROM pending_messages GROUP BY status;",
+    "INSERT INTO message_id_high_water (id, last_message_id) "
+    "SELECT 0, MAX(message_id) FROM pending_messages WHERE true HAVING MAX(message_id) IS NOT NULL "
+    "ON CONFLICT(id) DO UPDATE SET last_message_id = MAX(last_message_id, excluded.last_message_id);",
+};
+
+static const char* const PENDING_MESSAGES_SCHEMA =
+    "CREATE TABLE IF NOT EXISTS pending_messages ("
+    "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    "message_id INTEGER UNIQUE NOT NULL,"
+    "sender_id INTEGER NOT NULL,"
+    "receiver_id INTEGER NOT NULL,"
+    "message_content TEXT NOT NULL,"
+    "status TEXT DEFAULT 'pending',"  // pending, sent, acknowledged, failed
+    "created_at DATETIME DEFAULT CURRENT_TIMESTAMP,"
+    "last_retry_at DATETIME DEFAULT CURRENT_TIMESTAMP,"
+    "retry_count INTEGER DEFAULT 0,"
+    "FOREIGN KEY (sender_id) REFERENCES users(id),"
+    "FOREIGN KEY (receiver_id) REFERENCES users(id)"
+    ");";
+
+// Highest message id ever stored, saved before rows are deleted so that an
+// emptied pending_messages does not let recovery hand out old ids again
+static const char* const MESSAGE_ID_HIGH_WATER_SCHEMA =
+    "CREATE TABLE IF NOT EXISTS message_id_high_water ("
+    "id INTEGER PRIMARY KEY CHECK (id = 0),"
+    "last_message_id INTEGER NOT NULL"
+    ");";
+
+struct DurabilityPragmas{
+    const char* journal_mode;
+    const char* synchronous;
+    int cache_size_kib;
+    int64_t mmap_size;
+    int busy_timeout_ms;
+    const char* temp_store;
+};
+
+// Indexed by DurabilityProfile
+static const DurabilityPragmas DURABILITY_PRAGMAS[] = {
+    {"DELETE", "FULL",   2048,  0,                   5000, "DEFAULT"},
+    {"WAL",    "NORMAL", 8192,  64LL * 1024 * 1024,  5000, "DEFAULT"},
+    {"WAL",    "OFF",    32768, 256LL * 1024 * 1024, 1000, "MEMORY"},
+};
+
+const char* durabilityProfileName(DurabilityProfile profile){
+    switch(profile){
+        case DurabilityProfile::STRICT:   return "strict";
+        case DurabilityProfile::BALANCED: return "balanced";
+        case DurabilityProfile::FAST:     return "fast";
+    }
+    return "unknown";
+}
+
+std::optional<DurabilityProfile> parseDurabilityProfile(const std::string& name){
+    if(name == "strict") return DurabilityProfile::STRICT;
+    if(name == "balanced") return DurabilityProfile::BALANCED;
+    if(name == "fast") return DurabilityProfile::FAST;
+    return std::nullopt;
+}
+
+DataBaseManager::StatementHandle::~StatementHandle(){
+    if(!stmt) return;
+    if(owner->cache_statements){
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+    else{
+        sqlite3_finalize(stmt);
+    }
+}
+
+// Caller holds db_mutex
+DataBaseManager::StatementHandle DataBaseManager::statement(Statement which){
+    static_assert(sizeof(STATEMENT_SQL) / sizeof(STATEMENT_SQL[0]) == static_cast<size_t>(Statement::COUNT),
+                  "STATEMENT_SQL out of sync with Statement");
+    if(!db) return StatementHandle(this, nullptr);
+
+    size_t index = static_cast<size_t>(which);
+    if(cache_statements && statements[index]){
+        return StatementHandle(this, statements[index]);
+    }
+
+    sqlite3_stmt* stmt = nullptr;
+    int rc = sqlite3_prepare_v3(db, STATEMENT_SQL[index], -1,
+                                cache_statements ? SQLITE_PREPARE_PERSISTENT : 0, &stmt, nullptr);
+    if(rc != SQLITE_OK){
+        LOG_ERROR_STREAM("Failed to prepare statement: " << sqlite3_errmsg(db));
+        return StatementHandle(this, nullptr);
+    }
+    if(cache_statements){
+        statements[index] = stmt;
+    }
+    return StatementHandle(this, stmt);
+}
+
+// Caller holds db_mutex; for statements without parameters or results
+bool DataBaseManager::execute(Statement which){
+    auto stmt = statement(which);
+    return stmt && sqlite3_step(stmt.get()) == SQLITE_DONE;
+}
+
+void DataBaseManager::finalizeStatements(){
+    for(auto& stmt : statements){
+        if(stmt){
+            sqlite3_finalize(stmt);
+            stmt = nullptr;
+        }
+    }
+}
+
+void DataBaseManager::setStatementCaching(bool enabled){
+    std::lock_guard<std::mutex> lock(db_mutex);
+    if(!enabled){
+        finalizeStatements();
+    }
+    cache_statements = enabled;
+}
+
+bool DataBaseManager::beginTransaction(){
+    std::lock_guard<std::mutex> lock(db_mutex);
+    if(!execute(Statement::BEGIN)){
+        LOG_ERROR_STREAM("Failed to begin transaction: " << (db ? sqlite3_errmsg(db) : "no database"));
+        return false;
+    }
+    return true;
+}
+
+bool DataBaseManager::commitTransaction(){
+    std::lock_guard<std::mutex> lock(db_mutex);
+    if(!execute(Statement::COMMIT)){
+        LOG_ERROR_STREAM("Failed to commit transaction: " << (db ? sqlite3_errmsg(db) : "no database"));
+        return false;
+    }
+    return true;
+}
+
+void DataBaseManager::rollbackTransaction(){
+    std::lock_guard<std::mutex> lock(db_mutex);
+    if(db && !sqlite3_get_autocommit(db)){
+        execute(Statement::ROLLBACK);
+    }
+}
+
 DataBaseManager& DataBaseManager::getInstance(){
     static DataBaseManager instance("../DataBase/chat_server.db");
     return instance;
@@ -42,6 +216,14 @@ bool DataBaseManager::initialize(){
         db = nullptr;
         return false;    
     }
+
+    // auto_vacuum first: switching to WAL writes the header and fixes the mode
+    if(!applyAutoVacuum()){
+        return false;
+    }
+    if(!applyDurabilityProfile()){
+        return false;
+    }
     
     const char* create_table_sql = 
         "CREATE TABLE IF NOT EXISTS users ("
@@ -61,33 +243,32 @@ bool DataBaseManager::initialize(){
         return false;
     }
 
-    const char* create_pending_messages_table = 
-        "CREATE TABLE IF NOT EXISTS pending_messages ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "message_id TEXT UNIQUE NOT NULL,"
-        "sender_id INTEGER NOT NULL,"
-        "receiver_id INTEGER NOT NULL,"
-        "message_content TEXT NOT NULL,"
-        "status TEXT DEFAULT 'pending',"  // pending, sent, acknowledged, failed
-        "created_at DATETIME DEFAULT CURRENT_TIMESTAMP,"
-        "last_retry_at DATETIME DEFAULT CURRENT_TIMESTAMP,"
-        "retry_count INTEGER DEFAULT 0,"
-        "FOREIGN KEY (sender_id) REFERENCES users(id),"
-        "FOREIGN KEY (receiver_id) REFERENCES users(id)"
-        ");";
-    
-    rc = sqlite3_exec(db, create_pending_messages_table, nullptr, nullptr, &err_msg);
+    rc = sqlite3_exec(db, PENDING_MESSAGES_SCHEMA, nullptr, nullptr, &err_msg);
     
     if(rc != SQLITE_OK){
         LOG_ERROR_STREAM("SQL error creating pending_messages table: " << err_msg);
         sqlite3_free(err_msg);
         return false;
     }
+
+    if(!migratePendingMessageIds()){
+        return false;
+    }
+
+    rc = sqlite3_exec(db, MESSAGE_ID_HIGH_WATER_SCHEMA, nullptr, nullptr, &err_msg);
     
-    // Create index for faster queries
+    if(rc != SQLITE_OK){
+        LOG_ERROR_STREAM("SQL error creating message_id_high_water table: " << err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
+    
+    // Status lookups and retention; last_retry_at is the time of the last
+    // status change. Supersedes the earlier index on status alone.
     const char* create_index = 
-        "CREATE INDEX IF NOT EXISTS idx_pending_messages_status "
-        "ON pending_messages(status);";
+        "DROP INDEX IF EXISTS idx_pending_messages_status;"
+        "CREATE INDEX IF NOT EXISTS idx_pending_messages_status_age "
+        "ON pending_messages(status, last_retry_at);";
     
     rc = sqlite3_exec(db, create_index, nullptr, nullptr, &err_msg);
     
@@ -109,150 +290,230 @@ bool DataBaseManager::initialize(){
         sqlite3_free(err_msg);
         return false;
     }
+
+    // Replay cursor: a user's undelivered rows in id order, nothing else
+    const char* create_replay_index =
+        "CREATE INDEX IF NOT EXISTS idx_pending_messages_replay "
+        "ON pending_messages(receiver_id, id) WHERE status IN ('pending', 'sent');";
+
+    rc = sqlite3_exec(db, create_replay_index, nullptr, nullptr, &err_msg);
+
+    if(rc != SQLITE_OK){
+        LOG_ERROR_STREAM("SQL error creating replay index: " << err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
     LOG_DEBUG("Database initialized successfully");
     return true;
 }
 
-bool DataBaseManager::registerUser(const std::string& username, const std::string& password){
-    std::lock_guard<std::mutex> lock(db_mutex);
-    
-    if(!db) return false;
-    
-    std::string pwd_hash = hashPassword(password);
-    
-    const char* sql = "INSERT INTO users (username, password_hash) VALUES (?, ?);";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if(rc != SQLITE_OK){
-        LOG_ERROR_STREAM("Failed to prepare statement: " << sqlite3_errmsg(db));
+// Caller holds db_mutex
+bool DataBaseManager::applyDurabilityProfile(){
+    const DurabilityPragmas& pragmas = DURABILITY_PRAGMAS[static_cast<size_t>(durability)];
+
+    sqlite3_busy_timeout(db, pragmas.busy_timeout_ms);
+
+    // journal_mode reports the mode actually in effect, which can differ
+    // from the one asked for (e.g. WAL is unavailable for in-memory files)
+    std::string journal_sql = std::string("PRAGMA journal_mode = ") + pragmas.journal_mode + ";";
+    sqlite3_stmt* stmt = nullptr;
+    if(sqlite3_prepare_v2(db, journal_sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK){
+        LOG_ERROR_STREAM("Failed to set journal mode: " << sqlite3_errmsg(db));
         return false;
     }
-    
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, pwd_hash.c_str(), -1, SQLITE_TRANSIENT);
-    
-    rc = sqlite3_step(stmt);
+    journal_mode.clear();
+    if(sqlite3_step(stmt) == SQLITE_ROW){
+        const char* mode = (const char*)sqlite3_column_text(stmt, 0);
+        journal_mode = mode ? mode : "";
+    }
+    sqlite3_finalize(stmt);
+    if(strcasecmp(journal_mode.c_str(), pragmas.journal_mode) != 0){
+        LOG_WARNING_STREAM("Requested journal_mode " << pragmas.journal_mode << ", got " << journal_mode);
+    }
 
-    LOG_INFO_STREAM("rc = " << rc);
-    LOG_INFO_STREAM("errmsg = " << sqlite3_errmsg(db));
+    std::string synchronous = std::string("PRAGMA synchronous = ") + pragmas.synchronous + ";";
+    char* err_msg = nullptr;
+    if(sqlite3_exec(db, synchronous.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK){
+        LOG_ERROR_STREAM("Failed to set synchronous: " << err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
+    if(!applyCachePragmas()){
+        return false;
+    }
+
+    LOG_INFO_STREAM("Database durability profile: " << durabilityProfileName(durability)
+                    << " (journal_mode=" << journal_mode << ", synchronous=" << pragmas.synchronous << ")");
+    return true;
+}
+
+// Caller holds db_mutex. Incremental auto-vacuum lets compaction return
+// freed pages to the file system. The mode can only be chosen before the
+// first table exists (or WAL is enabled); older files reuse their free pages but keep their
+// size until a full VACUUM.
+bool DataBaseManager::applyAutoVacuum(){
+    char* err_msg = nullptr;
+    if(sqlite3_exec(db, "PRAGMA auto_vacuum = INCREMENTAL;", nullptr, nullptr, &err_msg) != SQLITE_OK){
+        LOG_ERROR_STREAM("Failed to set auto_vacuum: " << err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
+    incremental_vacuum = queryPragma("PRAGMA auto_vacuum;") == 2;
+    if(!incremental_vacuum){
+        LOG_INFO("Database auto_vacuum is not incremental; compaction frees pages for reuse without shrinking the file");
+    }
+    return true;
+}
 
+// Caller holds db_mutex; first column of the first row, -1 on error
+int64_t DataBaseManager::queryPragma(const char* sql){
+    sqlite3_stmt* stmt = nullptr;
+    if(sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK){
+        LOG_ERROR_STREAM("Failed to prepare " << sql << ": " << sqlite3_errmsg(db));
+        return -1;
+    }
+    int64_t value = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
     sqlite3_finalize(stmt);
-    
-    if(rc != SQLITE_DONE){
-        LOG_ERROR_STREAM("Failed to register user: " << sqlite3_errmsg(db));
+    return value;
+}
+
+// Caller holds db_mutex. Databases created before message ids became
+// integers store them as TEXT "MSG_0000000042"; rebuild the table with an
+// INTEGER column, keeping the rows.
+bool DataBaseManager::migratePendingMessageIds(){
+    std::string column_type;
+    {
+        sqlite3_stmt* stmt = nullptr;
+        const char* sql = "SELECT type FROM pragma_table_info('pending_messages') WHERE name = 'message_id';";
+        if(sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK){
+            LOG_ERROR_STREAM("Failed to inspect pending_messages: " << sqlite3_errmsg(db));
+            return false;
+        }
+        if(sqlite3_step(stmt) == SQLITE_ROW){
+            const char* type = (const char*)sqlite3_column_text(stmt, 0);
+            column_type = type ? type : "";
+        }
+        sqlite3_finalize(stmt);
+    }
+    if(strcasecmp(column_type.c_str(), "TEXT") != 0){
+        return true;
+    }
+
+    LOG_INFO("Migrating pending_messages.message_id from TEXT to INTEGER");
+    std::string sql = std::string(
+        "BEGIN;"
+        "ALTER TABLE pending_messages RENAME TO pending_messages_text_ids;")
+        + PENDING_MESSAGES_SCHEMA +
+        "INSERT INTO pending_messages (id, message_id, sender_id, receiver_id, message_content, "
+        "status, created_at, last_retry_at, retry_count) "
+        "SELECT id, CAST(substr(message_id, 5) AS INTEGER), sender_id, receiver_id, message_content, "
+        "status, created_at, last_retry_at, retry_count FROM pending_messages_text_ids;"
+        "DROP TABLE pending_messages_text_ids;"
+        "COMMIT;";
+
+    char* err_msg = nullptr;
+    if(sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK){
+        LOG_ERROR_STREAM("Failed to migrate pending_messages: " << err_msg);
+        sqlite3_free(err_msg);
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
         return false;
     }
-    
-    LOG_INFO_STREAM("User registered: " << username);
     return true;
 }
 
-bool DataBaseManager::verifyLogin(const std::string& username, const std::string& password){
+// Caller holds db_mutex; the per-connection part, shared with readers
+bool DataBaseManager::applyCachePragmas(){
+    const DurabilityPragmas& pragmas = DURABILITY_PRAGMAS[static_cast<size_t>(durability)];
+
+    std::ostringstream sql;
+    sql << "PRAGMA cache_size = " << -pragmas.cache_size_kib << ";"
+        << "PRAGMA mmap_size = " << pragmas.mmap_size << ";"
+        << "PRAGMA temp_store = " << pragmas.temp_store << ";";
+
+    char* err_msg = nullptr;
+    if(sqlite3_exec(db, sql.str().c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK){
+        LOG_ERROR_STREAM("Failed to apply durability profile: " << err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
+    return true;
+}
+
+bool DataBaseManager::initializeReadOnly(){
     std::lock_guard<std::mutex> lock(db_mutex);
-    
-    if(!db) return false;
-    
-    std::string pwd_hash = hashPassword(password);
-    
-    const char* sql = "SELECT password_hash FROM users WHERE username = ?;";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+
+    int rc = sqlite3_open_v2(db_path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr);
     if(rc != SQLITE_OK){
-        LOG_ERROR_STREAM("Failed to prepare statement: " << sqlite3_errmsg(db));
+        LOG_ERROR_STREAM("Cannot open database read-only: " << sqlite3_errmsg(db));
+        sqlite3_close(db);
+        db = nullptr;
         return false;
     }
+
+    const DurabilityPragmas& pragmas = DURABILITY_PRAGMAS[static_cast<size_t>(durability)];
+    sqlite3_busy_timeout(db, pragmas.busy_timeout_ms);
+    return applyCachePragmas();
+}
+
+bool DataBaseManager::registerUser(const std::string& username, const std::string& password){
+    std::lock_guard<std::mutex> lock(db_mutex);
     
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+    std::string pwd_hash = hashPassword(password);
     
-    rc = sqlite3_step(stmt);
+    auto stmt = statement(Statement::REGISTER_USER);
+    if(!stmt) return false;
     
-    bool verified = false;
-    if(rc == SQLITE_ROW){
-        const char* stored_hash = (const char*)sqlite3_column_text(stmt, 0);
-        verified = (pwd_hash == stored_hash);
+    sqlite3_bind_text(stmt.get(), 1, username.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt.get(), 2, pwd_hash.c_str(), -1, SQLITE_TRANSIENT);
+    
+    int rc = sqlite3_step(stmt.get());
+    if(rc != SQLITE_DONE){
+        LOG_ERROR_STREAM("Failed to register user: " << sqlite3_errmsg(db));
+        return false;
     }
     
-    sqlite3_finalize(stmt);
-    return verified;
+    LOG_INFO_STREAM("User registered: " << username);
+    return true;
 }
 
 bool DataBaseManager::usernameExists(const std::string& username){
     std::lock_guard<std::mutex> lock(db_mutex);
     
-    if(!db) return false;
+    auto stmt = statement(Statement::USERNAME_EXISTS);
+    if(!stmt) return false;
     
-    const char* sql = "SELECT COUNT(*) FROM users WHERE username = ?;";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if(rc != SQLITE_OK){
-        return false;
-    }
+    sqlite3_bind_text(stmt.get(), 1, username.c_str(), -1, SQLITE_TRANSIENT);
     
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
-    
-    rc = sqlite3_step(stmt);
     bool exists = false;
-    
-    if(rc == SQLITE_ROW){
-        exists = sqlite3_column_int(stmt, 0) > 0;
+    if(sqlite3_step(stmt.get()) == SQLITE_ROW){
+        exists = sqlite3_column_int(stmt.get(), 0) > 0;
     }
-    
-    sqlite3_finalize(stmt);
     return exists;
 }
 
 bool DataBaseManager::updateLastLogin(const std::string& username){
     std::lock_guard<std::mutex> lock(db_mutex);
     
-    if(!db) return false;
+    auto stmt = statement(Statement::UPDATE_LAST_LOGIN);
+    if(!stmt) return false;
     
-    const char* sql = "UPDATE users SET last_login = CURRENT_TIMESTAMP WHERE username = ?;";
-    sqlite3_stmt* stmt;
+    sqlite3_bind_text(stmt.get(), 1, username.c_str(), -1, SQLITE_TRANSIENT);
     
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if(rc != SQLITE_OK){
-        return false;
-    }
-    
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
-    
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    
-    return rc == SQLITE_DONE;
+    return sqlite3_step(stmt.get()) == SQLITE_DONE;
 }
 
-bool DataBaseManager::addPendingMessage(const std::string& message_id, int sender_id, int receiver_id, const std::string& message_content){
+bool DataBaseManager::addPendingMessage(MessageId message_id, int sender_id, int receiver_id, const std::string& message_content){
     std::lock_guard<std::mutex> lock(db_mutex);
     
-    if(!db) return false;
-    
-    const char* sql = 
-        "INSERT INTO pending_messages (message_id, sender_id, receiver_id, message_content, status) "
-        "VALUES (?, ?, ?, ?, 'pending');";
-    
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if(rc != SQLITE_OK){
-        LOG_ERROR_STREAM("Failed to prepare add pending message: " << sqlite3_errmsg(db));
-        return false;
-    }
-    
-    sqlite3_bind_text(stmt, 1, message_id.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 2, sender_id);
-    sqlite3_bind_int(stmt, 3, receiver_id);
-    sqlite3_bind_text(stmt, 4, message_content.c_str(), -1, SQLITE_TRANSIENT);
+    auto stmt = statement(Statement::ADD_PENDING_MESSAGE);
+    if(!stmt) return false;
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_bind_int64(stmt.get(), 1, static_cast<sqlite3_int64>(message_id));
+    sqlite3_bind_int(stmt.get(), 2, sender_id);
+    sqlite3_bind_int(stmt.get(), 3, receiver_id);
+    sqlite3_bind_text(stmt.get(), 4, message_content.c_str(), -1, SQLITE_TRANSIENT);
     
-    LOG_INFO_STREAM("rc = " << rc);
-    LOG_INFO_STREAM("errmsg = " << sqlite3_errmsg(db));
-
-    if(rc != SQLITE_DONE){
+    if(sqlite3_step(stmt.get()) != SQLITE_DONE){
         LOG_ERROR_STREAM("Failed to add pending message: " << sqlite3_errmsg(db));
         return false;
     }
@@ -261,29 +522,16 @@ bool DataBaseManager::addPendingMessage(const std::string& message_id, int sende
     return true;
 }
 
-bool DataBaseManager::updateMessageStatus(const std::string& message_id, const std::string& status){
+bool DataBaseManager::updateMessageStatus(MessageId message_id, const std::string& status){
     std::lock_guard<std::mutex> lock(db_mutex);
     
-    if(!db) return false;
-    
-    const char* sql = 
-        "UPDATE pending_messages SET status = ?, last_retry_at = CURRENT_TIMESTAMP "
-        "WHERE message_id = ?;";
-    
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if(rc != SQLITE_OK){
-        LOG_ERROR_STREAM("Failed to prepare update status: " << sqlite3_errmsg(db));
-        return false;
-    }
+    auto stmt = statement(Statement::UPDATE_MESSAGE_STATUS);
+    if(!stmt) return false;
     
-    sqlite3_bind_text(stmt, 1, status.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, message_id.c_str(), -1, SQLITE_TRANSIENT);
-    
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_bind_text(stmt.get(), 1, status.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt.get(), 2, static_cast<sqlite3_int64>(message_id));
     
-    if(rc != SQLITE_DONE){
+    if(sqlite3_step(stmt.get()) != SQLITE_DONE){
         LOG_ERROR_STREAM("Failed to update message status: " << sqlite3_errmsg(db));
         return false;
     }
@@ -292,26 +540,38 @@ bool DataBaseManager::updateMessageStatus(const std::string& message_id, const s
     return true;
 }
 
-bool DataBaseManager::deletePendingMessage(const std::string& message_id){
+bool DataBaseManager::updateMessageStatus(const std::vector<MessageId>& message_ids, const std::string& status){
     std::lock_guard<std::mutex> lock(db_mutex);
     
-    if(!db) return false;
-    
-    const char* sql = "DELETE FROM pending_messages WHERE message_id = ?;";
-    
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if(rc != SQLITE_OK){
-        LOG_ERROR_STREAM("Failed to prepare delete: " << sqlite3_errmsg(db));
-        return false;
+    auto stmt = statement(Statement::UPDATE_MESSAGE_STATUS);
+    if(!stmt) return false;
+    
+    sqlite3_bind_text(stmt.get(), 1, status.c_str(), -1, SQLITE_TRANSIENT);
+    for(MessageId message_id : message_ids){
+        sqlite3_bind_int64(stmt.get(), 2, static_cast<sqlite3_int64>(message_id));
+        int rc = sqlite3_step(stmt.get());
+        sqlite3_reset(stmt.get());
+        if(rc != SQLITE_DONE){
+            LOG_ERROR_STREAM("Failed to update message status: " << sqlite3_errmsg(db));
+            return false;
+        }
     }
     
-    sqlite3_bind_text(stmt, 1, message_id.c_str(), -1, SQLITE_TRANSIENT);
+    LOG_DEBUG_STREAM("Updated " << message_ids.size() << " messages status to: " << status);
+    return true;
+}
+
+bool DataBaseManager::deletePendingMessage(MessageId message_id){
+    std::lock_guard<std::mutex> lock(db_mutex);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    if(!saveMessageIdHighWater()) return false;
+
+    auto stmt = statement(Statement::DELETE_PENDING_MESSAGE);
+    if(!stmt) return false;
     
-    if(rc != SQLITE_DONE){
+    sqlite3_bind_int64(stmt.get(), 1, static_cast<sqlite3_int64>(message_id));
+    
+    if(sqlite3_step(stmt.get()) != SQLITE_DONE){
         LOG_ERROR_STREAM("Failed to delete pending message: " << sqlite3_errmsg(db));
         return false;
     }
@@ -320,105 +580,194 @@ bool DataBaseManager::deletePendingMessage(const std::string& message_id){
     return true;
 }
 
-bool DataBaseManager::incrementRetryCount(const std::string& message_id){
+bool DataBaseManager::incrementRetryCount(MessageId message_id){
     std::lock_guard<std::mutex> lock(db_mutex);
     
-    if(!db) return false;
-    
-    const char* sql = 
-        "UPDATE pending_messages SET retry_count = retry_count + 1, "
-        "last_retry_at = CURRENT_TIMESTAMP WHERE message_id = ?;";
-    
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if(rc != SQLITE_OK){
-        return false;
-    }
-    
-    sqlite3_bind_text(stmt, 1, message_id.c_str(), -1, SQLITE_TRANSIENT);
+    auto stmt = statement(Statement::INCREMENT_RETRY_COUNT);
+    if(!stmt) return false;
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_bind_int64(stmt.get(), 1, static_cast<sqlite3_int64>(message_id));
     
-    return rc == SQLITE_DONE;
+    return sqlite3_step(stmt.get()) == SQLITE_DONE;
 }
 
-std::optional<User> DataBaseManager::getUser(const std::string& username){
+std::optional<User> DataBaseManager::getUser(const std::string& username, bool* error){
     std::lock_guard<std::mutex> lock(db_mutex);
+    if(error) *error = true;
     
-    if(!db) return std::nullopt;
-    
-    const char* sql = "SELECT id, username, password_hash, created_at, last_login FROM users WHERE username = ?;";
-    sqlite3_stmt* stmt;
+    auto stmt = statement(Statement::GET_USER);
+    if(!stmt) return std::nullopt;
     
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if(rc != SQLITE_OK){
-        return std::nullopt;
-    }
-    
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
-    
-    rc = sqlite3_step(stmt);
-    LOG_INFO_STREAM("rc = " << rc);
-    LOG_INFO_STREAM("errmsg = " << sqlite3_errmsg(db));
+    sqlite3_bind_text(stmt.get(), 1, username.c_str(), -1, SQLITE_TRANSIENT);
     
     std::optional<User> user;
+    int rc = sqlite3_step(stmt.get());
     if(rc == SQLITE_ROW){
         User u;
-        u.id = sqlite3_column_int(stmt, 0);
-        u.username = (const char*)sqlite3_column_text(stmt, 1);
-        u.password_hash = (const char*)sqlite3_column_text(stmt, 2);
-        u.created_at = (const char*)sqlite3_column_text(stmt, 3);
+        u.id = sqlite3_column_int(stmt.get(), 0);
+        u.username = (const char*)sqlite3_column_text(stmt.get(), 1);
+        u.password_hash = (const char*)sqlite3_column_text(stmt.get(), 2);
+        u.created_at = (const char*)sqlite3_column_text(stmt.get(), 3);
         
-        const char* last_login = (const char*)sqlite3_column_text(stmt, 4);
+        const char* last_login = (const char*)sqlite3_column_text(stmt.get(), 4);
         u.last_login = last_login ? last_login : "";
-        LOG_INFO_STREAM("Inside getUser - Found id = " << u.id);
         user = u;
     }
-    
-    sqlite3_finalize(stmt);
+    else if(rc != SQLITE_DONE){
+        LOG_ERROR_STREAM("Failed to look up user " << username << ": " << sqlite3_errmsg(db));
+        return std::nullopt;
+    }
+    if(error) *error = false;
     return user;
 }
 
-std::vector<PendingMessageRecord> DataBaseManager::getPendingMessagesForUser(int user_id){
+std::vector<PendingMessageRecord> DataBaseManager::getPendingMessagesForUser(int user_id, int64_t after_id, int64_t until_id, size_t limit){
     std::lock_guard<std::mutex> lock(db_mutex);
     
     std::vector<PendingMessageRecord> records;
-    if(!db) return records;
-    
-    const char* sql = 
-        "SELECT id, message_id, sender_id, receiver_id, message_content, status, "
-        "created_at, last_retry_at, retry_count "
-        "FROM pending_messages "
-        "WHERE receiver_id = ? AND (status = 'pending' OR status = 'sent') "
-        "ORDER BY created_at ASC;";
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if(rc != SQLITE_OK){
-        LOG_ERROR_STREAM("Failed to prepare get pending messages for user: " << sqlite3_errmsg(db));
-        return records;
-    }
+    auto stmt = statement(Statement::GET_PENDING_MESSAGES_FOR_USER);
+    if(!stmt) return records;
     
-    sqlite3_bind_int(stmt, 1, user_id);
+    sqlite3_bind_int(stmt.get(), 1, user_id);
+    sqlite3_bind_int64(stmt.get(), 2, after_id);
+    sqlite3_bind_int64(stmt.get(), 3, until_id);
+    sqlite3_bind_int64(stmt.get(), 4, static_cast<sqlite3_int64>(limit));
     
-    while(sqlite3_step(stmt) == SQLITE_ROW){
+    while(sqlite3_step(stmt.get()) == SQLITE_ROW){
         PendingMessageRecord rec;
-        rec.id = sqlite3_column_int(stmt, 0);
-        rec.message_id = (const char*)sqlite3_column_text(stmt, 1);
-        rec.sender_id = sqlite3_column_int(stmt, 2);
-        rec.receiver_id = sqlite3_column_int(stmt, 3);
-        rec.message_content = (const char*)sqlite3_column_text(stmt, 4);
-        rec.status = (const char*)sqlite3_column_text(stmt, 5);
-        rec.created_at = (const char*)sqlite3_column_text(stmt, 6);
-        rec.last_retry_at = (const char*)sqlite3_column_text(stmt, 7);
-        rec.retry_count = sqlite3_column_int(stmt, 8);
+        rec.id = sqlite3_column_int64(stmt.get(), 0);
+        rec.message_id = static_cast<MessageId>(sqlite3_column_int64(stmt.get(), 1));
+        rec.sender_id = sqlite3_column_int(stmt.get(), 2);
+        rec.receiver_id = sqlite3_column_int(stmt.get(), 3);
+        rec.message_content = (const char*)sqlite3_column_text(stmt.get(), 4);
+        rec.status = (const char*)sqlite3_column_text(stmt.get(), 5);
+        rec.created_at = (const char*)sqlite3_column_text(stmt.get(), 6);
+        rec.last_retry_at = (const char*)sqlite3_column_text(stmt.get(), 7);
+        rec.retry_count = sqlite3_column_int(stmt.get(), 8);
         
         records.push_back(rec);
     }
     
-    sqlite3_finalize(stmt);
-    
-    LOG_DEBUG_STREAM("Found " << records.size() << " pending messages for user_id=" << user_id);
+    LOG_DEBUG_STREAM("Found " << records.size() << " pending messages for user_id=" << user_id << " after row " << after_id);
     return records;
-}
\ No newline at end of file
+}
+
+bool DataBaseManager::recoverPendingMessages(PendingRecovery& recovery){
+    std::lock_guard<std::mutex> lock(db_mutex);
+    recovery = PendingRecovery();
+
+    if(!execute(Statement::BEGIN)){
+        LOG_ERROR_STREAM("Failed to begin recovery: " << (db ? sqlite3_errmsg(db) : "no database"));
+        return false;
+    }
+
+    bool ok = true;
+    {
+        auto stmt = statement(Statement::LAST_MESSAGE_ID);
+        ok = stmt && sqlite3_step(stmt.get()) == SQLITE_ROW;
+        if(ok && sqlite3_column_type(stmt.get(), 0) != SQLITE_NULL){
+            recovery.last_message_id = static_cast<MessageId>(sqlite3_column_int64(stmt.get(), 0));
+        }
+    }
+
+    if(ok){
+        auto stmt = statement(Statement::COUNT_UNDELIVERED_MESSAGES);
+        ok = stmt && sqlite3_step(stmt.get()) == SQLITE_ROW;
+        if(ok){
+            recovery.undelivered = static_cast<size_t>(sqlite3_column_int64(stmt.get(), 0));
+            recovery.receivers = static_cast<size_t>(sqlite3_column_int64(stmt.get(), 1));
+        }
+    }
+
+    if(!ok){
+        LOG_ERROR_STREAM("Pending message recovery failed: " << sqlite3_errmsg(db));
+        execute(Statement::ROLLBACK);
+        return false;
+    }
+    if(!execute(Statement::COMMIT)){
+        LOG_ERROR_STREAM("Failed to commit recovery: " << sqlite3_errmsg(db));
+        execute(Statement::ROLLBACK);
+        return false;
+    }
+    return true;
+}
+
+int64_t DataBaseManager::deleteExpiredMessages(const std::string& status, std::chrono::seconds keep, size_t limit){
+    std::lock_guard<std::mutex> lock(db_mutex);
+
+    if(!saveMessageIdHighWater()) return -1;
+
+    auto stmt = statement(Statement::DELETE_EXPIRED_MESSAGES);
+    if(!stmt) return -1;
+
+    std::string age = "-" + std::to_string(keep.count()) + " seconds";
+    sqlite3_bind_text(stmt.get(), 1, status.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt.get(), 2, age.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt.get(), 3, static_cast<sqlite3_int64>(limit));
+
+    if(sqlite3_step(stmt.get()) != SQLITE_DONE){
+        LOG_ERROR_STREAM("Failed to delete expired messages: " << sqlite3_errmsg(db));
+        return -1;
+    }
+    return sqlite3_changes(db);
+}
+
+// Caller holds db_mutex
+bool DataBaseManager::saveMessageIdHighWater(){
+    auto stmt = statement(Statement::SAVE_MESSAGE_ID_HIGH_WATER);
+    if(!stmt) return false;
+
+    if(sqlite3_step(stmt.get()) != SQLITE_DONE){
+        LOG_ERROR_STREAM("Failed to save the message id high-water mark: " << sqlite3_errmsg(db));
+        return false;
+    }
+    return true;
+}
+
+bool DataBaseManager::incrementalVacuum(size_t pages){
+    std::lock_guard<std::mutex> lock(db_mutex);
+    if(!db) return false;
+    if(!incremental_vacuum) return true;
+
+    std::string sql = "PRAGMA incremental_vacuum(" + std::to_string(pages) + ");";
+    char* err_msg = nullptr;
+    if(sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK){
+        LOG_ERROR_STREAM("Incremental vacuum failed: " << err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
+    return true;
+}
+
+bool DataBaseManager::getStorageStats(StorageStats& stats){
+    std::lock_guard<std::mutex> lock(db_mutex);
+    if(!db) return false;
+
+    stats = StorageStats();
+    stats.page_size = queryPragma("PRAGMA page_size;");
+    stats.page_count = queryPragma("PRAGMA page_count;");
+    stats.freelist_count = queryPragma("PRAGMA freelist_count;");
+
+    auto stmt = statement(Statement::COUNT_MESSAGES_BY_STATUS);
+    if(!stmt) return false;
+    int rc;
+    while((rc = sqlite3_step(stmt.get())) == SQLITE_ROW){
+        const char* status = (const char*)sqlite3_column_text(stmt.get(), 0);
+        stats.rows_by_status.emplace_back(status ? status : "", sqlite3_column_int64(stmt.get(), 1));
+    }
+    return rc == SQLITE_DONE && stats.page_count >= 0;
+}
+
+int64_t DataBaseManager::getLastPendingMessageRow(int user_id){
+    std::lock_guard<std::mutex> lock(db_mutex);
+
+    auto stmt = statement(Statement::LAST_PENDING_MESSAGE_ROW);
+    if(!stmt) return 0;
+
+    sqlite3_bind_int(stmt.get(), 1, user_id);
+    if(sqlite3_step(stmt.get()) != SQLITE_ROW){
+        return 0;
+    }
+    return sqlite3_column_int64(stmt.get(), 0);
+}
@@ -1,9 +1,70 @@
 #include "DataBaseThread.h"
 #include "Logger.h"
+#include "ThreadPool.h"
 
-DataBaseThread::DataBaseThread(){
-    request_queue = std::make_shared<MessageQueue<DBRequestPtr>>();
-    db_manager = std::make_shared<DataBaseManager>("../DataBase/chat_server.db");
+struct DBAwaitable::State{
+    std::atomic<bool> finished{false};
+    DBResult result;
+    std::coroutine_handle<> handle;
+    ThreadPool* pool = nullptr;
+    ThreadPool::TimerHandle timeout_timer;
+
+    // First of callback and timeout wins
+    void finish(bool success, std::string message){
+        if(finished.exchange(true)) return;
+        result.success = success;
+        result.message = std::move(message);
+        if(pool){
+            auto h = handle;
+            pool->submit([h]{ h.resume(); });
+        }
+        else{
+            handle.resume();
+        }
+    }
+};
+
+DBAwaitable::DBAwaitable(DataBaseThread* db_thread, DBRequestPtr req, std::chrono::milliseconds timeout)
+    : db_thread(db_thread),
+      req(std::move(req)),
+      timeout(timeout),
+      state(std::make_shared<State>()) {}
+
+void DBAwaitable::await_suspend(std::coroutine_handle<> h){
+    state->handle = h;
+    state->pool = ThreadPool::current();
+
+    // The coroutine may be resumed, and this awaitable destroyed, before
+    // submitRequest() returns; only locals are used from here on
+    auto shared = state;
+    auto db = db_thread;
+    auto request = req;
+
+    // The timer is armed before the request is queued, so the callback
+    // always sees its handle. Cancelling it releases the state at once
+    // instead of pinning it in the timer heap for the whole timeout.
+    request->callback = [shared](bool success, std::string& message){
+        if(shared->pool){
+            shared->pool->cancel(shared->timeout_timer);
+        }
+        shared->finish(success, message);
+    };
+    if(timeout.count() > 0 && shared->pool){
+        shared->timeout_timer = shared->pool->submitAfter(timeout, [shared]{
+            shared->finish(false, "Error: Database timeout");
+        });
+    }
+    db->submitRequest(request);
+}
+
+DBResult DBAwaitable::await_resume(){
+    return std::move(state->result);
+}
+
+DataBaseThread::DataBaseThread(const std::string& db_file) : db_file(db_file){
+    request_queue = std::make_shared<LockedMessageQueue<DBRequestPtr>>();
+    read_queue = std::make_shared<LockedMessageQueue<DBRequestPtr>>();
+    db_manager = std::make_shared<DataBaseManager>(db_file);
 }
 
 DataBaseThread::~DataBaseThread(){
@@ -15,14 +76,43 @@ void DataBaseThread::start(){
         LOG_ERROR("Failed to initialize database");
         return;
     }
+    db_manager->setStatementCaching(cache_statements);
+    
+    // A reader holding a snapshot would block a rollback-journal writer
+    std::vector<DatabaseManagerPtr> readers;
+    if(reader_count > 0 && db_manager->usesWal()){
+        for(size_t i = 0; i < reader_count; i++){
+            auto reader = std::make_shared<DataBaseManager>(db_file);
+            reader->setDurabilityProfile(db_manager->getDurabilityProfile());
+            if(!reader->initializeReadOnly()){
+                LOG_WARNING("Failed to open read connection, serving reads on the writer");
+                readers.clear();
+                break;
+            }
+            reader->setStatementCaching(cache_statements);
+            readers.push_back(reader);
+        }
+    }
+    readers_enabled = !readers.empty();
     
     running.store(true);
     worker_thread = std::thread([this](){ run(); });
-    LOG_INFO("DataBaseThread started");
+    for(auto& reader : readers){
+        reader_threads.emplace_back([this, reader](){ runReader(reader); });
+    }
+    LOG_INFO_STREAM("DataBaseThread started with " << reader_threads.size() << " read connections");
 }
 
 void DataBaseThread::stop(){
     running.store(false);
+    if(read_queue){
+        read_queue->stop();
+    }
+    for(auto& reader : reader_threads){
+        if(reader.joinable()){
+            reader.join();
+        }
+    }
     if(request_queue){
         request_queue->stop();
     }
@@ -33,100 +123,349 @@ void DataBaseThread::stop(){
 }
 
 void DataBaseThread::submitRequest(DBRequestPtr req){
-    if(request_queue){
+    // Callers wait on the callback rather than a timeout, so always answer
+    if(!running.load() || !request_queue){
+        if(req && req->callback){
+            std::string message = "Error: Database unavailable";
+            req->callback(false, message);
+        }
+        return;
+    }
+    if(isCredentialLookup(req->type)){
+        CachedCredentials credentials;
+        auto found = credential_cache.lookup(req->username, credentials);
+        if(found != CredentialCache::Lookup::MISS){
+            std::optional<CachedCredentials> cached;
+            if(found == CredentialCache::Lookup::FOUND) cached = credentials;
+            DBResult result = answerCredentials(*req, cached);
+            if(req->callback){
+                req->callback(result.success, result.message);
+            }
+            return;
+        }
+    }
+    if(readers_enabled && isReadOnly(req->type) && !isOrderedRead(req->type)){
+        read_queue->push(req);
+    }
+    else{
         request_queue->push(req);
     }
 }
 
+DBAwaitable DataBaseThread::execute(DBRequestPtr req, std::chrono::milliseconds timeout){
+    return DBAwaitable(this, std::move(req), timeout);
+}
+
+bool DataBaseThread::isReadOnly(DBOperationType type){
+    switch(type){
+        case DBOperationType::VERIFY_LOGIN:
+        case DBOperationType::GET_USER:
+        case DBOperationType::AUTHENTICATE_USER:
+        case DBOperationType::GET_PENDING_MESSAGES_FOR_USER:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Reads that must see the writes queued before them. The writer hands them
+// to the read pool once it has committed everything ahead of them.
+bool DataBaseThread::isOrderedRead(DBOperationType type){
+    return type == DBOperationType::GET_PENDING_MESSAGES_FOR_USER;
+}
+
+bool DataBaseThread::isCredentialLookup(DBOperationType type){
+    return type == DBOperationType::VERIFY_LOGIN ||
+           type == DBOperationType::GET_USER ||
+           type == DBOperationType::AUTHENTICATE_USER;
+}
+
+bool DataBaseThread::isGroupCommitted(DBOperationType type){
+    switch(type){
+        case DBOperationType::TOUCH_LAST_LOGIN:
+        case DBOperationType::ADD_PENDING_MESSAGE:
+        case DBOperationType::UPDATE_MESSAGE_STATUS:
+        case DBOperationType::DELETE_PENDING_MESSAGE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+namespace{
+    // The instance whose writer loop runs on this thread, if any
+    thread_local const DataBaseThread* writer_of = nullptr;
+}
+
 void DataBaseThread::run(){
+    writer_of = this;
+    std::vector<DBRequestPtr> batch;
+
     while(running.load()){
-        auto req_opt = request_queue->pop(100);
-        if(!req_opt.has_value()){
+        // With a group open, wait no longer than its deadline for more writes
+        int timeout_ms = -1;
+        if(!group.empty()){
+            auto remaining = std::chrono::ceil<std::chrono::milliseconds>(group_deadline - std::chrono::steady_clock::now());
+            if(remaining.count() <= 0){
+                commitGroup();
+                continue;
+            }
+            timeout_ms = static_cast<int>(remaining.count());
+        }
+
+        batch.clear();
+        if(request_queue->popBatch(batch, DEFAULT_POP_BATCH, timeout_ms) == 0){
+            commitGroup();
             if(!running.load()) break;
             continue;
         }
-        
-        auto req = req_opt.value();
-        if(req){
-            processRequest(req);
+
+        for(auto& req : batch){
+            if(!req) continue;
+
+            if(isGroupCommitted(req->type)){
+                addToGroup(std::move(req));
+                continue;
+            }
+
+            // Reads must see every write queued before them
+            commitGroup();
+            if(readers_enabled && isReadOnly(req->type)){
+                read_queue->push(std::move(req));
+                continue;
+            }
+            processRequest(*db_manager, req);
         }
     }
+    commitGroup();
+    writer_of = nullptr;
 }
 
-void DataBaseThread::processRequest(DBRequestPtr req){
+void DataBaseThread::addToGroup(DBRequestPtr req){
+    if(group.empty()){
+        group_deadline = std::chrono::steady_clock::now() + group_commit.max_delay;
+    }
+    group.push_back(std::move(req));
+    if(group.size() >= group_commit.max_batch){
+        commitGroup();
+    }
+}
+
+void DataBaseThread::runReader(DatabaseManagerPtr reader){
+    std::vector<DBRequestPtr> batch;
+    while(running.load()){
+        batch.clear();
+        if(read_queue->popBatch(batch, DEFAULT_POP_BATCH, -1) == 0){
+            if(!running.load()) break;
+            continue;
+        }
+
+        for(auto& req : batch){
+            if(req){
+                processRequest(*reader, req);
+                read_count.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+std::optional<CachedCredentials> DataBaseThread::loadCredentials(DataBaseManager& db, const std::string& username, bool& error){
+    uint64_t generation = credential_cache.generation();
+    auto user = db.getUser(username, &error);
+    if(error){
+        return std::nullopt;
+    }
+
+    std::optional<CachedCredentials> credentials;
+    if(user.has_value()){
+        credentials = CachedCredentials{user->id, user->password_hash, user->last_login};
+    }
+    credential_cache.store(username, credentials, generation);
+    return credentials;
+}
+
+// Runs on the caller's thread for cache hits, on a DB thread otherwise
+DBResult DataBaseThread::answerCredentials(DBRequest& req, const std::optional<CachedCredentials>& credentials){
+    if(req.type == DBOperationType::GET_USER){
+        if(!credentials){
+            return DBResult{false, "User not found"};
+        }
+        return DBResult{true, std::to_string(credentials->id)};
+    }
+
+    if(!credentials || credentials->password_hash != DataBaseManager::hashPassword(req.password)){
+        return DBResult{false, "Error: Invalid username or password"};
+    }
+
+    touchLastLogin(req.username);
+    if(req.type == DBOperationType::VERIFY_LOGIN){
+        return DBResult{true, "Success: Login successful"};
+    }
+    req.user_id = credentials->id;
+    return DBResult{true, std::to_string(credentials->id)};
+}
+
+// The writer adds the stamp to its own open group rather than queueing to
+// itself; other threads never wait for queue space and drop the stamp
+// instead, as last_login is only informational
+void DataBaseThread::touchLastLogin(const std::string& username){
+    auto req = std::make_shared<DBRequest>();
+    req->type = DBOperationType::TOUCH_LAST_LOGIN;
+    req->username = username;
+    if(writer_of == this){
+        addToGroup(std::move(req));
+        return;
+    }
+    if(!request_queue->offer(req)){
+        LOG_DEBUG_STREAM("DB queue full, dropped the last_login stamp of " << username);
+    }
+}
+
+void DataBaseThread::commitGroup(){
+    if(group.empty()) return;
+
+    // Callbacks may log someone in, which opens the next group
+    std::vector<DBRequestPtr> committing;
+    committing.swap(group);
+
+    commit_count.fetch_add(1, std::memory_order_relaxed);
+    grouped_write_count.fetch_add(committing.size(), std::memory_order_relaxed);
+
+    // Not worth a transaction; also the fallback when BEGIN fails
+    if(committing.size() == 1 || !db_manager->beginTransaction()){
+        for(auto& req : committing){
+            processRequest(*db_manager, req);
+        }
+        return;
+    }
+
+    std::vector<DBResult> results;
+    results.reserve(committing.size());
+    for(auto& req : committing){
+        results.push_back(applyRequest(*db_manager, *req));
+    }
+
+    if(!db_manager->commitTransaction()){
+        db_manager->rollbackTransaction();
+        for(auto& result : results){
+            result.success = false;
+            result.message = "Error: Commit failed";
+        }
+    }
+
+    for(size_t i = 0; i < committing.size(); i++){
+        if(committing[i]->callback){
+            committing[i]->callback(results[i].success, results[i].message);
+        }
+    }
+}
+
+void DataBaseThread::processRequest(DataBaseManager& db, DBRequestPtr req){
+    DBResult result = applyRequest(db, *req);
+    if(req->callback){
+        req->callback(result.success, result.message);
+    }
+}
+
+DBResult DataBaseThread::applyRequest(DataBaseManager& db, DBRequest& req){
     bool success = false;
     std::string message;
     
-    switch(req->type){
+    switch(req.type){
         case DBOperationType::REGISTER_USER:
-            if(db_manager->usernameExists(req->username)){
+            if(db.usernameExists(req.username)){
                 success = false;
                 message = "Error: Username already exists";
             }
             else{
-                success = db_manager->registerUser(req->username, req->password);
+                success = db.registerUser(req.username, req.password);
                 message = success ? "Success: User registered" : "Error: Registration failed";
             }
+            // Drops a cached "no such user" before anyone can log in
+            credential_cache.invalidate(req.username);
             break;
             
         case DBOperationType::VERIFY_LOGIN:
-            success = db_manager->verifyLogin(req->username, req->password);
-            if(success){
-                db_manager->updateLastLogin(req->username);
-                message = "Success: Login successful";
-            }
-            else{
-                message = "Error: Invalid username or password";
-            }
-            break;
-            
         case DBOperationType::GET_USER:
+        case DBOperationType::AUTHENTICATE_USER:
             {
-                auto user = db_manager->getUser(req->username);
-                if(user.has_value()){
-                    success = true;
-                    message = std::to_string(user->id);
-                }
-                else{
-                    success = false;
-                    message = "User not found";
+                bool error = false;
+                auto credentials = loadCredentials(db, req.username, error);
+                if(error){
+                    message = "Error: Database error";
+                    break;
                 }
+                return answerCredentials(req, credentials);
+            }
+
+        case DBOperationType::TOUCH_LAST_LOGIN:
+            success = db.updateLastLogin(req.username);
+            if(success){
+                credential_cache.recordLogin(req.username);
             }
+            message = success ? "Last login updated" : "Failed to update last login";
             break;
 
         case DBOperationType::ADD_PENDING_MESSAGE:
-            success = db_manager->addPendingMessage(req->message_id, req->sender_id, req->receiver_id, req->message_content);
+            success = db.addPendingMessage(req.message_id, req.sender_id, req.receiver_id, req.message_content);
             message = success ? "Message added to pending queue" : "Failed to add message";
             break;
 
         case DBOperationType::UPDATE_MESSAGE_STATUS:
-            success = db_manager->updateMessageStatus(req->message_id, req->status);
+            if(!req.message_ids.empty()){
+                success = db.updateMessageStatus(req.message_ids, req.status);
+                message = success ? "Message status updated" : "Failed to update status";
+                break;
+            }
+            success = db.updateMessageStatus(req.message_id, req.status);
             message = success ? "Message status updated" : "Failed to update status";
             
-            if(success && req->status == "sent"){
-                db_manager->incrementRetryCount(req->message_id);
+            if(success && req.status == "sent"){
+                db.incrementRetryCount(req.message_id);
             }
             break;
 
         case DBOperationType::DELETE_PENDING_MESSAGE:
-            success = db_manager->deletePendingMessage(req->message_id);
+            success = db.deletePendingMessage(req.message_id);
             message = success ? "Message removed from pending queue" : "Failed to remove message";
             break;
 
         case DBOperationType::GET_PENDING_MESSAGES_FOR_USER:
             {
-                req->pending_messages = db_manager->getPendingMessagesForUser(req->user_id);
+                if(req.replay_until == 0){
+                    req.replay_until = db.getLastPendingMessageRow(req.user_id);
+                }
+                req.pending_messages = db.getPendingMessagesForUser(req.user_id, req.replay_after, req.replay_until, req.replay_limit);
                 success = true;
-                message = "Loaded " + std::to_string(req->pending_messages.size()) + " pending messages for user";
+                message = "Loaded " + std::to_string(req.pending_messages.size()) + " pending messages for user";
                 
-                if(!req->pending_messages.empty()){
-                    LOG_INFO_STREAM("Found " << req->pending_messages.size() << " pending messages for user_id=" << req->user_id);
+                if(!req.pending_messages.empty()){
+                    LOG_INFO_STREAM("Found " << req.pending_messages.size() << " pending messages for user_id=" << req.user_id);
                 }
             }
             break;
+
+        case DBOperationType::RECOVER_PENDING_MESSAGES:
+            success = db.recoverPendingMessages(req.recovery);
+            message = success ? "Recovered pending messages" : "Failed to recover pending messages";
+            break;
+
+        case DBOperationType::DELETE_EXPIRED_MESSAGES:
+            req.affected = db.deleteExpiredMessages(req.status, req.retention, req.limit);
+            success = req.affected >= 0;
+            message = success ? "Deleted " + std::to_string(req.affected) + " " + req.status + " messages" : "Failed to delete expired messages";
+            break;
+
+        case DBOperationType::INCREMENTAL_VACUUM:
+            success = db.incrementalVacuum(req.limit);
+            message = success ? "Vacuumed" : "Incremental vacuum failed";
+            break;
+
+        case DBOperationType::GET_STORAGE_STATS:
+            success = db.getStorageStats(req.storage);
+            message = success ? "Storage stats loaded" : "Failed to load storage stats";
+            break;
     }
     
-    if(req->callback){
-        req->callback(success, message);
-    }
+    return DBResult{success, std::move(message)};
 }
\ No newline at end of file
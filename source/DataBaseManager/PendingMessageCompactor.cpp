@@ -0,0 +1,134 @@
+#include "PendingMessageCompactor.h"
+#include "Logger.h"
+#include <future>
+#include <sstream>
+
+PendingMessageCompactor::PendingMessageCompactor(DataBaseThreadPtr db_thread, const CompactionConfig& config)
+    : db_thread(db_thread),
+      config(config) {}
+
+PendingMessageCompactor::~PendingMessageCompactor(){
+    stop();
+}
+
+void PendingMessageCompactor::start(){
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if(worker_thread.joinable()) return;
+        stop_requested = false;
+    }
+    worker_thread = std::thread([this](){ run(); });
+    LOG_INFO_STREAM("PendingMessageCompactor started, every " << config.interval.count() << "s");
+}
+
+void PendingMessageCompactor::stop(){
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop_requested = true;
+    }
+    wake.notify_all();
+    if(worker_thread.joinable()){
+        worker_thread.join();
+        LOG_INFO("PendingMessageCompactor stopped");
+    }
+}
+
+bool PendingMessageCompactor::pause(std::chrono::milliseconds duration){
+    std::unique_lock<std::mutex> lock(mtx);
+    wake.wait_for(lock, duration, [this]{ return stop_requested; });
+    return !stop_requested;
+}
+
+void PendingMessageCompactor::run(){
+    while(pause(config.interval)){
+        compact();
+    }
+}
+
+bool PendingMessageCompactor::call(DBRequestPtr req){
+    auto done = std::make_shared<std::promise<bool>>();
+    auto finished = done->get_future();
+    req->callback = [done](bool success, std::string& result){
+        if(!success){
+            LOG_ERROR_STREAM("[Compaction] " << result);
+        }
+        done->set_value(success);
+    };
+    db_thread->submitRequest(req);
+    return finished.get();
+}
+
+bool PendingMessageCompactor::loadStats(StorageStats& stats){
+    auto req = std::make_shared<DBRequest>();
+    req->type = DBOperationType::GET_STORAGE_STATS;
+    if(!call(req)){
+        return false;
+    }
+    stats = std::move(req->storage);
+    return true;
+}
+
+void PendingMessageCompactor::compact(){
+    auto start = std::chrono::steady_clock::now();
+    StorageStats before;
+    if(!loadStats(before)){
+        return;
+    }
+
+    std::ostringstream deleted_by_status;
+    int64_t deleted = 0;
+    size_t chunks = 0;
+    bool stopping = false;
+    for(const RetentionRule& rule : config.retention){
+        int64_t deleted_for_rule = 0;
+        while(!stopping){
+            auto req = std::make_shared<DBRequest>();
+            req->type = DBOperationType::DELETE_EXPIRED_MESSAGES;
+            req->status = rule.status;
+            req->retention = rule.keep;
+            req->limit = config.chunk_rows;
+            if(!call(req)){
+                break;
+            }
+            chunks++;
+            deleted_for_rule += req->affected;
+            if(static_cast<size_t>(req->affected) < config.chunk_rows){
+                break;
+            }
+            stopping = !pause(config.chunk_pause);
+        }
+        deleted += deleted_for_rule;
+        deleted_by_status << " " << rule.status << "=" << deleted_for_rule;
+    }
+
+    // Deleted rows only land on the freelist; hand the pages back in steps
+    StorageStats after;
+    if(!loadStats(after)){
+        return;
+    }
+    while(!stopping && after.freelist_count > 0){
+        auto req = std::make_shared<DBRequest>();
+        req->type = DBOperationType::INCREMENTAL_VACUUM;
+        req->limit = config.vacuum_pages;
+        int64_t free_before = after.freelist_count;
+        if(!call(req) || !loadStats(after) || after.freelist_count >= free_before){
+            break;
+        }
+        stopping = !pause(config.chunk_pause);
+    }
+
+    int64_t reclaimed = before.page_count > after.page_count ? before.page_count - after.page_count : 0;
+    pass_count.fetch_add(1, std::memory_order_relaxed);
+    deleted_rows.fetch_add(static_cast<uint64_t>(deleted), std::memory_order_relaxed);
+    reclaimed_pages.fetch_add(static_cast<uint64_t>(reclaimed), std::memory_order_relaxed);
+
+    std::ostringstream rows;
+    for(const auto& [status, count] : after.rows_by_status){
+        rows << " " << status << "=" << count;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    LOG_INFO_STREAM("[Compaction] Deleted" << deleted_by_status.str() << " in " << chunks << " chunk(s), reclaimed "
+                    << reclaimed << " pages (" << reclaimed * after.page_size / 1024 << " KiB) in " << elapsed.count() << " ms; "
+                    << "database " << after.page_count * after.page_size / 1024 << " KiB, " << after.freelist_count
+                    << " free pages; rows" << rows.str());
+}
@@ -1,10 +1,10 @@
-#include <sstream>
-#include <iomanip>
 #include "Responser.h"
 #include "MessageAckManager.h"
 #include "Logger.h"
 
-MessageAckManager::MessageAckManager() {}
+MessageAckManager::MessageAckManager()
+    : ack_timers(DEFAULT_TIMER_RESOLUTION, TIMER_SLOTS),
+      last_stats_log(std::chrono::steady_clock::now()) {}
 
 MessageAckManager::~MessageAckManager(){}
 
@@ -13,21 +13,49 @@ MessageAckManager& MessageAckManager::getInstance(){
     return instance;
 }
 
-void MessageAckManager::setDatabaseThread(DataBaseThreadPtr thread){
-    db_thread = thread;
-    LOG_INFO("MessageAckManager: Database thread set");
+void MessageAckManager::setOfflineStore(OfflineMessageStorePtr store){
+    offline_store = store;
+    LOG_INFO_STREAM("MessageAckManager: Offline store set (" << store->name() << ")");
 }
 
-std::string MessageAckManager::generateMessageId(){
-    uint64_t id = message_id_counter.fetch_add(1);
-    std::ostringstream oss;
-    oss << "MSG_" << std::setfill('0') << std::setw(10) << id;
-    return oss.str();
+void MessageAckManager::setExecutor(std::shared_ptr<ThreadPool> pool){
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    executor = pool;
 }
 
-void MessageAckManager::addPendingMessage(const std::string& msg_id, HandlerResponsePtr response, ConnectionPtr conn,int sender_id,int receiver_id, const std::string& message_content){
+void MessageAckManager::setResponseDispatcher(ResponserPtr dispatcher){
     std::lock_guard<std::mutex> lock(pending_mutex);
-    
+    response_dispatcher = dispatcher;
+}
+
+bool MessageAckManager::setTimerResolution(std::chrono::milliseconds resolution){
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    if(ack_timers.size() > 0){
+        return false;
+    }
+    ack_timers = TimingWheel<MessageId>(resolution, TIMER_SLOTS);
+    return true;
+}
+
+std::chrono::milliseconds MessageAckManager::getTimerResolution(){
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    return ack_timers.resolution();
+}
+
+void MessageAckManager::trackPending(PendingMessage& pending){
+    auto it = pending_messages.find(pending.message_id);
+    if(it != pending_messages.end()){
+        ack_timers.cancel(it->second.timer);
+    }
+    pending.timer = ack_timers.schedule(pending.message_id, std::chrono::milliseconds(ACK_TIMEOUT_MS));
+    pending_messages[pending.message_id] = pending;
+}
+
+MessageId MessageAckManager::generateMessageId(){
+    return message_id_counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MessageAckManager::addPendingMessage(MessageId msg_id, HandlerResponsePtr response, ConnectionPtr conn,int sender_id,int receiver_id, const std::string& message_content){
     PendingMessage pending;
     pending.message_id = msg_id;
     pending.responser = response;
@@ -38,232 +66,273 @@ void MessageAckManager::addPendingMessage(const std::string& msg_id, HandlerResp
     pending.receiver_id = receiver_id;
     pending.message_content = message_content;
 
-    pending_messages[msg_id] = pending;
-    
+    // Store calls are never made under pending_mutex: the store's callbacks
+    // take it. Queued before tracking, so any ACK's update comes after it.
     persistPendingMessage(pending);
-    
-    LOG_DEBUG_STREAM("[ACK] Added pending message: " << msg_id << " from user_id=" << sender_id << " to user_id=" << receiver_id);
-}
 
-void MessageAckManager::acknowledgeMessage(const std::string& msg_id){
-    std::lock_guard<std::mutex> lock(pending_mutex);
-    
-    auto it = pending_messages.find(msg_id);
-    if(it != pending_messages.end()){
-        LOG_DEBUG_STREAM("[ACK] Acknowledged message: " << msg_id);
-        updateMessageStatusInDB(msg_id, "acknowledged");
-        pending_messages.erase(it);
-        //removeMessageFromDB(msg_id);
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        trackPending(pending);
     }
+    
+    LOG_DEBUG_STREAM("[ACK] Added pending message: " << msg_id << " from user_id=" << sender_id << " to user_id=" << receiver_id);
 }
 
-void MessageAckManager::resendMessage(const PendingMessage& msg){
-    if(!msg.connection || msg.connection->isClosed()){
-        LOG_WARNING_STREAM("[ACK] Cannot resend to closed connection, sender_id=" << msg.sender_id << " receiver_id=" << msg.receiver_id);
+void MessageAckManager::acknowledgeMessage(MessageId msg_id){
+    int refill_user = -1;
+    bool acknowledged = false;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
         
-        updateMessageStatusInDB(msg.message_id, "pending");
-        return;
+        auto it = pending_messages.find(msg_id);
+        if(it != pending_messages.end()){
+            LOG_DEBUG_STREAM("[ACK] Acknowledged message: " << msg_id);
+            ack_timers.cancel(it->second.timer);
+            refill_user = releaseReplaySlot(it->second);
+            pending_messages.erase(it);
+            acknowledged = true;
+            //removeMessageFromStore(msg_id);
+        }
     }
-    
-    if(!msg.responser){
-        LOG_ERROR_STREAM("[ACK] Cannot resend - null response for " << msg.message_id);
-        updateMessageStatusInDB(msg.message_id, "pending");
-        return;
+    if(acknowledged){
+        updateMessageStatusInStore(msg_id, "acknowledged");
     }
-    
-    std::string full_msg = msg.message_id + "|" + msg.message_content + "\n";
-    int target_fd = (msg.responser->destination == ResponseDestination::DIRECT_TO_CLIENT) ? msg.responser->user_destination : msg.responser->fd;
-    
-    if(target_fd < 0){
-        LOG_ERROR_STREAM("[ACK] Invalid target_fd for resend: " << msg.message_id);
-        updateMessageStatusInDB(msg.message_id, "pending");
-        return;
+    if(refill_user >= 0){
+        fetchReplayPage(refill_user);
     }
-    
-    const char* data = full_msg.data();
-    size_t remaining = full_msg.size();
-    size_t total_sent = 0;
-
-    int send_attempts = 0;
-    const int MAX_SEND_ATTEMPTS = 10;
+}
 
-    while(remaining > 0 && send_attempts < MAX_SEND_ATTEMPTS ){
-        ssize_t sent = send(target_fd, data + total_sent, remaining, MSG_NOSIGNAL | MSG_DONTWAIT);
-        
-        if(sent < 0){
-            if(errno == EAGAIN || errno == EWOULDBLOCK){
-                send_attempts++;
-                if(send_attempts >= MAX_SEND_ATTEMPTS){
-                    LOG_ERROR_STREAM("[ACK] Resend blocked after " << MAX_SEND_ATTEMPTS << " attempts for " << msg.message_id);
-                    updateMessageStatusInDB(msg.message_id, "pending");
-                    return;
-                }
-                usleep(100);
+size_t MessageAckManager::acknowledgeMessages(const std::vector<MessageIdRange>& ranges, const ConnectionPtr& conn){
+    std::vector<MessageId> acknowledged;
+    int refill_user = -1;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        for(const MessageIdRange& range : ranges){
+            if(range.last - range.first >= MAX_ACK_RANGE){
+                LOG_WARNING_STREAM("[ACK] Ignoring ACK range " << range.first << "-" << range.last << " wider than " << MAX_ACK_RANGE);
                 continue;
             }
-            
-            LOG_ERROR_STREAM("[ACK] Resend failed for " << msg.message_id << " to fd=" << target_fd << ": " << strerror(errno));
-            updateMessageStatusInDB(msg.message_id, "pending");
-            return;
+            for(MessageId msg_id = range.first; ; msg_id++){
+                auto it = pending_messages.find(msg_id);
+                if(it != pending_messages.end() && it->second.connection == conn){
+                    ack_timers.cancel(it->second.timer);
+                    int user = releaseReplaySlot(it->second);
+                    if(user >= 0) refill_user = user;
+                    pending_messages.erase(it);
+                    acknowledged.push_back(msg_id);
+                }
+                if(msg_id == range.last) break;
+            }
         }
+    }
 
-        total_sent += sent;
-        remaining -= sent;
-        send_attempts = 0;
+    size_t count = acknowledged.size();
+    if(count > 0){
+        LOG_DEBUG_STREAM("[ACK] Acknowledged " << count << " messages in " << ranges.size() << " range(s)");
+        updateMessageStatusInStore(std::move(acknowledged), "acknowledged");
     }
-    
-    if(remaining > 0){
-        LOG_ERROR_STREAM("[ACK] Partial resend for " << msg.message_id << ", sent=" << total_sent << "/" << full_msg.size());
-        updateMessageStatusInDB(msg.message_id, "pending");
-        return;
+    // Every message of one line came over one connection, so one user at most
+    if(refill_user >= 0){
+        fetchReplayPage(refill_user);
     }
+    return count;
+}
 
-    LOG_INFO_STREAM("[ACK] Resent message " << msg.message_id << " to fd=" << target_fd << " (retry " << msg.retry_count + 1 << ")");
-    
-    if(db_thread){
-        auto req = std::make_shared<DBRequest>();
-        req->type = DBOperationType::UPDATE_MESSAGE_STATUS;
-        req->message_id = msg.message_id;
-        req->status = "sent";
-        db_thread->submitRequest(req);
+bool MessageAckManager::isBacklogged(const ConnectionPtr& conn){
+    return conn->getWriteQueueSize() >= MAX_RESEND_BACKLOG;
+}
+
+void MessageAckManager::resendMessage(const ConnectionPtr& conn, MessageId msg_id, const std::string& message_content, int retry){
+    ResponserPtr dispatcher;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        dispatcher = response_dispatcher;
     }
+    if(!dispatcher){
+        LOG_ERROR_STREAM("[ACK] Cannot resend " << msg_id << " - response dispatcher not set");
+        updateMessageStatusInStore(msg_id, "pending");
+        return;
+    }
+
+    dispatcher->deliver(conn, MessageIdFormat::frame(msg_id, message_content));
+    LOG_INFO_STREAM("[ACK] Queued resend of message " << msg_id << " to fd=" << conn->getFd() << " (retry " << retry << ")");
+    updateMessageStatusInStore(msg_id, "sent");
 }
 
 void MessageAckManager::checkTimeouts(){
-    std::lock_guard<std::mutex> lock(pending_mutex);
-    
-    auto now = std::chrono::system_clock::now();
-    std::vector<std::string> to_remove;
-    
-    for(auto& [msg_id, pending] : pending_messages){
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - pending.send_time).count();
-        
-        if(elapsed >= ACK_TIMEOUT_MS){
+    struct Resend{
+        ConnectionPtr conn;
+        MessageId message_id;
+        std::string message_content;
+        int retry;
+    };
+    std::vector<Resend> resends;
+    std::vector<MessageId> unreachable;
+    std::vector<MessageId> failed;
+    std::vector<int> refill_users;
+
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+
+        expired_timers.clear();
+        ack_timers.advance(expired_timers);
+
+        auto now = std::chrono::system_clock::now();
+        for(MessageId msg_id : expired_timers){
+            auto it = pending_messages.find(msg_id);
+            if(it == pending_messages.end()){
+                continue;
+            }
+            PendingMessage& pending = it->second;
+
             if(pending.retry_count >= pending.max_retries){
                 LOG_WARNING_STREAM("[ACK] Message " << msg_id << " failed after " << pending.max_retries << " retries, marking as failed");
-                updateMessageStatusInDB(msg_id, "failed"); 
-                to_remove.push_back(msg_id);
+                failed.push_back(msg_id);
+                int refill_user = releaseReplaySlot(pending);
+                if(refill_user >= 0) refill_users.push_back(refill_user);
+                pending_messages.erase(it);
+                continue;
             }
-            else{
-                LOG_WARNING_STREAM("[ACK] Message " << msg_id << " timeout, resending...");
-                pending.retry_count++;
-                pending.send_time = now;
-                resendMessage(pending);
+
+            pending.timer = ack_timers.schedule(msg_id, std::chrono::milliseconds(ACK_TIMEOUT_MS));
+
+            // A client that has not drained what it already has gets nothing
+            // more; the retry is not spent and the next timeout tries again
+            if(pending.connection && !pending.connection->isClosed() && isBacklogged(pending.connection)){
+                LOG_DEBUG_STREAM("[ACK] Message " << msg_id << " timeout, fd=" << pending.connection->getFd() << " backlogged, deferring resend");
+                continue;
             }
+
+            LOG_WARNING_STREAM("[ACK] Message " << msg_id << " timeout, resending...");
+            pending.retry_count++;
+            pending.send_time = now;
+            if(!pending.connection || pending.connection->isClosed()){
+                unreachable.push_back(msg_id);
+                continue;
+            }
+            resends.push_back(Resend{pending.connection, msg_id, pending.message_content, pending.retry_count});
+        }
+
+        auto steady_now = std::chrono::steady_clock::now();
+        if(steady_now - last_stats_log >= std::chrono::seconds(60)){
+            last_stats_log = steady_now;
+            LOG_DEBUG_STREAM("[ACK] Stats: " << pending_messages.size() << " pending messages");
         }
     }
-    
-    for(const auto& msg_id : to_remove){
-        pending_messages.erase(msg_id);
+
+    if(!failed.empty()){
+        updateMessageStatusInStore(std::move(failed), "failed");
     }
-        
-    static int check_count = 0;
-    if(++check_count % 60 == 0){
-        LOG_DEBUG_STREAM("[ACK] Stats: " << pending_messages.size() << " pending messages");
+    for(MessageId msg_id : unreachable){
+        LOG_WARNING_STREAM("[ACK] Cannot resend " << msg_id << " to closed connection");
+        updateMessageStatusInStore(msg_id, "pending");
+    }
+    for(const Resend& resend : resends){
+        resendMessage(resend.conn, resend.message_id, resend.message_content, resend.retry);
+    }
+    for(int user_id : refill_users){
+        fetchReplayPage(user_id);
     }
 }
 
 void MessageAckManager::persistPendingMessage(const PendingMessage& msg){
-    if(!db_thread){
-        LOG_WARNING("[ACK] Cannot persist message - database thread not set");
+    if(!offline_store){
+        LOG_WARNING("[ACK] Cannot persist message - offline store not set");
         return;
     }
-    
-    auto req = std::make_shared<DBRequest>();
-    req->type = DBOperationType::ADD_PENDING_MESSAGE;
-    req->message_id = msg.message_id;
-    req->sender_id = msg.sender_id;
-    req->receiver_id = msg.receiver_id;
-    req->message_content = msg.message_content;
-
-    // Capture msg_id by value to avoid dangling reference
-    std::string msg_id_copy = msg.message_id;
-    req->callback = [msg_id_copy](bool success, std::string& result){
+
+    MessageId msg_id_copy = msg.message_id;
+    offline_store->append(msg.message_id, msg.sender_id, msg.receiver_id, msg.message_content,
+        [msg_id_copy](bool success, std::string& result){
+            if(success){
+                LOG_DEBUG_STREAM("[ACK] Persisted message: " << msg_id_copy);
+            }
+            else{
+                LOG_ERROR_STREAM("[ACK] Failed to persist message: " << msg_id_copy << " - " << result);
+            }
+        });
+}
+
+void MessageAckManager::updateMessageStatusInStore(MessageId msg_id, const std::string& status){
+    if(!offline_store){
+        return;
+    }
+
+    MessageId msg_id_copy = msg_id;
+    std::string status_copy = status;
+    offline_store->updateStatus(msg_id, status, [msg_id_copy, status_copy](bool success, std::string& result){
         if(success){
-            LOG_DEBUG_STREAM("[ACK] Persisted message to DB: " << msg_id_copy);
+            LOG_DEBUG_STREAM("[ACK] Updated message " << msg_id_copy << " status to: " << status_copy);
         }
         else{
-            LOG_ERROR_STREAM("[ACK] Failed to persist message: " << msg_id_copy << " - " << result);
+            LOG_ERROR_STREAM("[ACK] Failed to update status: " << result);
         }
-    };
-    
-    db_thread->submitRequest(req);
+    });
 }
 
-void MessageAckManager::updateMessageStatusInDB(const std::string& msg_id, const std::string& status){
-    if(!db_thread){
+void MessageAckManager::updateMessageStatusInStore(std::vector<MessageId> msg_ids, const std::string& status){
+    if(!offline_store){
         return;
     }
-    
-    auto req = std::make_shared<DBRequest>();
-    req->type = DBOperationType::UPDATE_MESSAGE_STATUS;
-    req->message_id = msg_id;
-    req->status = status;
 
-    std::string msg_id_copy = msg_id;
+    size_t count = msg_ids.size();
     std::string status_copy = status;
-    req->callback = [msg_id_copy, status_copy](bool success, std::string& result){
+    offline_store->updateStatus(std::move(msg_ids), status, [count, status_copy](bool success, std::string& result){
         if(success){
-            LOG_DEBUG_STREAM("[ACK] Updated message " << msg_id_copy << " status to: " << status_copy);
+            LOG_DEBUG_STREAM("[ACK] Updated " << count << " messages status to: " << status_copy);
         }
         else{
             LOG_ERROR_STREAM("[ACK] Failed to update status: " << result);
         }
-    };
-    
-    db_thread->submitRequest(req);
+    });
 }
 
-void MessageAckManager::removeMessageFromDB(const std::string& msg_id){
-    if(!db_thread){
+void MessageAckManager::removeMessageFromStore(MessageId msg_id){
+    if(!offline_store){
         return;
     }
-    
-    auto req = std::make_shared<DBRequest>();
-    req->type = DBOperationType::DELETE_PENDING_MESSAGE;
-    req->message_id = msg_id;
 
-    std::string msg_id_copy = msg_id;
-    req->callback = [msg_id_copy](bool success, std::string& result){
+    MessageId msg_id_copy = msg_id;
+    offline_store->remove(msg_id, [msg_id_copy](bool success, std::string& result){
         if(success){
-            LOG_DEBUG_STREAM("[ACK] Removed message from DB: " << msg_id_copy);
+            LOG_DEBUG_STREAM("[ACK] Removed message: " << msg_id_copy);
         }
         else{
-            LOG_ERROR_STREAM("[ACK] Failed to remove from DB: " << result);
+            LOG_ERROR_STREAM("[ACK] Failed to remove message: " << result);
         }
-    };
-    
-    db_thread->submitRequest(req);
+    });
 }
 
-// void MessageAckManager::loadPendingMessagesFromDB(){
-//     if(!db_thread){
-//         LOG_WARNING("[ACK] Cannot load pending messages - database thread not set");
-//         return;
-//     }
-    
-//     LOG_INFO("[ACK] Loading pending messages from database...");
-    
-//     auto req = std::make_shared<DBRequest>();
-//     req->type = DBOperationType::GET_PENDING_MESSAGES;
-//     req->callback = [this](bool success, std::string& result){
-//         if(success){
-//             LOG_INFO_STREAM("[ACK] " << result);
-//             // Note: Actual restoration of PendingMessage objects would require
-//             // mapping user IDs back to current connections, which may not exist yet
-//             // This is mainly for auditing/cleanup of stale messages
-//         }
-//         else{
-//             LOG_ERROR_STREAM("[ACK] Failed to load pending messages: " << result);
-//         }
-//     };
-    
-//     db_thread->submitRequest(req);
-// }
+bool MessageAckManager::recoverPendingMessages(){
+    if(!offline_store){
+        LOG_WARNING("[ACK] Cannot recover pending messages - offline store not set");
+        return false;
+    }
+
+    LOG_INFO_STREAM("[ACK] Recovering pending messages from " << offline_store->name() << " store...");
+    auto start = std::chrono::steady_clock::now();
+
+    PendingRecovery recovery;
+    if(!offline_store->recover(recovery)){
+        return false;
+    }
+
+    MessageId next_id = recovery.last_message_id ? *recovery.last_message_id + 1 : 0;
+    MessageId current = message_id_counter.load();
+    while(current < next_id && !message_id_counter.compare_exchange_weak(current, next_id)){}
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    // Nothing is loaded here: the undelivered rows are counted, and each
+    // user's login replays them
+    LOG_INFO_STREAM("[ACK] Recovered: " << recovery.undelivered << " undelivered messages for " << recovery.receivers
+                    << " users, next message id " << message_id_counter.load()
+                    << ", in " << static_cast<int>(seconds * 1000) << " ms");
+    return true;
+}
 
 void MessageAckManager::sendPendingMessagesToUser(int user_id, int fd, ConnectionPtr conn){
-    if(!db_thread){
-        LOG_WARNING("[ACK] Cannot send pending messages - database thread not set");
+    if(!offline_store){
+        LOG_WARNING("[ACK] Cannot send pending messages - offline store not set");
         return;
     }
     
@@ -273,91 +342,170 @@ void MessageAckManager::sendPendingMessagesToUser(int user_id, int fd, Connectio
     }
     
     LOG_INFO_STREAM("[ACK] Checking pending messages for user_id=" << user_id << " fd=" << fd);
-    
-    auto req = std::make_shared<DBRequest>();
-    req->type = DBOperationType::GET_PENDING_MESSAGES_FOR_USER;
-    req->user_id = user_id;
-    
-    req->callback = [this, user_id, fd, conn, req](bool success, std::string& result_str){
+
+    {
+        // A new login restarts the replay; the old cursor's pages and
+        // window slots no longer match its generation
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        ReplayCursor& cursor = replays[user_id];
+        cursor = ReplayCursor();
+        cursor.connection = conn;
+        cursor.generation = ++replay_generation;
+    }
+    fetchReplayPage(user_id);
+}
+
+int MessageAckManager::releaseReplaySlot(const PendingMessage& pending){
+    if(pending.replay == 0){
+        return -1;
+    }
+    auto it = replays.find(pending.receiver_id);
+    if(it == replays.end() || it->second.generation != pending.replay){
+        return -1;
+    }
+
+    ReplayCursor& cursor = it->second;
+    cursor.in_flight--;
+    if(cursor.exhausted){
+        if(cursor.in_flight == 0){
+            LOG_INFO_STREAM("[ACK] Replay to user_id=" << pending.receiver_id << " complete, " << cursor.replayed << " messages");
+            replays.erase(it);
+        }
+        return -1;
+    }
+    return (!cursor.fetching && cursor.in_flight <= REPLAY_REFILL) ? pending.receiver_id : -1;
+}
+
+void MessageAckManager::fetchReplayPage(int user_id){
+    OfflinePage page;
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        auto it = replays.find(user_id);
+        if(it == replays.end()){
+            return;
+        }
+        ReplayCursor& cursor = it->second;
+        if(cursor.fetching || cursor.exhausted || cursor.in_flight > REPLAY_REFILL){
+            return;
+        }
+        if(cursor.connection->isClosed()){
+            LOG_DEBUG_STREAM("[ACK] user_id=" << user_id << " disconnected, dropping replay after " << cursor.replayed << " messages");
+            replays.erase(it);
+            return;
+        }
+
+        cursor.fetching = true;
+        generation = cursor.generation;
+        page.receiver_id = user_id;
+        page.after = cursor.after_id;
+        page.until = cursor.until_id;
+        page.limit = REPLAY_WINDOW - cursor.in_flight;
+    }
+
+    offline_store->fetchPage(std::move(page), [this, user_id, generation](bool success, OfflinePage& loaded){
         if(!success){
-            LOG_ERROR_STREAM("[ACK] Failed to get pending messages for user_id=" << user_id << ": " << result_str);
+            LOG_ERROR_STREAM("[ACK] Failed to get pending messages for user_id=" << user_id);
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            auto it = replays.find(user_id);
+            if(it != replays.end() && it->second.generation == generation){
+                replays.erase(it);
+            }
             return;
         }
-        
-        if(!db_thread){
+
+        // Delivering a page queues more store work; keep it off the store's
+        // own thread
+        std::shared_ptr<ThreadPool> pool;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            pool = executor;
+        }
+        if(!pool){
+            deliverReplayPage(user_id, generation, loaded);
             return;
         }
-        
-        const auto& pending_msgs = req->pending_messages;
-        
-        if(pending_msgs.empty()){
-            LOG_DEBUG_STREAM("[ACK] No pending messages for user_id=" << user_id);
+        auto page = std::make_shared<OfflinePage>(std::move(loaded));
+        pool->submit([this, user_id, generation, page]{
+            deliverReplayPage(user_id, generation, *page);
+        });
+    });
+}
+
+void MessageAckManager::deliverReplayPage(int user_id, uint64_t generation, OfflinePage& page){
+    ResponserPtr dispatcher;
+    ConnectionPtr conn;
+    std::string replay;
+    std::vector<MessageId> replayed;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        auto it = replays.find(user_id);
+        if(it == replays.end() || it->second.generation != generation){
             return;
         }
-        
-        LOG_INFO_STREAM("[ACK] Sending " << pending_msgs.size() << " pending messages to user_id=" << user_id);
-        
-        int sent_count = 0;
-        int failed_count = 0;
-        
-        for(const auto& msg_rec : pending_msgs){
-            std::string full_msg = msg_rec.message_id + "|" + msg_rec.message_content + "\n";
-            
-            const char* data = full_msg.data();
-            size_t remaining = full_msg.size();
-            size_t total_sent = 0;
-            
-            bool send_success = true;
-            int attempts = 0;
-            const int MAX_ATTEMPTS = 10;
-            
-            while(remaining > 0 && attempts < MAX_ATTEMPTS){
-                ssize_t sent = send(fd, data + total_sent, remaining, MSG_NOSIGNAL | MSG_DONTWAIT);
-                
-                if(sent < 0){
-                    if(errno == EAGAIN || errno == EWOULDBLOCK){
-                        attempts++;
-                        usleep(1000);  // Wait 1ms
-                        continue;
-                    }
-                    
-                    LOG_ERROR_STREAM("[ACK] Failed to send pending message " << msg_rec.message_id << " to fd=" << fd << ": " << strerror(errno));
-                    send_success = false;
-                    failed_count++;
-                    break;
-                }
-                
-                total_sent += sent;
-                remaining -= sent;
-                attempts = 0;
+        ReplayCursor& cursor = it->second;
+        cursor.fetching = false;
+        conn = cursor.connection;
+        if(conn->isClosed()){
+            LOG_DEBUG_STREAM("[ACK] user_id=" << user_id << " disconnected, dropping replay after " << cursor.replayed << " messages");
+            replays.erase(it);
+            return;
+        }
+
+        cursor.until_id = page.until;
+        cursor.exhausted = page.messages.size() < page.limit;
+        dispatcher = response_dispatcher;
+        // A backlogged connection gets nothing now; the ACK timers resend
+        bool backlogged = isBacklogged(conn);
+
+        for(const auto& msg_rec : page.messages){
+            cursor.after_id = msg_rec.id;
+            // Sent live since login and still tracked on its own; entries
+            // left on a closed connection are taken over
+            auto tracked = pending_messages.find(msg_rec.message_id);
+            if(tracked != pending_messages.end() && tracked->second.connection && !tracked->second.connection->isClosed()){
+                continue;
+            }
+
+            PendingMessage pending;
+            pending.message_id = msg_rec.message_id;
+            pending.connection = conn;
+            pending.send_time = std::chrono::system_clock::now();
+            pending.retry_count = msg_rec.retry_count;
+            pending.sender_id = msg_rec.sender_id;
+            pending.receiver_id = msg_rec.receiver_id;
+            pending.message_content = msg_rec.message_content;
+            pending.replay = generation;
+            trackPending(pending);
+            cursor.in_flight++;
+            replayed.push_back(msg_rec.message_id);
+
+            if(dispatcher && !backlogged){
+                replay += MessageIdFormat::frame(msg_rec.message_id, msg_rec.message_content);
             }
-            
-            if(remaining > 0){
-                LOG_ERROR_STREAM("[ACK] Partial send of pending message " << msg_rec.message_id << ", sent=" << total_sent << "/" << full_msg.size());
-                send_success = false;
-                failed_count++;
+        }
+        cursor.replayed += replayed.size();
+
+        if(cursor.exhausted && cursor.in_flight == 0){
+            if(cursor.replayed > 0){
+                LOG_INFO_STREAM("[ACK] Replay to user_id=" << user_id << " complete, " << cursor.replayed << " messages");
             }
-            
-            if(send_success){
-                sent_count++;
-                LOG_DEBUG_STREAM("[ACK] Sent pending message " << msg_rec.message_id << " to user_id=" << user_id);
-                
-                std::lock_guard<std::mutex> lock(pending_mutex);
-                PendingMessage pending;
-                pending.message_id = msg_rec.message_id;
-                pending.connection = conn;
-                pending.send_time = std::chrono::system_clock::now();
-                pending.retry_count = msg_rec.retry_count;
-                pending.sender_id = msg_rec.sender_id;
-                pending.receiver_id = msg_rec.receiver_id;
-                pending.message_content = msg_rec.message_content;
-                pending_messages[msg_rec.message_id] = pending;
-                
-                updateMessageStatusInDB(msg_rec.message_id, "sent");
+            else{
+                LOG_DEBUG_STREAM("[ACK] No pending messages for user_id=" << user_id);
             }
+            replays.erase(it);
         }
-        
-        LOG_INFO_STREAM("[ACK] Delivered " << sent_count << " pending messages to user_id=" << user_id << ", failed=" << failed_count);
-    };
-    db_thread->submitRequest(req);
-}
\ No newline at end of file
+    }
+
+    if(!replay.empty()){
+        size_t count = replayed.size();
+        // One update for the page; a first delivery is not a retry. Queued
+        // before the page goes out, so no ACK's update can land ahead of it.
+        updateMessageStatusInStore(std::move(replayed), "sent");
+        dispatcher->deliver(conn, std::move(replay));
+        LOG_INFO_STREAM("[ACK] Queued " << count << " pending messages to user_id=" << user_id << " fd=" << conn->getFd());
+    }
+
+    // A page of rows that were all skipped leaves the window open
+    fetchReplayPage(user_id);
+}
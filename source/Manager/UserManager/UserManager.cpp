@@ -1,71 +1,204 @@
 #include "UserManager.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <thread>
 
 UserManager& UserManager::getInstance(){
     static UserManager instance;
     return instance;
 }
 
-void UserManager::loginUser(int fd, std::string& username, int user_id){
-    std::lock_guard<std::mutex> lock(user_mutex);
-    
-    fd_to_username[fd] = username;
-    username_to_fd[username] = fd;
-    fd_to_userid[fd] = user_id;
+UserManager::~UserManager(){
+    for(auto& chunk : slot_chunks){
+        delete[] chunk.load(std::memory_order_relaxed);
+    }
+}
+
+UserManager::FdSlot* UserManager::findSlot(int fd) const{
+    if(fd < 0 || static_cast<size_t>(fd) >= SLOT_CHUNKS * SLOTS_PER_CHUNK){
+        return nullptr;
+    }
+    FdSlot* chunk = slot_chunks[fd / SLOTS_PER_CHUNK].load(std::memory_order_acquire);
+    return chunk ? &chunk[fd % SLOTS_PER_CHUNK] : nullptr;
+}
+
+UserManager::FdSlot* UserManager::slotFor(int fd){
+    FdSlot* slot = findSlot(fd);
+    if(slot || fd < 0 || static_cast<size_t>(fd) >= SLOT_CHUNKS * SLOTS_PER_CHUNK){
+        return slot;
+    }
+
+    std::lock_guard<std::mutex> lock(chunk_mutex);
+    auto& chunk = slot_chunks[fd / SLOTS_PER_CHUNK];
+    if(!chunk.load(std::memory_order_relaxed)){
+        chunk.store(new FdSlot[SLOTS_PER_CHUNK], std::memory_order_release);
+    }
+    return findSlot(fd);
+}
+
+UserManager::UsernameShard& UserManager::shardFor(const std::string& username){
+    return username_shards[std::hash<std::string>{}(username) % USERNAME_SHARDS];
+}
+
+// Writers of one slot exclude each other through its sequence counter;
+// readers never wait for it, they retry if it moved under them
+void UserManager::lockSlot(FdSlot& slot){
+    while(true){
+        uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        if(!(sequence & 1) && slot.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire)){
+            break;
+        }
+        std::this_thread::yield();
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void UserManager::unlockSlot(FdSlot& slot){
+    slot.sequence.fetch_add(1, std::memory_order_release);
+}
+
+std::string UserManager::decodeName(const std::array<uint64_t, USERNAME_WORDS>& words){
+    char bytes[sizeof(words)];
+    std::memcpy(bytes, words.data(), sizeof(bytes));
+    size_t length = std::min<size_t>(static_cast<unsigned char>(bytes[0]), MAX_USERNAME);
+    return std::string(bytes + 1, length);
+}
+
+// Caller holds the slot
+void UserManager::writeName(FdSlot& slot, const std::string& username){
+    char bytes[USERNAME_WORDS * sizeof(uint64_t)] = {};
+    bytes[0] = static_cast<char>(username.size());
+    std::memcpy(bytes + 1, username.data(), username.size());
+    for(size_t i = 0; i < USERNAME_WORDS; i++){
+        uint64_t word;
+        std::memcpy(&word, bytes + i * sizeof(word), sizeof(word));
+        slot.name[i].store(word, std::memory_order_relaxed);
+    }
+}
+
+bool UserManager::loginUser(int fd, std::string& username, int user_id){
+    if(username.size() > MAX_USERNAME){
+        return false;
+    }
+    FdSlot* slot = slotFor(fd);
+    if(!slot){
+        return false;
+    }
+
+    lockSlot(*slot);
+    UsernameShard& shard = shardFor(username);
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.fds.find(username);
+        if(it != shard.fds.end() && it->second != fd){
+            unlockSlot(*slot);
+            return false;
+        }
+        shard.fds[username] = fd;
+    }
+    writeName(*slot, username);
+    slot->user_id.store(user_id, std::memory_order_release);
+    unlockSlot(*slot);
+    return true;
 }
 
 void UserManager::logoutUser(int fd){
-    std::lock_guard<std::mutex> lock(user_mutex);
-    
-    auto it = fd_to_username.find(fd);
-    if(it != fd_to_username.end()){
-        username_to_fd.erase(it->second);
-        fd_to_username.erase(it);
+    FdSlot* slot = findSlot(fd);
+    if(!slot || slot->user_id.load(std::memory_order_acquire) < 0){
+        return;
     }
-    fd_to_userid.erase(fd);
+
+    lockSlot(*slot);
+    if(slot->user_id.load(std::memory_order_relaxed) >= 0){
+        std::array<uint64_t, USERNAME_WORDS> words;
+        for(size_t i = 0; i < USERNAME_WORDS; i++){
+            words[i] = slot->name[i].load(std::memory_order_relaxed);
+        }
+        std::string username = decodeName(words);
+
+        slot->user_id.store(-1, std::memory_order_release);
+        writeName(*slot, std::string());
+
+        // Under the slot, so a new login on a reused fd cannot be erased
+        UsernameShard& shard = shardFor(username);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.fds.find(username);
+        if(it != shard.fds.end() && it->second == fd){
+            shard.fds.erase(it);
+        }
+    }
+    unlockSlot(*slot);
 }
 
 std::optional<std::string> UserManager::getUsername(int fd){
-    std::lock_guard<std::mutex> lock(user_mutex);
-    auto it = fd_to_username.find(fd);
-    if(it != fd_to_username.end()){
-        return it->second;
+    const FdSlot* slot = findSlot(fd);
+    if(!slot){
+        return std::nullopt;
+    }
+
+    std::array<uint64_t, USERNAME_WORDS> words;
+    while(true){
+        uint32_t before = slot->sequence.load(std::memory_order_acquire);
+        if(before & 1){
+            std::this_thread::yield();
+            continue;
+        }
+        int user_id = slot->user_id.load(std::memory_order_relaxed);
+        for(size_t i = 0; i < USERNAME_WORDS; i++){
+            words[i] = slot->name[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(slot->sequence.load(std::memory_order_relaxed) != before){
+            continue;
+        }
+        if(user_id < 0){
+            return std::nullopt;
+        }
+        return decodeName(words);
     }
-    return std::nullopt;
 }
 
 std::optional<int> UserManager::getFd(std::string& username){
-    std::lock_guard<std::mutex> lock(user_mutex);
-    auto it = username_to_fd.find(username);
-    if(it != username_to_fd.end()){
+    UsernameShard& shard = shardFor(username);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.fds.find(username);
+    if(it != shard.fds.end()){
         return it->second;
     }
     return std::nullopt;
 }
 
 std::optional<int> UserManager::getUserId(int fd){
-    std::lock_guard<std::mutex> lock(user_mutex);
-    auto it = fd_to_userid.find(fd);
-    if(it != fd_to_userid.end()){
-        return it->second;
+    const FdSlot* slot = findSlot(fd);
+    if(!slot){
+        return std::nullopt;
+    }
+    int user_id = slot->user_id.load(std::memory_order_acquire);
+    if(user_id >= 0){
+        return user_id;
     }
     return std::nullopt;
 }
 
 bool UserManager::isLoggedIn(int fd){
-    std::lock_guard<std::mutex> lock(user_mutex);
-    return fd_to_username.find(fd) != fd_to_username.end();
+    const FdSlot* slot = findSlot(fd);
+    return slot && slot->user_id.load(std::memory_order_acquire) >= 0;
 }
 
 bool UserManager::isUsernameLoggedIn(std::string& username){
-    std::lock_guard<std::mutex> lock(user_mutex);
-    return username_to_fd.find(username) != username_to_fd.end();
+    UsernameShard& shard = shardFor(username);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    return shard.fds.find(username) != shard.fds.end();
 }
 
 std::vector<std::pair<int, std::string>> UserManager::getAllLoggedInUsers(){
-    std::lock_guard<std::mutex> lock(user_mutex);
     std::vector<std::pair<int, std::string>> users;
-    for(const auto& pair : fd_to_username){
-        users.push_back(pair);
+    for(auto& shard : username_shards){
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        for(const auto& [username, fd] : shard.fds){
+            users.emplace_back(fd, username);
+        }
     }
     return users;
-}
\ No newline at end of file
+}
@@ -28,6 +28,6 @@ void MessageAckThreadHandler::run(){
     
     while(running.load()){
         ackMgr.checkTimeouts();
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        std::this_thread::sleep_for(ackMgr.getTimerResolution());
     }
 }
\ No newline at end of file
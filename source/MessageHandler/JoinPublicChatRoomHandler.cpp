@@ -1,10 +1,9 @@
 #include "JoinPublicChatRoomHandler.h"
 #include "PublicChatRoom.h"
-#include "UserManager.h"
 #include "TimeUtils.h"
 
-std::string JoinPublicChatHandler::handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance){
-    (void)epoll_instance;
+std::string JoinPublicChatHandler::handleMessage(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group){
+    (void)reactor_group;
     (void)command;
 
     if(!conn || conn->isClosed()){
@@ -16,15 +15,19 @@ std::string JoinPublicChatHandler::handleMessage(ConnectionPtr conn, CommandPtr
         return "Error: Invalid file descriptor";
     }
 
-    auto& room = PublicChatRoom::getInstance();
-    if(room.isParticipant(fd)){
+    Session& session = conn->getSession();
+    if(!session.isLoggedIn()){
+        return "Error: Please login first. Use /login <username>";
+    }
+
+    if(!session.joinRoom(Session::PUBLIC_CHAT_ROOM)){
         return "You are already in the public chat room.";
-    };
+    }
 
-    room.join(fd);
+    auto& room = PublicChatRoom::getInstance();
+    room.join(conn);
         
-    auto& userMgr = UserManager::getInstance();
-    std::string username = userMgr.getUsername(fd).value();
+    const std::string& username = session.getUsername();
 
     std::string timestamp = TimeUtils::getCurrentTimestamp();
     
@@ -1,10 +1,9 @@
 #include "LeavePublicChatRoomHandler.h"
 #include "PublicChatRoom.h"
-#include "UserManager.h"
 #include "TimeUtils.h"
 
-std::string LeavePublicChatHandler::handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance){
-    (void)epoll_instance;
+std::string LeavePublicChatHandler::handleMessage(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group){
+    (void)reactor_group;
     (void)command;
 
     if(!conn || conn->isClosed()){
@@ -16,15 +15,15 @@ std::string LeavePublicChatHandler::handleMessage(ConnectionPtr conn, CommandPtr
         return "Error: Invalid file descriptor";
     }
 
-    auto& room = PublicChatRoom::getInstance();
-    if(!room.isParticipant(fd)){
+    Session& session = conn->getSession();
+    if(!session.leaveRoom(Session::PUBLIC_CHAT_ROOM)){
         return "You are not in the public chat room.";
     }
     
+    auto& room = PublicChatRoom::getInstance();
     room.leave(fd);
 
-    auto& userMgr = UserManager::getInstance();
-    std::string username = userMgr.getUsername(fd).value();
+    const std::string& username = session.getUsername();
     std::string timestamp = TimeUtils::getCurrentTimestamp();
     
     return "[" + timestamp + "] " + username + " left public chat room. Current Members: " + std::to_string(room.getParticipantsCount());
@@ -3,24 +3,22 @@
 #include "UserManager.h"
 #include "TimeUtils.h"
 
-std::string ListUsersHandler::handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance){
+std::string ListUsersHandler::handleMessage(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group){
     (void)command;
 
     if(!conn || conn->isClosed()){
         return "Error: Invalid connection";
     }
     
-    if(!epoll_instance){
+    if(!reactor_group){
         return "Error: Server error - no epoll instance";
     }
     
-    auto& userMgr = UserManager::getInstance();
-    int fd = conn->getFd();
-    if(!userMgr.isLoggedIn(fd)){
+    if(!conn->getSession().isLoggedIn()){
         return "Error: Please log in first" ;
     }
 
-    auto all_users = userMgr.getAllLoggedInUsers();
+    auto all_users = UserManager::getInstance().getAllLoggedInUsers();
     std::string timestamp = TimeUtils::getCurrentTimestamp();
     
     std::ostringstream oss;
@@ -6,93 +6,59 @@
 
 LoginChatHandler::LoginChatHandler(DataBaseThreadPtr db_thread) : db_thread(db_thread) {}
 
-std::string LoginChatHandler::handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance){
-    (void)epoll_instance;
+Task<std::string> LoginChatHandler::handleMessageTask(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group){
+    (void)reactor_group;
 
     if(!conn || conn->isClosed()){
-        return "Error: Invalid connection";
+        co_return "Error: Invalid connection";
     }
     
     int fd = conn->getFd();
     auto& userMgr = UserManager::getInstance();
+    Session& session = conn->getSession();
     
-    if(userMgr.isLoggedIn(fd)){
-        return "Error: Already logged in as " + userMgr.getUsername(fd).value();
+    if(session.isLoggedIn()){
+        co_return "Error: Already logged in as " + session.getUsername();
     }
     
     if(command->args.size() < 2){
-        return "Error: Usage: /login <username> <password>";
+        co_return "Error: Usage: /login <username> <password>";
     }
     
     std::string username = command->args[0];
     std::string password = command->args[1];
     
     if(userMgr.isUsernameLoggedIn(username)){
-        return "Error: User already logged in from another connection";
+        co_return "Error: User already logged in from another connection";
     }
 
-    /* Wait for database thread response */
-    std::string result;
-    std::mutex result_mutex;
-    std::condition_variable result_cv;
-    bool done = false;
-    bool login_success = false;
-    int user_id = -1;
-
+    // One round trip: verify, stamp last_login and return the id
     auto req = std::make_shared<DBRequest>();
-    req->type = DBOperationType::VERIFY_LOGIN;
+    req->type = DBOperationType::AUTHENTICATE_USER;
     req->username = username;
     req->password = password;
     req->fd = fd;
-    req->callback = [&](bool isSuccess, const std::string& msg){
-        std::lock_guard<std::mutex> lock(result_mutex);
-        login_success = isSuccess;
-        result = msg;
-        done = true;
-        result_cv.notify_one();
-    };
-    
-    db_thread->submitRequest(req);
-    
-    {
-        std::unique_lock<std::mutex> lock(result_mutex);
-        result_cv.wait_for(lock, std::chrono::seconds(5), [&]{ return done; });
+
+    DBResult authenticated = co_await db_thread->execute(req, DB_TIMEOUT);
+    if(!authenticated.success){
+        co_return authenticated.message;
     }
+    int user_id = std::stoi(authenticated.message);
 
-    if(!done){
-        return "Error: Database timeout";
+    if(conn->isClosed()){
+        co_return "Error: Connection closed";
     }
-    
-    if(login_success){
-        auto get_user_req = std::make_shared<DBRequest>();
-        get_user_req->type = DBOperationType::GET_USER;
-        get_user_req->username = username;
-        
-        bool user_fetched = false;
-        get_user_req->callback = [&result_mutex, &user_id, &user_fetched, &result_cv, username](bool success, const std::string& msg){
-            (void)msg;
-            std::lock_guard<std::mutex> lock1(result_mutex);
-            if(success){
-                user_id = std::stoi(msg);
-            }
-            user_fetched = true;
-            result_cv.notify_one();
-        };
-        
-        db_thread->submitRequest(get_user_req);
-        {
-            std::unique_lock<std::mutex> lock1(result_mutex);
-            result_cv.wait_for(lock1, std::chrono::seconds(2), [&]{ return user_fetched; });
-        }   
-        userMgr.loginUser(fd, username, user_id);
-        
-        std::string timestamp = TimeUtils::getCurrentTimestamp();
-        LOG_INFO_STREAM("User logged in: " << username << " (fd=" << fd << ", user_id=" << user_id << ")");
 
-        auto& ackMgr = MessageAckManager::getInstance();
-        ackMgr.sendPendingMessagesToUser(user_id, fd, conn);
-        return "[" + timestamp + "] Success: Logged in as " + username + " (user_id=" + std::to_string(user_id) + ")";
+    // Logins run in parallel now; the earlier check can race another connection
+    if(!userMgr.loginUser(fd, username, user_id)){
+        co_return "Error: User already logged in from another connection";
     }
+    session.login(user_id, username);
     
-    return result;
-}
\ No newline at end of file
+    std::string timestamp = TimeUtils::getCurrentTimestamp();
+    LOG_INFO_STREAM("User logged in: " << username << " (fd=" << fd << ", user_id=" << user_id << ")");
+
+    auto& ackMgr = MessageAckManager::getInstance();
+    ackMgr.sendPendingMessagesToUser(user_id, fd, conn);
+    co_return "[" + timestamp + "] Success: Logged in as " + username + " (user_id=" + std::to_string(user_id) + ")";
+}
@@ -2,8 +2,8 @@
 #include "UserManager.h"
 #include "TimeUtils.h"
 
-std::string LogoutChatHandler::handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance){
-    (void)epoll_instance;
+std::string LogoutChatHandler::handleMessage(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group){
+    (void)reactor_group;
     (void)command;
 
     if(!conn || conn->isClosed()){
@@ -11,14 +11,15 @@ std::string LogoutChatHandler::handleMessage(ConnectionPtr conn, CommandPtr comm
     }
     
     int fd = conn->getFd();
-    auto& userMgr = UserManager::getInstance();
+    Session& session = conn->getSession();
     
-    if(!userMgr.isLoggedIn(fd)){
+    if(!session.isLoggedIn()){
         return "Error: Not logged in";
     }
     
-    std::string username = userMgr.getUsername(fd).value();
-    userMgr.logoutUser(fd);
+    std::string username = session.getUsername();
+    session.logout();
+    UserManager::getInstance().logoutUser(fd);
     
     std::string timestamp = TimeUtils::getCurrentTimestamp();
     return "[" + timestamp + "] Success: Logged out " + username;
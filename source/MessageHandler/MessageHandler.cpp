@@ -0,0 +1,13 @@
+#include "MessageHandler.h"
+#include <future>
+
+std::string AsyncMessageHandler::handleMessage(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group){
+    auto result = std::make_shared<std::promise<std::string>>();
+    auto future = result->get_future();
+
+    handleMessageTask(conn, command, reactor_group).start(
+        [result](std::string reply){ result->set_value(std::move(reply)); },
+        [result](std::exception_ptr error){ result->set_exception(error); });
+
+    return future.get();
+}
@@ -5,19 +5,17 @@
 #include "TimeUtils.h"
 #include "MessageUtils.h"
 
-std::string PrivateChatHandler::handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance){
+std::string PrivateChatHandler::handleMessage(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group){
     if(!conn || conn->isClosed()){
         return "Error: Invalid connection";
     }
     
-    if(!epoll_instance){
+    if(!reactor_group){
         return "Error: Server error - no epoll instance";
     }
 
-    int fd = conn->getFd();
-    auto& userMgr = UserManager::getInstance();
-    
-    if(!userMgr.isLoggedIn(fd)){
+    Session& session = conn->getSession();
+    if(!session.isLoggedIn()){
         return "Error: Please login first";
     }
 
@@ -26,6 +24,7 @@ std::string PrivateChatHandler::handleMessage(ConnectionPtr conn, CommandPtr com
     }
 
     std::string target_username = command->args[0];
+    auto& userMgr = UserManager::getInstance();
     auto target_fd_opt = userMgr.getFd(target_username);
     
     if(!target_fd_opt.has_value()){
@@ -37,11 +36,11 @@ std::string PrivateChatHandler::handleMessage(ConnectionPtr conn, CommandPtr com
         return "Error: This user is in a public chat room";
     }
 
-    if(!epoll_instance->isEpollMember(target_fd_opt.value())){
+    if(!reactor_group->isEpollMember(target_fd_opt.value())){
         return "Error: This client does not exist";
     }
 
-    std::string my_username = userMgr.getUsername(fd).value();
+    const std::string& my_username = session.getUsername();
     std::string full_message = "";
     for(size_t i = 1; i < command->args.size(); i++){
         if(i > 1) full_message += " ";
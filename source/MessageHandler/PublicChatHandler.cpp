@@ -1,11 +1,10 @@
 #include "PublicChatHandler.h"
 #include "PublicChatRoom.h"
-#include "UserManager.h"
 #include "TimeUtils.h"
 #include "MessageUtils.h"
 
-std::string PublicChatHandler::handleMessage(ConnectionPtr conn, CommandPtr command, EpollInstancePtr epoll_instance){
-    (void)epoll_instance;
+std::string PublicChatHandler::handleMessage(ConnectionPtr conn, CommandPtr command, ReactorGroupPtr reactor_group){
+    (void)reactor_group;
 
     if(!conn || conn->isClosed()){
         return "Error: Invalid connection";
@@ -16,13 +15,12 @@ std::string PublicChatHandler::handleMessage(ConnectionPtr conn, CommandPtr comm
         return "Error: Invalid file descriptor";
     }
 
-    auto& userMgr = UserManager::getInstance();
-    if(!userMgr.isLoggedIn(fd)){
+    Session& session = conn->getSession();
+    if(!session.isLoggedIn()){
         return "Error: Please login first. Use /login <username>";
     }
 
-    auto& room = PublicChatRoom::getInstance(); 
-    if(!room.isParticipant(fd)){
+    if(!session.inRoom(Session::PUBLIC_CHAT_ROOM)){
         return "Error: You must join public chat room first. Use /join_public_chat";
     }
 
@@ -31,10 +29,11 @@ std::string PublicChatHandler::handleMessage(ConnectionPtr conn, CommandPtr comm
         oss << "Users in public chat:\n";
         
         int count = 0;
-        for(auto& participant_fd : room.getParticipants()){
-            auto username = userMgr.getUsername(participant_fd);
-            if(username.has_value()){
-                oss << "  - " << username.value() << "\n";
+        auto participants = PublicChatRoom::getInstance().getParticipants();
+        for(const auto& member : participants->members){
+            const std::string& username = member.connection->getSession().getUsername();
+            if(!username.empty()){
+                oss << "  - " << username << "\n";
                 count++;
             }
         }
@@ -50,7 +49,7 @@ std::string PublicChatHandler::handleMessage(ConnectionPtr conn, CommandPtr comm
         return "Error: No message provided";
     }
     
-    std::string username = userMgr.getUsername(fd).value();
+    const std::string& username = session.getUsername();
     
     std::ostringstream msg_builder;
     msg_builder << command->args[0];
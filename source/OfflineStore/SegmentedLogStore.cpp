@@ -0,0 +1,659 @@
+#include "SegmentedLogStore.h"
+#include "Crc32.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <future>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Segment file: header, then records. Integers are in host byte order.
+//   header   "CHATLOG1" | u64 first position | u64 next message id (0: none yet)
+//   record   u32 payload length | u32 CRC-32C of type and payload | u8 type | payload
+//   MESSAGE  i64 position | u64 message id | i32 sender | i32 receiver | content
+//   STATUS   u8 status | u64 message id ...
+namespace{
+    constexpr char SEGMENT_MAGIC[8] = {'C', 'H', 'A', 'T', 'L', 'O', 'G', '1'};
+    constexpr size_t SEGMENT_HEADER_BYTES = 24;
+    constexpr size_t RECORD_HEADER_BYTES = 9;
+    constexpr size_t MESSAGE_FIXED_BYTES = 24;
+
+    template<typename T>
+    void put(std::string& out, T value){
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template<typename T>
+    T get(const char* in){
+        T value;
+        std::memcpy(&value, in, sizeof(value));
+        return value;
+    }
+
+    bool writeAll(int fd, const char* data, size_t length){
+        while(length > 0){
+            ssize_t n = ::write(fd, data, length);
+            if(n < 0){
+                if(errno == EINTR) continue;
+                return false;
+            }
+            data += n;
+            length -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool readAll(int fd, char* data, size_t length, uint64_t offset){
+        while(length > 0){
+            ssize_t n = ::pread(fd, data, length, static_cast<off_t>(offset));
+            if(n < 0 && errno == EINTR) continue;
+            if(n <= 0) return false;
+            data += n;
+            length -= static_cast<size_t>(n);
+            offset += static_cast<uint64_t>(n);
+        }
+        return true;
+    }
+
+    const char* statusName(uint8_t status){
+        static const char* const NAMES[] = {"pending", "sent", "acknowledged", "failed", "removed"};
+        return status < std::size(NAMES) ? NAMES[status] : "unknown";
+    }
+}
+
+SegmentedLogStore::SegmentedLogStore(const SegmentedLogConfig& config)
+    : config(config),
+      queue(std::make_shared<LockedMessageQueue<OperationPtr>>()) {}
+
+SegmentedLogStore::~SegmentedLogStore(){
+    stop();
+}
+
+std::optional<SegmentedLogStore::Status> SegmentedLogStore::parseStatus(const std::string& status){
+    if(status == "pending") return Status::PENDING;
+    if(status == "sent") return Status::SENT;
+    if(status == "acknowledged") return Status::ACKNOWLEDGED;
+    if(status == "failed") return Status::FAILED;
+    return std::nullopt;
+}
+
+std::filesystem::path SegmentedLogStore::segmentPath(uint64_t number) const{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020llu.log", static_cast<unsigned long long>(number));
+    return config.directory / name;
+}
+
+bool SegmentedLogStore::start(){
+    if(running.load()) return true;
+    auto begin = std::chrono::steady_clock::now();
+    if(!load()){
+        return false;
+    }
+    undelivered.store(entries.size());
+    completed.store(0);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    LOG_INFO_STREAM("[OfflineStore] Log " << config.directory.string() << ": " << segments.size() << " segment(s), "
+                    << disk_bytes.load() / 1024 << " KiB, " << entries.size() << " undelivered for "
+                    << by_receiver.size() << " users, read in " << static_cast<int>(seconds * 1000) << " ms");
+
+    running.store(true);
+    worker_thread = std::thread([this](){ run(); });
+    return true;
+}
+
+void SegmentedLogStore::stop(){
+    running.store(false);
+    if(queue){
+        queue->stop();
+    }
+    if(worker_thread.joinable()){
+        worker_thread.join();
+    }
+    for(auto& [number, segment] : segments){
+        if(segment.fd >= 0){
+            ::close(segment.fd);
+            segment.fd = -1;
+        }
+    }
+}
+
+bool SegmentedLogStore::load(){
+    std::error_code ec;
+    std::filesystem::create_directories(config.directory, ec);
+    if(ec){
+        LOG_ERROR_STREAM("[OfflineStore] Cannot create " << config.directory.string() << ": " << ec.message());
+        return false;
+    }
+
+    std::vector<uint64_t> numbers;
+    for(const auto& file : std::filesystem::directory_iterator(config.directory, ec)){
+        std::string name = file.path().filename().string();
+        if(name.size() != 24 || file.path().extension() != ".log") continue;
+        if(!std::all_of(name.begin(), name.begin() + 20, [](char c){ return c >= '0' && c <= '9'; })) continue;
+        numbers.push_back(std::stoull(name.substr(0, 20)));
+    }
+    if(ec){
+        LOG_ERROR_STREAM("[OfflineStore] Cannot list " << config.directory.string() << ": " << ec.message());
+        return false;
+    }
+    std::sort(numbers.begin(), numbers.end());
+
+    for(size_t i = 0; i < numbers.size(); i++){
+        if(!loadSegment(numbers[i], i + 1 == numbers.size())){
+            return false;
+        }
+    }
+    if(segments.empty()){
+        return openSegment(1);
+    }
+    return true;
+}
+
+bool SegmentedLogStore::loadSegment(uint64_t number, bool newest){
+    std::string path = segmentPath(number).string();
+    int fd = ::open(path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+    struct stat st;
+    if(fd < 0 || ::fstat(fd, &st) != 0){
+        LOG_ERROR_STREAM("[OfflineStore] Cannot open " << path << ": " << std::strerror(errno));
+        if(fd >= 0) ::close(fd);
+        return false;
+    }
+
+    std::string data(static_cast<size_t>(st.st_size), '\0');
+    if(!data.empty() && !readAll(fd, data.data(), data.size(), 0)){
+        LOG_ERROR_STREAM("[OfflineStore] Cannot read " << path << ": " << std::strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    if(data.size() < SEGMENT_HEADER_BYTES || std::memcmp(data.data(), SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0){
+        ::close(fd);
+        // Crashed while creating it; nothing was written to it yet
+        if(newest && data.size() < SEGMENT_HEADER_BYTES){
+            LOG_WARNING_STREAM("[OfflineStore] Recreating incomplete segment " << path);
+            std::filesystem::remove(path);
+            return openSegment(number);
+        }
+        LOG_ERROR_STREAM("[OfflineStore] " << path << " is not a message log segment");
+        return false;
+    }
+
+    int64_t first_position = get<int64_t>(data.data() + 8);
+    MessageId next_message_id = get<uint64_t>(data.data() + 16);
+    next_position = std::max(next_position, first_position);
+    if(next_message_id > 0 && (!last_message_id || *last_message_id < next_message_id - 1)){
+        last_message_id = next_message_id - 1;
+    }
+
+    Segment& segment = segments[number];
+    segment.fd = fd;
+
+    size_t offset = SEGMENT_HEADER_BYTES;
+    while(offset < data.size()){
+        const char* record = data.data() + offset;
+        size_t remaining = data.size() - offset;
+        if(remaining < RECORD_HEADER_BYTES) break;
+        uint32_t length = get<uint32_t>(record);
+        if(length > remaining - RECORD_HEADER_BYTES) break;
+        uint32_t crc = Crc32::crc32c(record + 8, 1 + length);
+        if(crc != get<uint32_t>(record + 4)) break;
+
+        const char* payload = record + RECORD_HEADER_BYTES;
+        auto type = static_cast<RecordType>(record[8]);
+        if(type == RecordType::MESSAGE && length >= MESSAGE_FIXED_BYTES){
+            applyMessage(number, offset + RECORD_HEADER_BYTES, payload, length);
+        }
+        else if(type == RecordType::STATUS && length >= 1){
+            applyStatus(payload, length);
+        }
+        offset += RECORD_HEADER_BYTES + length;
+    }
+
+    if(offset < data.size()){
+        size_t lost = data.size() - offset;
+        if(newest){
+            LOG_WARNING_STREAM("[OfflineStore] Cutting " << lost << " bytes of torn or corrupt records off " << path);
+            if(::ftruncate(fd, static_cast<off_t>(offset)) != 0){
+                LOG_ERROR_STREAM("[OfflineStore] Cannot truncate " << path << ": " << std::strerror(errno));
+                return false;
+            }
+        }
+        else{
+            LOG_ERROR_STREAM("[OfflineStore] Skipping " << lost << " bytes of corrupt records in " << path);
+        }
+    }
+    segment.size = newest ? offset : data.size();
+    disk_bytes.fetch_add(segment.size);
+    segment_count.store(segments.size());
+    return true;
+}
+
+void SegmentedLogStore::applyMessage(uint64_t segment, uint64_t offset, const char* payload, uint32_t length){
+    int64_t position = get<int64_t>(payload);
+    MessageId msg_id = get<uint64_t>(payload + 8);
+    if(!last_message_id || *last_message_id < msg_id){
+        last_message_id = msg_id;
+    }
+    next_position = std::max(next_position, position + 1);
+    if(entries.count(msg_id)) return;
+
+    Entry entry;
+    entry.position = position;
+    entry.segment = segment;
+    entry.offset = offset + MESSAGE_FIXED_BYTES;
+    entry.length = length - MESSAGE_FIXED_BYTES;
+    entry.sender_id = get<int32_t>(payload + 16);
+    entry.receiver_id = get<int32_t>(payload + 20);
+    entry.status = Status::PENDING;
+    entry.retry_count = 0;
+    entries.emplace(msg_id, entry);
+    by_receiver[entry.receiver_id][position] = msg_id;
+    segments[segment].undelivered++;
+}
+
+// Only final statuses are written, so each one takes the message off the index
+void SegmentedLogStore::applyStatus(const char* payload, uint32_t length){
+    for(size_t at = 1; at + sizeof(uint64_t) <= length; at += sizeof(uint64_t)){
+        MessageId msg_id = get<uint64_t>(payload + at);
+        auto it = entries.find(msg_id);
+        if(it != entries.end()){
+            complete(it->second, msg_id);
+        }
+    }
+}
+
+bool SegmentedLogStore::openSegment(uint64_t number){
+    std::string path = segmentPath(number).string();
+    int fd = ::open(path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if(fd < 0){
+        LOG_ERROR_STREAM("[OfflineStore] Cannot create " << path << ": " << std::strerror(errno));
+        return false;
+    }
+
+    std::string header(SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+    put<int64_t>(header, next_position);
+    put<uint64_t>(header, last_message_id ? *last_message_id + 1 : 0);
+    if(!writeAll(fd, header.data(), header.size()) || (config.sync_writes && ::fdatasync(fd) != 0)){
+        LOG_ERROR_STREAM("[OfflineStore] Cannot write " << path << ": " << std::strerror(errno));
+        ::close(fd);
+        ::unlink(path.c_str());
+        return false;
+    }
+
+    Segment& segment = segments[number];
+    segment.fd = fd;
+    segment.size = header.size();
+    disk_bytes.fetch_add(header.size());
+    segment_count.store(segments.size());
+    return true;
+}
+
+void SegmentedLogStore::submit(OperationPtr op){
+    if(!running.load()){
+        std::string message = "Error: Offline store unavailable";
+        if(op->page_done){
+            op->page_done(false, op->page);
+        }
+        else if(op->done){
+            op->done(false, message);
+        }
+        return;
+    }
+    queue->push(std::move(op));
+}
+
+void SegmentedLogStore::append(MessageId msg_id, int sender_id, int receiver_id, const std::string& content, Callback done){
+    auto op = std::make_shared<Operation>();
+    op->kind = Operation::Kind::APPEND;
+    op->message_id = msg_id;
+    op->sender_id = sender_id;
+    op->receiver_id = receiver_id;
+    op->content = content;
+    op->done = std::move(done);
+    submit(op);
+}
+
+void SegmentedLogStore::updateStatus(MessageId msg_id, const std::string& status, Callback done){
+    submitStatus({msg_id}, status, true, std::move(done));
+}
+
+void SegmentedLogStore::updateStatus(std::vector<MessageId> msg_ids, const std::string& status, Callback done){
+    submitStatus(std::move(msg_ids), status, false, std::move(done));
+}
+
+void SegmentedLogStore::submitStatus(std::vector<MessageId> msg_ids, const std::string& status, bool count_retry, Callback done){
+    auto parsed = parseStatus(status);
+    if(!parsed){
+        std::string message = "Error: Unknown message status " + status;
+        if(done) done(false, message);
+        return;
+    }
+    auto op = std::make_shared<Operation>();
+    op->kind = Operation::Kind::STATUS;
+    op->message_ids = std::move(msg_ids);
+    op->status = *parsed;
+    op->count_retry = count_retry && *parsed == Status::SENT;
+    op->done = std::move(done);
+    submit(op);
+}
+
+void SegmentedLogStore::remove(MessageId msg_id, Callback done){
+    auto op = std::make_shared<Operation>();
+    op->kind = Operation::Kind::STATUS;
+    op->message_ids.push_back(msg_id);
+    op->status = Status::REMOVED;
+    op->done = std::move(done);
+    submit(op);
+}
+
+void SegmentedLogStore::fetchPage(OfflinePage page, PageCallback done){
+    auto op = std::make_shared<Operation>();
+    op->kind = Operation::Kind::FETCH;
+    op->page = std::move(page);
+    op->page_done = std::move(done);
+    submit(op);
+}
+
+bool SegmentedLogStore::recover(PendingRecovery& recovery){
+    auto op = std::make_shared<Operation>();
+    auto done = std::make_shared<std::promise<bool>>();
+    auto finished = done->get_future();
+    op->kind = Operation::Kind::RECOVER;
+    op->recovery = &recovery;
+    op->done = [done](bool success, std::string&){
+        done->set_value(success);
+    };
+    submit(op);
+    return finished.get();
+}
+
+void SegmentedLogStore::run(){
+    std::vector<OperationPtr> batch;
+    while(true){
+        batch.clear();
+        if(queue->popBatch(batch, DEFAULT_POP_BATCH, -1) == 0){
+            if(queue->isStopped()) break;
+            continue;
+        }
+
+        for(auto& op : batch){
+            if(op->kind == Operation::Kind::FETCH || op->kind == Operation::Kind::RECOVER){
+                // Reads see every write queued before them
+                bool written = flush();
+                if(op->kind == Operation::Kind::FETCH){
+                    if(written) readPage(op->page);
+                    op->page_done(written, op->page);
+                }
+                else{
+                    op->recovery->last_message_id = last_message_id;
+                    op->recovery->undelivered = entries.size();
+                    op->recovery->receivers = by_receiver.size();
+                    std::string message = "Recovered";
+                    op->done(written, message);
+                }
+                continue;
+            }
+            process(*op);
+        }
+        flush();
+    }
+    flush();
+}
+
+void SegmentedLogStore::process(Operation& op){
+    if(op.kind == Operation::Kind::APPEND){
+        if(entries.count(op.message_id) == 0){
+            std::string payload;
+            payload.reserve(MESSAGE_FIXED_BYTES + op.content.size());
+            put<int64_t>(payload, next_position);
+            put<uint64_t>(payload, op.message_id);
+            put<int32_t>(payload, op.sender_id);
+            put<int32_t>(payload, op.receiver_id);
+            payload += op.content;
+            appendRecord(RecordType::MESSAGE, payload);
+
+            uint64_t number = segments.rbegin()->first;
+            Segment& segment = segments.rbegin()->second;
+            Entry entry;
+            entry.position = next_position++;
+            entry.segment = number;
+            entry.offset = segment.size + write_buffer.size() - op.content.size();
+            entry.length = static_cast<uint32_t>(op.content.size());
+            entry.sender_id = op.sender_id;
+            entry.receiver_id = op.receiver_id;
+            entry.status = Status::PENDING;
+            entry.retry_count = 0;
+            index(op.message_id, entry);
+            undo_log.push_back(Undo{op.message_id, entry, true});
+            if(!last_message_id || *last_message_id < op.message_id){
+                last_message_id = op.message_id;
+            }
+            appended.fetch_add(1, std::memory_order_relaxed);
+            undelivered.fetch_add(1, std::memory_order_relaxed);
+        }
+        completions.emplace_back(std::move(op.done), true);
+        return;
+    }
+
+    // Still owed to the receiver either way; nothing to write
+    if(op.status == Status::PENDING || op.status == Status::SENT){
+        for(MessageId msg_id : op.message_ids){
+            auto it = entries.find(msg_id);
+            if(it == entries.end()) continue;
+            it->second.status = op.status;
+            if(op.count_retry) it->second.retry_count++;
+        }
+        completions.emplace_back(std::move(op.done), false);
+        return;
+    }
+
+    std::string payload;
+    put<uint8_t>(payload, static_cast<uint8_t>(op.status));
+    for(MessageId msg_id : op.message_ids){
+        if(entries.count(msg_id)){
+            put<uint64_t>(payload, msg_id);
+        }
+    }
+    if(payload.size() > 1){
+        appendRecord(RecordType::STATUS, payload);
+        for(size_t at = 1; at < payload.size(); at += sizeof(uint64_t)){
+            MessageId msg_id = get<uint64_t>(payload.data() + at);
+            Entry& entry = entries.at(msg_id);
+            undo_log.push_back(Undo{msg_id, entry, false});
+            complete(entry, msg_id);
+        }
+    }
+    completions.emplace_back(std::move(op.done), true);
+}
+
+void SegmentedLogStore::appendRecord(RecordType type, const std::string& payload){
+    Segment& active = segments.rbegin()->second;
+    if(active.size + write_buffer.size() >= config.segment_bytes){
+        uint64_t number = segments.rbegin()->first + 1;
+        // Stay on the full segment if the new one cannot be created
+        if(flush() && openSegment(number)){
+            LOG_DEBUG_STREAM("[OfflineStore] Sealed segment " << number - 1 << ", writing " << segmentPath(number).string());
+        }
+    }
+
+    uint8_t type_byte = static_cast<uint8_t>(type);
+    uint32_t crc = Crc32::crc32c(&type_byte, 1);
+    crc = Crc32::crc32c(payload.data(), payload.size(), crc);
+    put<uint32_t>(write_buffer, static_cast<uint32_t>(payload.size()));
+    put<uint32_t>(write_buffer, crc);
+    put<uint8_t>(write_buffer, type_byte);
+    write_buffer += payload;
+}
+
+void SegmentedLogStore::index(MessageId msg_id, const Entry& entry){
+    entries.emplace(msg_id, entry);
+    by_receiver[entry.receiver_id][entry.position] = msg_id;
+    auto segment = segments.find(entry.segment);
+    if(segment != segments.end()){
+        segment->second.undelivered++;
+    }
+}
+
+// Erases entry itself last
+void SegmentedLogStore::unindex(const Entry& entry, MessageId msg_id){
+    auto segment = segments.find(entry.segment);
+    if(segment != segments.end()){
+        segment->second.undelivered--;
+    }
+    auto receiver = by_receiver.find(entry.receiver_id);
+    if(receiver != by_receiver.end()){
+        receiver->second.erase(entry.position);
+        if(receiver->second.empty()){
+            by_receiver.erase(receiver);
+        }
+    }
+    entries.erase(msg_id);
+}
+
+void SegmentedLogStore::complete(Entry& entry, MessageId msg_id){
+    unindex(entry, msg_id);
+    completed.fetch_add(1, std::memory_order_relaxed);
+    undelivered.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// Writes the batch, then answers its callbacks; writes that only touched
+// memory were answered as soon as they were applied
+bool SegmentedLogStore::flush(){
+    bool success = true;
+    if(!write_buffer.empty()){
+        if(!tail_clean){
+            tail_clean = discardTail();
+        }
+        Segment& active = segments.rbegin()->second;
+        success = tail_clean && writeAll(active.fd, write_buffer.data(), write_buffer.size());
+        if(success && config.sync_writes){
+            success = ::fdatasync(active.fd) == 0;
+        }
+        if(success){
+            active.size += write_buffer.size();
+            disk_bytes.fetch_add(write_buffer.size());
+        }
+        else{
+            LOG_ERROR_STREAM("[OfflineStore] Write to " << segmentPath(segments.rbegin()->first).string()
+                             << " failed: " << std::strerror(errno));
+            // The records may be partly on disk; later ones must not land
+            // behind them, and their index changes must not outlive them
+            tail_clean = discardTail();
+            rollback();
+        }
+        write_buffer.clear();
+    }
+    undo_log.clear();
+
+    std::string ok = "Stored";
+    std::string failed = "Error: Offline log write failed";
+    for(auto& [done, durable] : completions){
+        if(!done) continue;
+        bool result = !durable || success;
+        done(result, result ? ok : failed);
+    }
+    completions.clear();
+
+    if(success){
+        reclaim();
+    }
+    return success;
+}
+
+// Cuts the active segment back to its last good record; if that fails,
+// seals it and moves on to a new one, so entry offsets stay right
+bool SegmentedLogStore::discardTail(){
+    Segment& active = segments.rbegin()->second;
+    if(::ftruncate(active.fd, static_cast<off_t>(active.size)) == 0){
+        return true;
+    }
+    uint64_t number = segments.rbegin()->first + 1;
+    LOG_ERROR_STREAM("[OfflineStore] Cannot truncate " << segmentPath(number - 1).string() << ": " << std::strerror(errno)
+                     << ", moving to a new segment");
+    return openSegment(number);
+}
+
+// Newest first, so a message appended and completed in the same batch is
+// brought back before it is forgotten. last_message_id is kept: ids only
+// ever move forward.
+void SegmentedLogStore::rollback(){
+    for(auto it = undo_log.rbegin(); it != undo_log.rend(); ++it){
+        if(it->appended){
+            auto entry = entries.find(it->message_id);
+            if(entry != entries.end()){
+                unindex(entry->second, it->message_id);
+            }
+            appended.fetch_sub(1, std::memory_order_relaxed);
+            undelivered.fetch_sub(1, std::memory_order_relaxed);
+        }
+        else{
+            index(it->message_id, it->entry);
+            completed.fetch_sub(1, std::memory_order_relaxed);
+            undelivered.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    undo_log.clear();
+}
+
+void SegmentedLogStore::reclaim(){
+    while(segments.size() > 1 && segments.begin()->second.undelivered == 0){
+        auto oldest = segments.begin();
+        std::filesystem::path path = segmentPath(oldest->first);
+        ::close(oldest->second.fd);
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        if(ec){
+            LOG_WARNING_STREAM("[OfflineStore] Cannot delete " << path.string() << ": " << ec.message());
+        }
+        disk_bytes.fetch_sub(oldest->second.size);
+        segments.erase(oldest);
+        segment_count.store(segments.size());
+        reclaimed_segments.fetch_add(1, std::memory_order_relaxed);
+        LOG_DEBUG_STREAM("[OfflineStore] Reclaimed " << path.string());
+    }
+}
+
+void SegmentedLogStore::readPage(OfflinePage& page){
+    auto receiver = by_receiver.find(page.receiver_id);
+    if(receiver == by_receiver.end()){
+        return;
+    }
+    const auto& backlog = receiver->second;
+    if(page.until == 0){
+        page.until = backlog.rbegin()->first;
+    }
+
+    for(auto it = backlog.upper_bound(page.after); it != backlog.end() && it->first <= page.until; ++it){
+        if(page.messages.size() >= page.limit) break;
+        const Entry& entry = entries.at(it->second);
+
+        PendingMessageRecord record;
+        record.id = entry.position;
+        record.message_id = it->second;
+        record.sender_id = entry.sender_id;
+        record.receiver_id = entry.receiver_id;
+        record.status = statusName(static_cast<uint8_t>(entry.status));
+        record.retry_count = entry.retry_count;
+        record.message_content.resize(entry.length);
+        if(!readAll(segments.at(entry.segment).fd, record.message_content.data(), entry.length, entry.offset)){
+            LOG_ERROR_STREAM("[OfflineStore] Cannot read message " << it->second << " from segment " << entry.segment);
+            continue;
+        }
+        page.messages.push_back(std::move(record));
+    }
+}
+
+SegmentedLogStore::Stats SegmentedLogStore::getStats() const{
+    Stats stats;
+    stats.appended = appended.load(std::memory_order_relaxed);
+    stats.completed = completed.load(std::memory_order_relaxed);
+    stats.segments = segment_count.load(std::memory_order_relaxed);
+    stats.reclaimed_segments = reclaimed_segments.load(std::memory_order_relaxed);
+    stats.disk_bytes = disk_bytes.load(std::memory_order_relaxed);
+    stats.undelivered = undelivered.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,86 @@
+#include "SqliteOfflineStore.h"
+#include "Logger.h"
+#include <future>
+
+SqliteOfflineStore::SqliteOfflineStore(DataBaseThreadPtr db_thread) : db_thread(db_thread) {}
+
+void SqliteOfflineStore::submit(DBRequestPtr req, Callback done){
+    req->callback = std::move(done);
+    db_thread->submitRequest(req);
+}
+
+void SqliteOfflineStore::append(MessageId msg_id, int sender_id, int receiver_id, const std::string& content, Callback done){
+    auto req = std::make_shared<DBRequest>();
+    req->type = DBOperationType::ADD_PENDING_MESSAGE;
+    req->message_id = msg_id;
+    req->sender_id = sender_id;
+    req->receiver_id = receiver_id;
+    req->message_content = content;
+    submit(req, std::move(done));
+}
+
+void SqliteOfflineStore::updateStatus(MessageId msg_id, const std::string& status, Callback done){
+    auto req = std::make_shared<DBRequest>();
+    req->type = DBOperationType::UPDATE_MESSAGE_STATUS;
+    req->message_id = msg_id;
+    req->status = status;
+    submit(req, std::move(done));
+}
+
+void SqliteOfflineStore::updateStatus(std::vector<MessageId> msg_ids, const std::string& status, Callback done){
+    auto req = std::make_shared<DBRequest>();
+    req->type = DBOperationType::UPDATE_MESSAGE_STATUS;
+    req->message_ids = std::move(msg_ids);
+    req->status = status;
+    submit(req, std::move(done));
+}
+
+void SqliteOfflineStore::remove(MessageId msg_id, Callback done){
+    auto req = std::make_shared<DBRequest>();
+    req->type = DBOperationType::DELETE_PENDING_MESSAGE;
+    req->message_id = msg_id;
+    submit(req, std::move(done));
+}
+
+void SqliteOfflineStore::fetchPage(OfflinePage page, PageCallback done){
+    auto req = std::make_shared<DBRequest>();
+    req->type = DBOperationType::GET_PENDING_MESSAGES_FOR_USER;
+    req->user_id = page.receiver_id;
+    req->replay_after = page.after;
+    req->replay_until = page.until;
+    req->replay_limit = page.limit;
+
+    // The DB thread holds req while the callback runs
+    std::weak_ptr<DBRequest> weak_req = req;
+    req->callback = [page = std::move(page), done = std::move(done), weak_req](bool success, std::string& result) mutable{
+        auto loaded = weak_req.lock();
+        if(!success || !loaded){
+            LOG_ERROR_STREAM("[OfflineStore] Failed to load page for user_id=" << page.receiver_id << ": " << result);
+            done(false, page);
+            return;
+        }
+        page.until = loaded->replay_until;
+        page.messages = std::move(loaded->pending_messages);
+        done(true, page);
+    };
+    db_thread->submitRequest(req);
+}
+
+bool SqliteOfflineStore::recover(PendingRecovery& recovery){
+    auto req = std::make_shared<DBRequest>();
+    req->type = DBOperationType::RECOVER_PENDING_MESSAGES;
+    auto done = std::make_shared<std::promise<bool>>();
+    auto finished = done->get_future();
+    req->callback = [done](bool success, std::string& result){
+        if(!success){
+            LOG_ERROR_STREAM("[OfflineStore] " << result);
+        }
+        done->set_value(success);
+    };
+    db_thread->submitRequest(req);
+    if(!finished.get()){
+        return false;
+    }
+    recovery = req->recovery;
+    return true;
+}
@@ -5,28 +5,88 @@ PublicChatRoom& PublicChatRoom::getInstance(){
     return instance;
 }
 
-void PublicChatRoom::join(int fd){
+void PublicChatRoom::join(ConnectionPtr conn){
+    if(!conn){
+        return;
+    }
+    int fd = conn->getFd();
+
     std::lock_guard<std::mutex> lock(room_mutex);
-    participants.insert(fd);
+    if(conn->isClosed()){
+        return;
+    }
+    RoomSnapshotPtr current = snapshot.load(std::memory_order_acquire);
+    auto next = std::make_shared<RoomSnapshot>();
+    next->version = current->version + 1;
+    next->members.reserve(current->members.size() + 1);
+    next->members = current->members;
+
+    auto it = positions.find(fd);
+    if(it != positions.end()){
+        // A new connection on a reused fd replaces the old one
+        next->members[it->second].connection = std::move(conn);
+    }
+    else{
+        positions[fd] = next->members.size();
+        next->members.push_back(RoomMember{fd, std::move(conn)});
+    }
+    snapshot.store(std::move(next), std::memory_order_release);
 }
 
 void PublicChatRoom::leave(int fd){
     std::lock_guard<std::mutex> lock(room_mutex);
-    participants.erase(fd);
+    auto it = positions.find(fd);
+    if(it == positions.end()){
+        return;
+    }
+    removeAt(it);
 }
 
-std::unordered_set<int> PublicChatRoom::getParticipants(){
+bool PublicChatRoom::leave(int fd, const Connection* connection){
     std::lock_guard<std::mutex> lock(room_mutex);
-    return participants;
+    auto it = positions.find(fd);
+    if(it == positions.end()){
+        return false;
+    }
+    // The fd may have been reused and joined again since the caller looked
+    if(snapshot.load(std::memory_order_acquire)->members[it->second].connection.get() != connection){
+        return false;
+    }
+    removeAt(it);
+    return true;
 }
 
-bool PublicChatRoom::isParticipant(int fd){
-    std::lock_guard<std::mutex> lock(room_mutex);
-    return participants.find(fd) != participants.end();
+void PublicChatRoom::removeAt(std::unordered_map<int, size_t>::iterator it){
+    size_t index = it->second;
+    positions.erase(it);
+
+    RoomSnapshotPtr current = snapshot.load(std::memory_order_acquire);
+    auto next = std::make_shared<RoomSnapshot>();
+    next->version = current->version + 1;
+    next->members = current->members;
+
+    // Order within the room does not matter; fill the hole with the last member
+    if(index != next->members.size() - 1){
+        next->members[index] = std::move(next->members.back());
+        positions[next->members[index].fd] = index;
+    }
+    next->members.pop_back();
+    snapshot.store(std::move(next), std::memory_order_release);
+}
+
+RoomSnapshotPtr PublicChatRoom::getParticipants() const{
+    return snapshot.load(std::memory_order_acquire);
 }
 
-size_t PublicChatRoom::getParticipantsCount(){
+bool PublicChatRoom::isParticipant(int fd){
     std::lock_guard<std::mutex> lock(room_mutex);
-    return participants.size();
+    auto it = positions.find(fd);
+    if(it == positions.end()){
+        return false;
+    }
+    return !snapshot.load(std::memory_order_acquire)->members[it->second].connection->isClosed();
 }
 
+size_t PublicChatRoom::getParticipantsCount() const{
+    return snapshot.load(std::memory_order_acquire)->members.size();
+}
@@ -11,8 +11,8 @@ static void setNonBlock(int fd){
     }
 }
 
-TCPServer::TCPServer(const sockaddr_in& addr, EpollInstancePtr epoll, std::shared_ptr<MessageQueue<Message>> to_router)
-    : epoll_instance(epoll), 
+TCPServer::TCPServer(const sockaddr_in& addr, EventLoopPtr loop, std::shared_ptr<MessageQueue<Message>> to_router, bool reuse_port)
+    : event_loop(loop), 
       to_router_queue(to_router){ 
     
     listen_fd = socket(AF_INET, SOCK_STREAM, 0);
@@ -28,6 +28,14 @@ TCPServer::TCPServer(const sockaddr_in& addr, EpollInstancePtr epoll, std::share
         throw std::runtime_error("Failed to set socket options");
     }
 
+    // Every reactor shard binds its own listener on the same port; the kernel
+    // spreads incoming connections across them.
+    if(reuse_port && setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0){
+        perror("setsockopt SO_REUSEPORT");
+        close(listen_fd);
+        throw std::runtime_error("Failed to set SO_REUSEPORT");
+    }
+
     sockaddr_in server_addr{};
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = addr.sin_addr.s_addr;
@@ -47,7 +55,7 @@ TCPServer::TCPServer(const sockaddr_in& addr, EpollInstancePtr epoll, std::share
     
     setNonBlock(listen_fd);
     
-    LOG_DEBUG_STREAM("[INFO] Server listening on port " << ntohs(addr.sin_port));}
+    LOG_DEBUG_STREAM("[INFO] Shard " << event_loop->getShardId() << " (" << event_loop->getBackendName() << ") listening on port " << ntohs(addr.sin_port));}
 
 TCPServer::~TCPServer(){
     if(listen_fd >= 0){
@@ -56,78 +64,45 @@ TCPServer::~TCPServer(){
 }
 
 void TCPServer::onRead(int clientFd){
-    ConnectionPtr conn = epoll_instance->getConnection(clientFd);
+    ConnectionPtr conn = event_loop->getConnection(clientFd);
     if(!conn || conn->isClosed()){
         LOG_DEBUG_STREAM("Connection not found or closed for fd=" << clientFd);
         return;
     }
-    
-    conn->updateActivity();
 
-    while(true){
-        char buf[BUFFER_SIZE];
-        ssize_t n = recv(clientFd, buf, BUFFER_SIZE - 1, 0);
-        
-        if(n < 0){
-            if(errno == EAGAIN || errno == EWOULDBLOCK){
-                break;
-            }
-            
-            LOG_WARNING_STREAM("Recv error on fd=" << clientFd << ": " << strerror(errno));
-            epoll_instance->removeFd(clientFd);
-            return;
-        }
-        
-        if(n == 0){
-            epoll_instance->removeFd(clientFd);
-            LOG_INFO_STREAM("Client disconnected fd=" << clientFd);
-            return;
-        }
-        
-        buf[n] = '\0';
-        std::string received_data(buf, n);
-        
-        conn->appendReadBuffer(received_data);
-        
-        if(conn->getReadBufferSize() > MAX_MESSAGE_SIZE){
-            LOG_WARNING_STREAM("Read buffer too large for fd=" << clientFd << " (" << conn->getReadBufferSize() << " bytes), closing connection");
-            epoll_instance->removeFd(clientFd);
-            return;
-        }
-
-        LOG_DEBUG_STREAM("[TCPServer] Received " << n << " bytes from fd=" << clientFd << ", buffer size now: " << received_data.size());
+    if(conn->getReadBufferSize() > MAX_MESSAGE_SIZE){
+        LOG_WARNING_STREAM("Read buffer too large for fd=" << clientFd << " (" << conn->getReadBufferSize() << " bytes), closing connection");
+        event_loop->removeFd(clientFd);
+        return;
     }
     
-    while(true){
-        std::string complete_msg = conn->extractCompleteMessage();
-        
+    std::string_view complete_msg;
+    std::vector<MessageIdRange> ack_ranges;
+    while(conn->nextMessage(complete_msg)){
         if(complete_msg.empty()){
-            break;
+            continue;
         }
         
         LOG_DEBUG_STREAM("[TCPServer] Extracted complete message from fd=" << clientFd << ": '" << complete_msg << "'");
         
         if(complete_msg.length() >= 4 && complete_msg.compare(0, 4, "ACK|") == 0){
             if(complete_msg.length() > 4){
-                std::string msg_id = complete_msg.substr(4);
-                
-                bool valid = false;
-                if(msg_id.length() == 14 && msg_id.compare(0, 4, "MSG_") == 0){
-                    valid = true;
-                    for(size_t i = 4; i < 14; ++i){
-                        if(!std::isdigit(msg_id[i])){
-                            valid = false;
-                            break;
-                        }
-                    }
-                }
+                std::string_view msg_id = complete_msg.substr(4);
+                auto id = MessageIdFormat::parse(msg_id);
                 
-                if(valid){
-                    MessageAckManager::getInstance().acknowledgeMessage(msg_id);
+                if(id.has_value()){
+                    MessageAckManager::getInstance().acknowledgeMessage(id.value());
                     LOG_DEBUG_STREAM("[ACK] Received ACK for " << msg_id);
                 }
                 else{
-                    LOG_WARNING_STREAM("[ACK] Malformed ACK message ID from fd=" << clientFd << ": '" << msg_id << "'");
+                    // Batched form: ids and ranges, see MessageIdFormat::parseList
+                    ack_ranges.clear();
+                    if(MessageIdFormat::parseList(msg_id, ack_ranges)){
+                        MessageAckManager::getInstance().acknowledgeMessages(ack_ranges, conn);
+                    }
+                    else{
+                        LOG_WARNING_STREAM("[ACK] Malformed ACK message ID from fd=" << clientFd << ": '" << msg_id << "'");
+                    }
                 }
             }
             else{
@@ -151,10 +126,10 @@ void TCPServer::onRead(int clientFd){
         
         if(conn->isRateLimited()){
             LOG_WARNING_STREAM("[RATE_LIMIT] Client fd=" << clientFd << " is sending too fast, dropping message");
-            auto& ackMgr = MessageAckManager::getInstance();
-            std::string msg_id = ackMgr.generateMessageId();
-            std::string warning = msg_id + "|Warning: Rate limit exceeded. Slow down your messages.\n";
-            send(clientFd, warning.c_str(), warning.size(), MSG_NOSIGNAL);
+            // Advisory and not retried, so sent without a message id, like broadcasts
+            if(responser){
+                responser->deliver(conn, "Warning: Rate limit exceeded. Slow down your messages.\n");
+            }
             continue;
         }
         
@@ -162,59 +137,50 @@ void TCPServer::onRead(int clientFd){
         
         Message msg;
         msg.type = MessageType::INCOMING_MESSAGE;
-        msg.payload = IncomingMessage{conn, complete_msg, clientFd};
+        msg.payload = IncomingMessage{conn, std::string(complete_msg), clientFd};
         to_router_queue->push(std::move(msg));
+        stats.messages_routed.fetch_add(1, std::memory_order_relaxed);
         
         LOG_DEBUG_STREAM("[TCPServer] Pushed complete message from fd=" << clientFd << " to router queue");
     }
 }
 
-void TCPServer::onAccept(int fd){
-    while(true){
-        sockaddr_in client_addr{};
-        socklen_t client_len = sizeof(client_addr);
-        
-        int cfd = accept(fd, (sockaddr*)&client_addr, &client_len);
-        
-        if(cfd < 0){
-            if(errno == EAGAIN || errno == EWOULDBLOCK){
-                break;
-            }
-            LOG_ERROR_STREAM("Accept error: " << strerror(errno));
-            break;
-        }
+void TCPServer::onAccept(int clientFd){
+    sockaddr_in client_addr{};
+    socklen_t client_len = sizeof(client_addr);
+    getpeername(clientFd, (sockaddr*)&client_addr, &client_len);
 
-        char client_ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, sizeof(client_ip));
-        LOG_INFO_STREAM("New connection from " << client_ip << ":" << ntohs(client_addr.sin_port) << " fd=" << cfd);
+    char client_ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, sizeof(client_ip));
+    LOG_INFO_STREAM("New connection from " << client_ip << ":" << ntohs(client_addr.sin_port) << " fd=" << clientFd);
 
-        setNonBlock(cfd);
+    setNonBlock(clientFd);
+    stats.accepted.fetch_add(1, std::memory_order_relaxed);
 
-        auto conn = std::make_shared<Connection>(cfd);
-        
-        std::weak_ptr<TCPServer> weak_this = shared_from_this();
-        
-        epoll_instance->addFd(cfd, [weak_this](int clientFd){
-            if(auto self = weak_this.lock()){
-                self->onRead(clientFd);
-            }
-        }, conn);
-    }
+    auto conn = std::make_shared<Connection>(clientFd);
+    
+    std::weak_ptr<TCPServer> weak_this = shared_from_this();
+    
+    event_loop->addFd(clientFd, [weak_this](int fd){
+        if(auto self = weak_this.lock()){
+            self->onRead(fd);
+        }
+    }, conn);
 }
 
 void TCPServer::startServer(){
     std::weak_ptr<TCPServer> weak_this = shared_from_this();
     
-    epoll_instance->addFd(listen_fd, [weak_this](int fd){
+    event_loop->addListener(listen_fd, [weak_this](int clientFd){
         if(auto self = weak_this.lock()){
-            self->onAccept(fd);
+            self->onAccept(clientFd);
         }
     });
 }
 
 void TCPServer::stopServer(){
     if(listen_fd >= 0){
-        epoll_instance->removeFd(listen_fd);
+        event_loop->removeFd(listen_fd);
         close(listen_fd);
         listen_fd = -1;
     }
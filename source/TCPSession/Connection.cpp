@@ -63,7 +63,13 @@ void Connection::close(){
 void Connection::queueWrite(std::string data){
     if(data.empty()) return;
     std::lock_guard<std::mutex> lock(write_mutex);
-    write_queue.push_back(std::move(data));
+    write_queue.emplace_back(std::move(data));
+}
+
+void Connection::queueWrite(std::shared_ptr<const std::string> data){
+    if(!data || data->empty()) return;
+    std::lock_guard<std::mutex> lock(write_mutex);
+    write_queue.emplace_back(std::move(data));
 }
 
 bool Connection::hasWriteData(){
@@ -71,22 +77,105 @@ bool Connection::hasWriteData(){
     return !write_queue.empty();
 }
 
-std::string Connection::popWriteData(){
+WriteSegment Connection::popWriteData(){
     std::lock_guard<std::mutex> lock(write_mutex);
     
-    if(!partial_write.empty()){
-        return std::move(partial_write);
-    }
-    
     if(write_queue.empty()){
-        return "";
+        return WriteSegment();
     }
     
-    std::string data = std::move(write_queue.front());
+    WriteSegment data = std::move(write_queue.front());
     write_queue.pop_front();
+
+    if(write_offset > 0){
+        data.dropPrefix(write_offset);
+        write_offset = 0;
+    }
     return data;
 }
 
+void Connection::requeueUnsent(std::vector<WriteSegment>& segments, size_t sent){
+    size_t first = 0;
+    while(first < segments.size() && sent >= segments[first].size()){
+        sent -= segments[first].size();
+        first++;
+    }
+    if(first == segments.size()){
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(write_mutex);
+    // Popped segments left write_offset at 0, and nothing else flushes
+    // while their send is in flight
+    write_queue.insert(write_queue.begin(), std::make_move_iterator(segments.begin() + first),
+                       std::make_move_iterator(segments.end()));
+    write_offset = sent;
+}
+
+Connection::WriteResult Connection::flushWriteQueue(){
+    std::lock_guard<std::mutex> lock(write_mutex);
+    WriteResult result;
+
+    int sock = fd.load(std::memory_order_acquire);
+    if(sock < 0){
+        result.status = WriteResult::FAILED;
+        result.error = EBADF;
+        return result;
+    }
+
+    iovec iov[IOV_MAX];
+    while(!write_queue.empty()){
+        size_t count = 0;
+        size_t requested = 0;
+        for(auto it = write_queue.begin(); it != write_queue.end() && count < IOV_MAX; ++it, ++count){
+            size_t skip = (count == 0) ? write_offset : 0;
+            iov[count].iov_base = const_cast<char*>(it->data()) + skip;
+            iov[count].iov_len = it->size() - skip;
+            requested += iov[count].iov_len;
+        }
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+
+        ssize_t n = ::sendmsg(sock, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if(n < 0){
+            if(errno == EINTR) continue;
+            result.status = (errno == EAGAIN || errno == EWOULDBLOCK) ? WriteResult::WOULD_BLOCK : WriteResult::FAILED;
+            result.error = errno;
+            return result;
+        }
+        if(n == 0){
+            result.status = WriteResult::FAILED;
+            return result;
+        }
+
+        result.syscalls++;
+        result.segments += count;
+        result.bytes += n;
+
+        size_t left = static_cast<size_t>(n);
+        while(left > 0){
+            size_t available = write_queue.front().size() - write_offset;
+            if(left < available){
+                write_offset += left;
+                break;
+            }
+            left -= available;
+            write_queue.pop_front();
+            write_offset = 0;
+        }
+
+        // A short write means the socket buffer is full
+        if(static_cast<size_t>(n) < requested){
+            result.status = WriteResult::WOULD_BLOCK;
+            return result;
+        }
+    }
+
+    return result;
+}
+
 size_t Connection::getWriteQueueSize(){
     std::lock_guard<std::mutex> lock(write_mutex);
     return write_queue.size();
@@ -95,29 +184,29 @@ size_t Connection::getWriteQueueSize(){
 void Connection::clearWriteQueue(){
     std::lock_guard<std::mutex> lock(write_mutex);
     write_queue.clear();
-    partial_write.clear();
+    write_offset = 0;
     writing.store(false, std::memory_order_release);
 }
 
 // Read methods
-void Connection::appendReadBuffer(const std::string& data){
+char* Connection::prepareRead(size_t min_space, size_t& available){
     std::lock_guard<std::mutex> lock(read_mutex);
-    read_buffer.append(data);
+    return read_buffer.prepare(min_space, available);
 }
 
-std::string Connection::extractCompleteMessage(){
+void Connection::commitRead(size_t n){
     std::lock_guard<std::mutex> lock(read_mutex);
-    
-    size_t pos = read_buffer.find('\n');
-    if(pos == std::string::npos){
-        return "";
-    }
-    
-    std::string message = read_buffer.substr(0, pos);
-    
-    read_buffer.erase(0, pos + 1);
-    
-    return message;
+    read_buffer.commit(n);
+}
+
+void Connection::appendReadBuffer(const char* data, size_t len){
+    std::lock_guard<std::mutex> lock(read_mutex);
+    read_buffer.append(data, len);
+}
+
+bool Connection::nextMessage(std::string_view& message){
+    std::lock_guard<std::mutex> lock(read_mutex);
+    return read_buffer.nextLine(message);
 }
 
 void Connection::clearReadBuffer(){
@@ -3,7 +3,7 @@
 #include "UserManager.h"
 #include "PublicChatRoom.h"
 
-EpollInstance::EpollInstance(){
+EpollInstance::EpollInstance(int shard_id) : EventLoop(shard_id){
     epfd = epoll_create1(0);
     if(epfd < 0){
         perror("epoll_create1");
@@ -32,6 +32,7 @@ EpollInstance::~EpollInstance(){
         }
     }
     connections.clear();
+    accept_handlers.clear();
     read_handlers.clear();
     write_handlers.clear();
     
@@ -60,11 +61,65 @@ void EpollInstance::addFd(int fd, Callback read_cb, ConnectionPtr conn){
     read_handlers[fd] = read_cb;
 
     if(conn){
+        conn->setShard(shard_id);
         connections[fd] = conn;
         epoll_fds.insert(fd);
     }
 }
 
+void EpollInstance::addListener(int listen_fd, Callback on_client){
+    addFd(listen_fd, nullptr);
+
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    accept_handlers[listen_fd] = on_client;
+}
+
+void EpollInstance::acceptClients(int listen_fd, const Callback& on_client){
+    while(true){
+        int cfd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+        
+        if(cfd < 0){
+            if(errno == EAGAIN || errno == EWOULDBLOCK){
+                break;
+            }
+            LOG_ERROR_STREAM("Accept error: " << strerror(errno));
+            break;
+        }
+
+        on_client(cfd);
+    }
+}
+
+bool EpollInstance::readFromSocket(int fd, ConnectionPtr conn){
+    while(true){
+        size_t available = 0;
+        char* dst = conn->prepareRead(BUFFER_SIZE, available);
+        ssize_t n = recv(fd, dst, available, 0);
+        
+        if(n < 0){
+            if(errno == EAGAIN || errno == EWOULDBLOCK){
+                return true;
+            }
+            
+            LOG_WARNING_STREAM("Recv error on fd=" << fd << ": " << strerror(errno));
+            return false;
+        }
+        
+        if(n == 0){
+            LOG_INFO_STREAM("Client disconnected fd=" << fd);
+            return false;
+        }
+        
+        conn->commitRead(n);
+        bytes_read.fetch_add(n, std::memory_order_relaxed);
+
+        // Leave the oversized buffer for the read callback to reject
+        if(conn->getReadBufferSize() > MAX_MESSAGE_SIZE){
+            return true;
+        }
+    }
+}
+
 void EpollInstance::enableWrite(int fd, Callback write_cb){
     std::lock_guard<std::mutex> lock(handlers_mutex);
     
@@ -128,6 +183,7 @@ void EpollInstance::removeFd(int fd){
     ConnectionPtr conn;
     {
         std::lock_guard<std::mutex> lock(handlers_mutex);
+        accept_handlers.erase(fd);
         read_handlers.erase(fd);
         write_handlers.erase(fd);      
         epoll_fds.erase(fd);
@@ -139,6 +195,9 @@ void EpollInstance::removeFd(int fd){
         }
     }
 
+    if(conn){
+        conn->getSession().clear();
+    }
     UserManager::getInstance().logoutUser(fd);
     PublicChatRoom::getInstance().leave(fd);
 
@@ -183,12 +242,38 @@ void EpollInstance::run(){
             }
             
             if(ev & EPOLLIN){
+                Callback accept_handler;
                 Callback read_handler;
+                ConnectionPtr conn;
                 {
                     std::lock_guard<std::mutex> lock(handlers_mutex);
-                    auto it = read_handlers.find(fd);
-                    if(it == read_handlers.end()) continue;
-                    read_handler = it->second;
+                    auto acc_it = accept_handlers.find(fd);
+                    if(acc_it != accept_handlers.end()){
+                        accept_handler = acc_it->second;
+                    }
+                    else{
+                        auto it = read_handlers.find(fd);
+                        if(it == read_handlers.end()) continue;
+                        read_handler = it->second;
+
+                        auto conn_it = connections.find(fd);
+                        if(conn_it != connections.end()){
+                            conn = conn_it->second;
+                        }
+                    }
+                }
+
+                if(accept_handler){
+                    acceptClients(fd, accept_handler);
+                    continue;
+                }
+
+                if(conn){
+                    conn->updateActivity();
+                    if(!readFromSocket(fd, conn)){
+                        removeFd(fd);
+                        continue;
+                    }
                 }
                 
                 if(read_handler){
@@ -247,6 +332,11 @@ std::vector<ConnectionPtr> EpollInstance::getAllConnections(){
     return conns;
 }
 
+size_t EpollInstance::getConnectionCount(){
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    return connections.size();
+}
+
 bool EpollInstance::isEpollMember(int fd){
     std::lock_guard<std::mutex> lock(handlers_mutex);
     return epoll_fds.find(fd) != epoll_fds.end();
@@ -1,8 +1,9 @@
 #include "EpollThread.h"
-#include "Epoll.h"
 #include "Logger.h"
+#include <pthread.h>
+#include <sched.h>
 
-EpollThread::EpollThread(EpollInstancePtr epoll) : epoll_instance(epoll) {}
+EpollThread::EpollThread(EventLoopPtr loop, int cpu_id) : event_loop(loop), cpu_id(cpu_id) {}
 
 void EpollThread::start(){
     running.store(true);
@@ -11,8 +12,8 @@ void EpollThread::start(){
 
 void EpollThread::stop(){
     running.store(false);
-    if(epoll_instance){
-        epoll_instance->stop();
+    if(event_loop){
+        event_loop->stop();
     }
 
     if(worker_thread.joinable()){
@@ -20,14 +21,33 @@ void EpollThread::stop(){
     }
 }
 
+void EpollThread::applyAffinity(){
+    if(cpu_id < 0){
+        return;
+    }
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu_id, &cpuset);
+
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+    if(rc != 0){
+        LOG_WARNING_STREAM("[EpollThread] Failed to pin shard " << event_loop->getShardId() << " to CPU " << cpu_id << ": " << strerror(rc));
+        return;
+    }
+    LOG_INFO_STREAM("[EpollThread] Shard " << event_loop->getShardId() << " pinned to CPU " << cpu_id);
+}
+
 void EpollThread::run(){
-    epoll_instance->run();
+    applyAffinity();
+    LOG_INFO_STREAM("[EpollThread] Shard " << event_loop->getShardId() << " running on " << event_loop->getBackendName());
+    event_loop->run();
     
     LOG_INFO_STREAM("[EpollThread] Stopped");
 }
 
-EpollInstancePtr EpollThread::getEpoll(){
-    return epoll_instance;
+EventLoopPtr EpollThread::getEventLoop(){
+    return event_loop;
 }
 
 
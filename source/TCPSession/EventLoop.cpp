@@ -0,0 +1,16 @@
+#include "EventLoop.h"
+#include "Epoll.h"
+#include "IoUring.h"
+#include "Logger.h"
+
+std::shared_ptr<EventLoop> EventLoop::create(EventBackend backend, int shard_id){
+    if(backend == EventBackend::IO_URING){
+        try{
+            return std::make_shared<IoUringInstance>(shard_id);
+        }
+        catch(const std::exception& e){
+            LOG_WARNING_STREAM("[EventLoop] io_uring unavailable for shard " << shard_id << " (" << e.what() << "), falling back to epoll");
+        }
+    }
+    return std::make_shared<EpollInstance>(shard_id);
+}
@@ -0,0 +1,777 @@
+#include "IoUring.h"
+#include "Logger.h"
+#include "UserManager.h"
+#include "PublicChatRoom.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#define URING_BUFFER_GROUP 0
+
+static int uringSetup(unsigned entries, io_uring_params* params){
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int uringEnter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg, size_t arg_size){
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, arg_size));
+}
+
+static int uringRegister(int ring_fd, unsigned opcode, void* arg, unsigned nr_args){
+    return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+static uint64_t retiredKey(int fd, uint32_t generation){
+    return (static_cast<uint64_t>(static_cast<uint32_t>(fd)) << 32) | generation;
+}
+
+IoUringInstance::IoUringInstance(int shard_id)
+    : EventLoop(shard_id),
+      ring_fd(-1),
+      sq_tail_local(0),
+      sq_ring_ptr(MAP_FAILED),
+      sq_ring_size(0),
+      cq_ring_ptr(MAP_FAILED),
+      cq_ring_size(0),
+      sqes_size(0),
+      buf_ring(nullptr),
+      buf_ring_size(0),
+      buf_pool(nullptr),
+      buf_tail(0){
+    try{
+        setupRing();
+        setupBufferRing();
+    }
+    catch(...){
+        teardown();
+        throw;
+    }
+}
+
+IoUringInstance::~IoUringInstance(){
+    stop();
+
+    {
+        std::lock_guard<std::mutex> lock(handlers_mutex);
+        for(auto& pair : fds){
+            pair.second.on_client = nullptr;
+            pair.second.read_cb = nullptr;
+            pair.second.write_cb = nullptr;
+        }
+    }
+
+    // Cancel everything still owned by the kernel and wait briefly for the
+    // completions, so no send buffer or recv buffer is freed under it.
+    {
+        std::lock_guard<std::mutex> sq_lock(sq_mutex);
+        io_uring_sqe* sqe = getSqe();
+        if(sqe){
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY | IORING_ASYNC_CANCEL_ALL;
+            sqe->user_data = encode(Op::CANCEL, 0, -1);
+            submit();
+        }
+    }
+
+    for(int attempt = 0; attempt < 20; attempt++){
+        bool idle = true;
+        {
+            std::lock_guard<std::mutex> lock(handlers_mutex);
+            for(auto& pair : fds){
+                if(pair.second.outstanding > 0) idle = false;
+            }
+            if(!retired.empty()) idle = false;
+        }
+        if(idle) break;
+        reapCompletions(50);
+    }
+
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    for(auto& pair : fds){
+        if(pair.second.conn){
+            pair.second.conn->close();
+        }
+    }
+    fds.clear();
+    retired.clear();
+
+    teardown();
+}
+
+void IoUringInstance::setupRing(){
+    io_uring_params params{};
+    ring_fd = uringSetup(URING_ENTRIES, &params);
+    if(ring_fd < 0){
+        throw std::runtime_error(std::string("io_uring_setup failed: ") + strerror(errno));
+    }
+
+    if(!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP)){
+        throw std::runtime_error("io_uring kernel lacks EXT_ARG/NODROP support");
+    }
+
+    sq_entries = params.sq_entries;
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(single_mmap){
+        sq_ring_size = std::max(sq_ring_size, cq_ring_size);
+        cq_ring_size = sq_ring_size;
+    }
+
+    sq_ring_ptr = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if(sq_ring_ptr == MAP_FAILED){
+        throw std::runtime_error("Failed to map io_uring SQ ring");
+    }
+
+    if(single_mmap){
+        cq_ring_ptr = sq_ring_ptr;
+    }
+    else{
+        cq_ring_ptr = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if(cq_ring_ptr == MAP_FAILED){
+            throw std::runtime_error("Failed to map io_uring CQ ring");
+        }
+    }
+
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes_ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if(sqes_ptr == MAP_FAILED){
+        sqes_size = 0;
+        throw std::runtime_error("Failed to map io_uring SQEs");
+    }
+    sqes = static_cast<io_uring_sqe*>(sqes_ptr);
+
+    char* sq_base = static_cast<char*>(sq_ring_ptr);
+    sq_head = reinterpret_cast<unsigned*>(sq_base + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq_base + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(sq_base + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq_base + params.sq_off.array);
+    sq_tail_local = *sq_tail;
+
+    char* cq_base = static_cast<char*>(cq_ring_ptr);
+    cq_head = reinterpret_cast<unsigned*>(cq_base + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq_base + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq_base + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq_base + params.cq_off.cqes);
+}
+
+void IoUringInstance::setupBufferRing(){
+    buf_ring_size = URING_BUFFER_COUNT * sizeof(io_uring_buf);
+    void* ring_mem = mmap(nullptr, buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(ring_mem == MAP_FAILED){
+        buf_ring_size = 0;
+        throw std::runtime_error("Failed to allocate provided buffer ring");
+    }
+    buf_ring = static_cast<io_uring_buf_ring*>(ring_mem);
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring);
+    reg.ring_entries = URING_BUFFER_COUNT;
+    reg.bgid = URING_BUFFER_GROUP;
+
+    if(uringRegister(ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0){
+        throw std::runtime_error(std::string("Provided buffer rings unsupported: ") + strerror(errno));
+    }
+
+    buf_pool = new char[static_cast<size_t>(URING_BUFFER_COUNT) * BUFFER_SIZE];
+    for(uint16_t bid = 0; bid < URING_BUFFER_COUNT; bid++){
+        recycleBuffer(bid);
+    }
+}
+
+void IoUringInstance::teardown(){
+    if(buf_ring && ring_fd >= 0){
+        io_uring_buf_reg reg{};
+        reg.bgid = URING_BUFFER_GROUP;
+        uringRegister(ring_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    }
+    if(buf_ring){
+        munmap(buf_ring, buf_ring_size);
+        buf_ring = nullptr;
+    }
+    delete[] buf_pool;
+    buf_pool = nullptr;
+
+    if(sqes_size > 0){
+        munmap(sqes, sqes_size);
+        sqes_size = 0;
+    }
+    if(cq_ring_ptr != MAP_FAILED && cq_ring_ptr != sq_ring_ptr){
+        munmap(cq_ring_ptr, cq_ring_size);
+    }
+    cq_ring_ptr = MAP_FAILED;
+    if(sq_ring_ptr != MAP_FAILED){
+        munmap(sq_ring_ptr, sq_ring_size);
+        sq_ring_ptr = MAP_FAILED;
+    }
+    if(ring_fd >= 0){
+        close(ring_fd);
+        ring_fd = -1;
+    }
+}
+
+uint64_t IoUringInstance::encode(Op op, uint32_t generation, int fd){
+    return (static_cast<uint64_t>(op) << 56) |
+           (static_cast<uint64_t>(generation & 0xFFFFFF) << 32) |
+           static_cast<uint32_t>(fd);
+}
+
+// Caller holds sq_mutex
+io_uring_sqe* IoUringInstance::getSqe(){
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if(sq_tail_local - head >= sq_entries){
+        return nullptr;
+    }
+
+    unsigned idx = sq_tail_local & *sq_mask;
+    io_uring_sqe* sqe = &sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array[idx] = idx;
+    sq_tail_local++;
+    return sqe;
+}
+
+// Caller holds sq_mutex
+void IoUringInstance::submit(){
+    __atomic_store_n(sq_tail, sq_tail_local, __ATOMIC_RELEASE);
+
+    unsigned to_submit = sq_tail_local - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    while(to_submit > 0){
+        int ret = uringEnter(ring_fd, to_submit, 0, 0, nullptr, 0);
+        if(ret < 0){
+            if(errno == EINTR) continue;
+            // EAGAIN/EBUSY: entries stay in the ring and go out with the next submit
+            if(errno != EAGAIN && errno != EBUSY){
+                LOG_ERROR_STREAM("io_uring_enter submit failed: " << strerror(errno));
+            }
+            return;
+        }
+        if(ret == 0) return;
+        to_submit -= static_cast<unsigned>(ret);
+    }
+}
+
+// Caller holds handlers_mutex
+void IoUringInstance::armAccept(int fd, FdState& state){
+    std::lock_guard<std::mutex> sq_lock(sq_mutex);
+    io_uring_sqe* sqe = getSqe();
+    if(!sqe){
+        LOG_ERROR_STREAM("io_uring SQ full, cannot arm accept on fd=" << fd);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->accept_flags = SOCK_NONBLOCK;
+    if(multishot_accept.load(std::memory_order_relaxed)){
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    }
+    sqe->user_data = encode(Op::ACCEPT, state.generation, fd);
+    state.outstanding++;
+    submit();
+}
+
+// Caller holds handlers_mutex
+void IoUringInstance::armRecv(int fd, FdState& state){
+    std::lock_guard<std::mutex> sq_lock(sq_mutex);
+    io_uring_sqe* sqe = getSqe();
+    if(!sqe){
+        LOG_ERROR_STREAM("io_uring SQ full, cannot arm recv on fd=" << fd);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    if(multishot_recv.load(std::memory_order_relaxed)){
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+    }
+    else{
+        sqe->len = BUFFER_SIZE;
+    }
+    sqe->user_data = encode(Op::RECV, state.generation, fd);
+    state.outstanding++;
+    submit();
+}
+
+// Caller holds handlers_mutex when the NOP belongs to a registered fd
+void IoUringInstance::postNop(Op op, int fd, uint32_t generation){
+    std::lock_guard<std::mutex> sq_lock(sq_mutex);
+    io_uring_sqe* sqe = getSqe();
+    if(!sqe){
+        LOG_ERROR_STREAM("io_uring SQ full, cannot post event for fd=" << fd);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_NOP;
+    sqe->fd = -1;
+    sqe->user_data = encode(op, generation, fd);
+    submit();
+}
+
+// Only called from the reactor thread (or the constructor)
+void IoUringInstance::recycleBuffer(uint16_t bid){
+    // Index from the ring base: in C++ the uapi flex array member lands at
+    // offset 8 instead of overlaying the tail like the kernel expects
+    io_uring_buf* buf = reinterpret_cast<io_uring_buf*>(buf_ring) + (buf_tail & (URING_BUFFER_COUNT - 1));
+    buf->addr = reinterpret_cast<uint64_t>(buf_pool + static_cast<size_t>(bid) * BUFFER_SIZE);
+    buf->len = BUFFER_SIZE;
+    buf->bid = bid;
+    buf_tail++;
+    __atomic_store_n(&buf_ring->tail, buf_tail, __ATOMIC_RELEASE);
+}
+
+void IoUringInstance::addListener(int listen_fd, Callback on_client){
+    if(should_stop.load(std::memory_order_acquire)){
+        std::cerr << "[WARNING] Attempted to add listener to stopped IoUringInstance" << std::endl;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    FdState& state = fds[listen_fd];
+    state = FdState();
+    state.generation = next_generation++ & 0xFFFFFF;
+    state.listener = true;
+    state.on_client = on_client;
+    armAccept(listen_fd, state);
+}
+
+void IoUringInstance::addFd(int fd, Callback read_cb, ConnectionPtr conn){
+    if(should_stop.load(std::memory_order_acquire)){
+        std::cerr << "[WARNING] Attempted to add fd to stopped IoUringInstance" << std::endl;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    FdState& state = fds[fd];
+    state = FdState();
+    state.generation = next_generation++ & 0xFFFFFF;
+    state.read_cb = read_cb;
+    if(conn){
+        conn->setShard(shard_id);
+        state.conn = conn;
+    }
+    armRecv(fd, state);
+}
+
+void IoUringInstance::removeFd(int fd){
+    ConnectionPtr conn;
+    {
+        std::lock_guard<std::mutex> lock(handlers_mutex);
+        auto it = fds.find(fd);
+        if(it != fds.end()){
+            FdState state = std::move(it->second);
+            fds.erase(it);
+            conn = state.conn;
+
+            if(state.outstanding > 0){
+                std::lock_guard<std::mutex> sq_lock(sq_mutex);
+                io_uring_sqe* sqe = getSqe();
+                if(sqe){
+                    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                    sqe->fd = fd;
+                    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+                    sqe->user_data = encode(Op::CANCEL, state.generation, fd);
+                    state.outstanding++;
+                    submit();
+                }
+
+                state.on_client = nullptr;
+                state.read_cb = nullptr;
+                state.write_cb = nullptr;
+                state.conn.reset();
+                retired[retiredKey(fd, state.generation)] = std::move(state);
+            }
+        }
+    }
+
+    if(conn){
+        conn->getSession().clear();
+    }
+    UserManager::getInstance().logoutUser(fd);
+    PublicChatRoom::getInstance().leave(fd);
+
+    if(conn && !conn->isClosed()){
+        conn->close();
+    }
+    LOG_INFO_STREAM("Client disconnected fd=" << fd);
+}
+
+void IoUringInstance::enableWrite(int fd, Callback write_cb){
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+
+    auto it = fds.find(fd);
+    if(it == fds.end()){
+        LOG_WARNING_STREAM("Attempted to enable write on unknown fd=" << fd);
+        return;
+    }
+
+    FdState& state = it->second;
+    state.write_cb = write_cb;
+
+    // Hand the flush to the reactor thread; it owns the send chains
+    if(!state.flush_queued && !state.send_pending){
+        state.flush_queued = true;
+        state.outstanding++;
+        postNop(Op::FLUSH, fd, state.generation);
+    }
+}
+
+void IoUringInstance::disableWrite(int fd){
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    auto it = fds.find(fd);
+    if(it != fds.end()){
+        it->second.write_cb = nullptr;
+    }
+}
+
+bool IoUringInstance::isWriteEnabled(int fd){
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    auto it = fds.find(fd);
+    return it != fds.end() && it->second.write_cb != nullptr;
+}
+
+void IoUringInstance::flushWrites(int fd){
+    Callback write_cb;
+    ConnectionPtr conn;
+    {
+        std::lock_guard<std::mutex> lock(handlers_mutex);
+        auto it = fds.find(fd);
+        if(it == fds.end()){
+            return;
+        }
+
+        FdState& state = it->second;
+        if(!state.write_cb || state.send_pending){
+            return;
+        }
+        conn = state.conn;
+        write_cb = state.write_cb;
+
+        // With a full SQ the write callback flushes synchronously instead
+        std::lock_guard<std::mutex> sq_lock(sq_mutex);
+        bool sq_space = sq_tail_local - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) < sq_entries;
+        if(!sq_space){
+            LOG_WARNING_STREAM("io_uring SQ full, flushing fd=" << fd << " through the write callback");
+        }
+
+        if(sq_space && conn && !conn->isClosed()){
+            while(state.inflight.size() < IOV_MAX){
+                WriteSegment data = conn->popWriteData();
+                if(data.empty()) break;
+                state.inflight.push_back(std::move(data));
+            }
+
+            if(!state.inflight.empty()){
+                state.inflight_iov.resize(state.inflight.size());
+                for(size_t i = 0; i < state.inflight.size(); i++){
+                    state.inflight_iov[i].iov_base = const_cast<char*>(state.inflight[i].data());
+                    state.inflight_iov[i].iov_len = state.inflight[i].size();
+                }
+                if(!state.inflight_msg){
+                    state.inflight_msg.reset(new msghdr());
+                }
+                *state.inflight_msg = msghdr{};
+                state.inflight_msg->msg_iov = state.inflight_iov.data();
+                state.inflight_msg->msg_iovlen = state.inflight_iov.size();
+
+                io_uring_sqe* sqe = getSqe();
+                sqe->opcode = IORING_OP_SENDMSG;
+                sqe->fd = fd;
+                sqe->addr = reinterpret_cast<uint64_t>(state.inflight_msg.get());
+                sqe->len = 1;
+                // WAITALL: the kernel retries short sends until the whole
+                // batch is out; a signal can still cut it short, which
+                // handleSend catches and requeues
+                sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+                sqe->user_data = encode(Op::SEND, state.generation, fd);
+
+                state.send_pending = true;
+                state.outstanding++;
+                recordWrites(1, state.inflight.size());
+                submit();
+                return;
+            }
+        }
+    }
+
+    // Queue drained (or the connection is gone): let the write callback settle
+    write_cb(fd);
+
+    // Data queued while the callback ran has no readiness event to wait for
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    auto it = fds.find(fd);
+    if(it != fds.end() && it->second.write_cb && !it->second.flush_queued && !it->second.send_pending &&
+       conn && !conn->isClosed() && conn->hasWriteData()){
+        it->second.flush_queued = true;
+        it->second.outstanding++;
+        postNop(Op::FLUSH, fd, it->second.generation);
+    }
+}
+
+void IoUringInstance::handleAccept(int fd, uint32_t generation, const io_uring_cqe& cqe){
+    if(cqe.res >= 0){
+        Callback on_client;
+        {
+            std::lock_guard<std::mutex> lock(handlers_mutex);
+            auto it = fds.find(fd);
+            if(it != fds.end()){
+                on_client = it->second.on_client;
+            }
+        }
+
+        if(on_client){
+            on_client(cqe.res);
+        }
+        else{
+            close(cqe.res);
+        }
+    }
+    else if(cqe.res == -EINVAL && multishot_accept.exchange(false)){
+        LOG_WARNING("[IoUring] Multishot accept unsupported, re-arming single-shot accepts");
+    }
+    else if(cqe.res != -ECANCELED){
+        LOG_ERROR_STREAM("Accept error: " << strerror(-cqe.res));
+    }
+
+    if(!(cqe.flags & IORING_CQE_F_MORE) && !should_stop.load(std::memory_order_acquire)){
+        std::lock_guard<std::mutex> lock(handlers_mutex);
+        auto it = fds.find(fd);
+        if(it != fds.end() && it->second.generation == generation){
+            armAccept(fd, it->second);
+        }
+    }
+}
+
+void IoUringInstance::handleRecv(int fd, uint32_t generation, const io_uring_cqe& cqe){
+    ConnectionPtr conn;
+    Callback read_cb;
+    {
+        std::lock_guard<std::mutex> lock(handlers_mutex);
+        auto it = fds.find(fd);
+        if(it != fds.end()){
+            conn = it->second.conn;
+            read_cb = it->second.read_cb;
+        }
+    }
+
+    if(cqe.res > 0){
+        uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if(conn){
+            conn->updateActivity();
+            conn->appendReadBuffer(buf_pool + static_cast<size_t>(bid) * BUFFER_SIZE, cqe.res);
+        }
+        recycleBuffer(bid);
+        bytes_read.fetch_add(cqe.res, std::memory_order_relaxed);
+
+        if(read_cb){
+            try{
+                read_cb(fd);
+            }
+            catch(const std::exception& e){
+                LOG_ERROR_STREAM("Read handler exception for fd=" << fd << ": " << e.what());
+                removeFd(fd);
+                return;
+            }
+        }
+    }
+    else if(cqe.res == 0){
+        LOG_INFO_STREAM("Client disconnected fd=" << fd);
+        removeFd(fd);
+        return;
+    }
+    else if(cqe.res == -ENOBUFS){
+        LOG_DEBUG_STREAM("[IoUring] Out of provided buffers, re-arming recv on fd=" << fd);
+    }
+    else if(cqe.res == -EINVAL && multishot_recv.exchange(false)){
+        LOG_WARNING("[IoUring] Multishot recv unsupported, re-arming single-shot recvs");
+    }
+    else{
+        LOG_WARNING_STREAM("Recv error on fd=" << fd << ": " << strerror(-cqe.res));
+        removeFd(fd);
+        return;
+    }
+
+    if(!(cqe.flags & IORING_CQE_F_MORE) && !should_stop.load(std::memory_order_acquire)){
+        std::lock_guard<std::mutex> lock(handlers_mutex);
+        auto it = fds.find(fd);
+        if(it != fds.end() && it->second.generation == generation){
+            armRecv(fd, it->second);
+        }
+    }
+}
+
+void IoUringInstance::handleSend(int fd, uint32_t generation, const io_uring_cqe& cqe){
+    {
+        std::lock_guard<std::mutex> lock(handlers_mutex);
+        auto it = fds.find(fd);
+        if(it == fds.end() || it->second.generation != generation){
+            return;
+        }
+
+        FdState& state = it->second;
+        state.send_pending = false;
+
+        // WAITALL still stops early on a signal; the rest goes out first next time
+        size_t requested = 0;
+        for(const WriteSegment& segment : state.inflight){
+            requested += segment.size();
+        }
+        if(cqe.res > 0 && static_cast<size_t>(cqe.res) < requested && state.conn){
+            LOG_DEBUG_STREAM("Short send on fd=" << fd << ": " << cqe.res << " of " << requested << " bytes, requeueing the rest");
+            state.conn->requeueUnsent(state.inflight, static_cast<size_t>(cqe.res));
+        }
+        state.inflight.clear();
+        state.inflight_iov.clear();
+    }
+
+    if(cqe.res <= 0){
+        LOG_DEBUG_STREAM("Connection closed during send (fd=" << fd << "): " << (cqe.res < 0 ? strerror(-cqe.res) : "nothing sent"));
+        removeFd(fd);
+        return;
+    }
+
+    flushWrites(fd);
+}
+
+void IoUringInstance::handleCompletion(const io_uring_cqe& cqe){
+    Op op = static_cast<Op>(cqe.user_data >> 56);
+    uint32_t generation = static_cast<uint32_t>(cqe.user_data >> 32) & 0xFFFFFF;
+    int fd = static_cast<int>(static_cast<uint32_t>(cqe.user_data));
+    bool final_cqe = !(cqe.flags & IORING_CQE_F_MORE);
+
+    if(op == Op::WAKE){
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(handlers_mutex);
+        auto it = fds.find(fd);
+        if(it == fds.end() || it->second.generation != generation){
+            // Completion for an fd that was already removed: release what it holds
+            if(op == Op::RECV && (cqe.flags & IORING_CQE_F_BUFFER)){
+                recycleBuffer(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+            }
+            if(op == Op::ACCEPT && cqe.res >= 0){
+                close(cqe.res);
+            }
+
+            auto rit = retired.find(retiredKey(fd, generation));
+            if(rit != retired.end() && final_cqe && --rit->second.outstanding <= 0){
+                retired.erase(rit);
+            }
+            return;
+        }
+
+        if(final_cqe){
+            it->second.outstanding--;
+        }
+        if(op == Op::FLUSH){
+            it->second.flush_queued = false;
+        }
+    }
+
+    switch(op){
+        case Op::ACCEPT:
+            handleAccept(fd, generation, cqe);
+            break;
+        case Op::RECV:
+            handleRecv(fd, generation, cqe);
+            break;
+        case Op::SEND:
+            handleSend(fd, generation, cqe);
+            break;
+        case Op::FLUSH:
+            flushWrites(fd);
+            break;
+        default:
+            break;
+    }
+}
+
+void IoUringInstance::reapCompletions(int timeout_ms){
+    __kernel_timespec ts{};
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+
+    io_uring_getevents_arg arg{};
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+
+    int ret = uringEnter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    if(ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY){
+        LOG_ERROR_STREAM("io_uring_enter wait failed: " << strerror(errno));
+        return;
+    }
+
+    unsigned head = *cq_head;
+    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    while(head != tail){
+        io_uring_cqe cqe = cqes[head & *cq_mask];
+        head++;
+        // Release the slot before dispatching; callbacks may submit more work
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+        handleCompletion(cqe);
+
+        if(head == tail){
+            tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        }
+    }
+}
+
+ConnectionPtr IoUringInstance::getConnection(int fd){
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    auto it = fds.find(fd);
+    if(it != fds.end()){
+        return it->second.conn;
+    }
+    return nullptr;
+}
+
+void IoUringInstance::run(){
+    while(!should_stop.load(std::memory_order_acquire)){
+        reapCompletions(1000);
+    }
+    LOG_INFO_STREAM("[IoUringInstance] Run loop exited");
+}
+
+void IoUringInstance::stop(){
+    if(should_stop.exchange(true, std::memory_order_acq_rel)){
+        return;
+    }
+    if(ring_fd >= 0){
+        postNop(Op::WAKE, -1, 0);
+    }
+}
+
+bool IoUringInstance::isStopped(){
+    return should_stop.load(std::memory_order_acquire);
+}
+
+std::vector<ConnectionPtr> IoUringInstance::getAllConnections(){
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    std::vector<ConnectionPtr> conns;
+    conns.reserve(fds.size());
+
+    for(const auto& pair : fds){
+        if(pair.second.conn && !pair.second.conn->isClosed()){
+            conns.push_back(pair.second.conn);
+        }
+    }
+    return conns;
+}
+
+size_t IoUringInstance::getConnectionCount(){
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    size_t count = 0;
+    for(const auto& pair : fds){
+        if(pair.second.conn) count++;
+    }
+    return count;
+}
+
+bool IoUringInstance::isEpollMember(int fd){
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    auto it = fds.find(fd);
+    return it != fds.end() && it->second.conn != nullptr;
+}
@@ -0,0 +1,87 @@
+#include "ReactorGroup.h"
+#include "Logger.h"
+
+ReactorGroup::ReactorGroup(size_t shard_count, bool pin_cpus, EventBackend backend){
+    if(shard_count == 0){
+        shard_count = 1;
+    }
+
+    unsigned int cpu_count = std::thread::hardware_concurrency();
+    shards.reserve(shard_count);
+
+    for(size_t i = 0; i < shard_count; i++){
+        int cpu_id = (pin_cpus && cpu_count > 0) ? static_cast<int>(i % cpu_count) : -1;
+        auto loop = EventLoop::create(backend, static_cast<int>(i));
+        shards.push_back(std::make_shared<EpollThread>(loop, cpu_id));
+    }
+
+    LOG_DEBUG_STREAM("[ReactorGroup] Created " << shard_count << " reactor shard(s)" << (pin_cpus ? " with CPU pinning" : ""));
+}
+
+EventLoopPtr ReactorGroup::getShard(size_t index){
+    if(index >= shards.size()){
+        return nullptr;
+    }
+    return shards[index]->getEventLoop();
+}
+
+EventLoopPtr ReactorGroup::getOwner(int fd){
+    for(auto& shard : shards){
+        auto loop = shard->getEventLoop();
+        if(loop->isEpollMember(fd)){
+            return loop;
+        }
+    }
+    return nullptr;
+}
+
+EventLoopPtr ReactorGroup::getOwner(ConnectionPtr conn){
+    if(!conn){
+        return nullptr;
+    }
+    return getShard(static_cast<size_t>(conn->getShard()));
+}
+
+void ReactorGroup::start(){
+    for(auto& shard : shards){
+        shard->start();
+    }
+}
+
+void ReactorGroup::stop(){
+    for(auto& shard : shards){
+        shard->stop();
+    }
+}
+
+bool ReactorGroup::isStopped(){
+    for(auto& shard : shards){
+        if(shard->getEventLoop()->isStopped()){
+            return true;
+        }
+    }
+    return false;
+}
+
+ConnectionPtr ReactorGroup::getConnection(int fd){
+    for(auto& shard : shards){
+        auto conn = shard->getEventLoop()->getConnection(fd);
+        if(conn){
+            return conn;
+        }
+    }
+    return nullptr;
+}
+
+bool ReactorGroup::isEpollMember(int fd){
+    return getOwner(fd) != nullptr;
+}
+
+std::vector<ConnectionPtr> ReactorGroup::getAllConnections(){
+    std::vector<ConnectionPtr> conns;
+    for(auto& shard : shards){
+        auto shard_conns = shard->getEventLoop()->getAllConnections();
+        conns.insert(conns.end(), shard_conns.begin(), shard_conns.end());
+    }
+    return conns;
+}
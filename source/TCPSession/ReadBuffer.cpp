@@ -0,0 +1,121 @@
+#include "ReadBuffer.h"
+#include <cstring>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+static const char* findNewlineSse2(const char* p, const char* end){
+    const __m128i nl = _mm_set1_epi8('\n');
+    for(; p + 16 <= end; p += 16){
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl));
+        if(mask){
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+    }
+    for(; p < end; p++){
+        if(*p == '\n') return p;
+    }
+    return end;
+}
+
+__attribute__((target("avx2")))
+static const char* findNewlineAvx2(const char* p, const char* end){
+    const __m256i nl = _mm256_set1_epi8('\n');
+    for(; p + 32 <= end; p += 32){
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, nl)));
+        if(mask){
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findNewlineSse2(p, end);
+}
+
+const char* ReadBuffer::findNewline(const char* begin, const char* end){
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2 ? findNewlineAvx2(begin, end) : findNewlineSse2(begin, end);
+}
+
+#else
+
+const char* ReadBuffer::findNewline(const char* begin, const char* end){
+    const void* hit = memchr(begin, '\n', end - begin);
+    return hit ? static_cast<const char*>(hit) : end;
+}
+
+#endif
+
+void ReadBuffer::reserve(size_t min_space){
+    size_t used = tail - head;
+
+    // An idle connection gives back the memory a large upload grew it to
+    if(used == 0 && capacity > SHRINK_THRESHOLD){
+        data.reset();
+        capacity = 0;
+    }
+    if(used == 0){
+        head = tail = scanned = 0;
+    }
+
+    if(capacity - tail >= min_space){
+        return;
+    }
+
+    // Compacting is enough when the consumed prefix frees the space
+    if(head > 0 && capacity - used >= min_space){
+        memmove(data.get(), data.get() + head, used);
+        tail = used;
+        head = 0;
+        return;
+    }
+
+    size_t new_capacity = std::max(capacity * 2, std::max(INITIAL_CAPACITY, used + min_space));
+    std::unique_ptr<char[]> grown(new char[new_capacity]);
+    if(used > 0){
+        memcpy(grown.get(), data.get() + head, used);
+    }
+    data = std::move(grown);
+    capacity = new_capacity;
+    tail = used;
+    head = 0;
+}
+
+char* ReadBuffer::prepare(size_t min_space, size_t& available){
+    reserve(min_space);
+    available = capacity - tail;
+    return data.get() + tail;
+}
+
+void ReadBuffer::commit(size_t n){
+    tail = std::min(tail + n, capacity);
+}
+
+void ReadBuffer::append(const char* src, size_t n){
+    if(n == 0) return;
+    reserve(n);
+    memcpy(data.get() + tail, src, n);
+    tail += n;
+}
+
+bool ReadBuffer::nextLine(std::string_view& line){
+    const char* begin = data.get() + head;
+    const char* end = data.get() + tail;
+    const char* pos = findNewline(begin + scanned, end);
+
+    if(pos == end){
+        // Don't rescan a partial line on the next call
+        scanned = tail - head;
+        return false;
+    }
+
+    line = std::string_view(begin, pos - begin);
+    head += (pos - begin) + 1;
+    scanned = 0;
+    return true;
+}
+
+void ReadBuffer::clear(){
+    head = tail = scanned = 0;
+}
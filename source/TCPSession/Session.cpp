@@ -0,0 +1,22 @@
+#include "Session.h"
+#include <mutex>
+#include <unordered_set>
+
+// Bounded by the number of registered users; set nodes never move, so the
+// pointers stay valid
+const std::string* Session::intern(const std::string& name){
+    static std::mutex intern_mutex;
+    static std::unordered_set<std::string> names;
+
+    std::lock_guard<std::mutex> lock(intern_mutex);
+    return &*names.insert(name).first;
+}
+
+const std::string& Session::getUsername() const{
+    static const std::string none;
+    if(!isLoggedIn()){
+        return none;
+    }
+    const std::string* name = username.load(std::memory_order_relaxed);
+    return name ? *name : none;
+}
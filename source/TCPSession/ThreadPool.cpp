@@ -1,73 +1,318 @@
 #include "ThreadPool.h"
+#include "Logger.h"
+#include <algorithm>
+
+// Pool and deque the calling thread works for, if it is a pool worker
+static thread_local ThreadPool* tls_pool = nullptr;
+static thread_local size_t tls_index = 0;
 
 ThreadPool::ThreadPool(size_t n){
+    if(n == 0){
+        n = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    queues.reserve(n);
+    for(size_t i = 0; i < n; i++){
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+
     try{
         workers.reserve(n);
-        
         for(size_t i = 0; i < n; i++){
-            workers.emplace_back([this]{
-                while(true){
-                    std::function<void()> task;
-                    {
-                        std::unique_lock<std::mutex> lock(mtx);
-                        cv.wait(lock, [this]{ return stop.load() || !tasks.empty(); });
-                        
-                        if(stop.load() && tasks.empty()) return;
-                        
-                        if(tasks.empty()) continue;
-                        
-                        task = std::move(tasks.front());
-                        tasks.pop();
-                    }
-                    
-                    if(task){
-                        try{
-                            task();
-                        } 
-                        catch(const std::exception& e){
-                            std::cerr << "[ERROR] Task exception: " << e.what() << std::endl;
-                        }
-                        catch(...){
-                            std::cerr << "[ERROR] Unknown task exception" << std::endl;
-                        }
-                    }
-                }
-            });
+            workers.emplace_back([this, i]{ workerLoop(i); });
         }
+        timer_thread = std::thread([this]{ timerLoop(); });
     }
     catch(...){
-        stop.store(true);
-        cv.notify_all();
-        
-        for(auto& t : workers){
-            if(t.joinable()){
-                t.join();
-            }
-        }
-        
+        stop();
         throw;
     }
 }
 
-void ThreadPool::submit(std::function<void()> task){
+ThreadPool::~ThreadPool(){
+    stop();
+}
+
+void ThreadPool::workerLoop(size_t index){
+    tls_pool = this;
+    tls_index = index;
+
+    Task task;
+    while(true){
+        if(popLocal(index, task) || steal(index, task)){
+            runTask(task);
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(park_mtx);
+        idle.fetch_add(1);
+        park_cv.wait(lock, [this]{ return pending.load() > 0 || stopping.load(); });
+        idle.fetch_sub(1);
+
+        if(stopping.load() && pending.load() == 0){
+            return;
+        }
+    }
+}
+
+void ThreadPool::timerLoop(){
+    std::unique_lock<std::mutex> lock(timer_mtx);
+    while(!stopping.load()){
+        if(timers.empty()){
+            timer_cv.wait(lock);
+            continue;
+        }
+
+        auto deadline = timers.begin()->first.first;
+        if(std::chrono::steady_clock::now() < deadline){
+            timer_cv.wait_until(lock, deadline);
+            continue;
+        }
+
+        Task task = std::move(timers.extract(timers.begin()).mapped());
+        lock.unlock();
+        submit(std::move(task));
+        lock.lock();
+    }
+}
+
+ThreadPool* ThreadPool::current(){
+    return tls_pool;
+}
+
+bool ThreadPool::popLocal(size_t index, Task& task){
+    auto& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mtx);
+    if(queue.tasks.empty()){
+        return false;
+    }
+    task = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    pending.fetch_sub(1);
+    return true;
+}
+
+bool ThreadPool::steal(size_t index, Task& task){
+    for(size_t i = 1; i < queues.size(); i++){
+        auto& victim = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mtx);
+        if(victim.tasks.empty()){
+            continue;
+        }
+        task = std::move(victim.tasks.back());
+        victim.tasks.pop_back();
+        pending.fetch_sub(1);
+        stolen.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::runTask(Task& task){
+    try{
+        task();
+    }
+    catch(const std::exception& e){
+        LOG_ERROR_STREAM("[ThreadPool] Task exception: " << e.what());
+    }
+    catch(...){
+        LOG_ERROR("[ThreadPool] Unknown task exception");
+    }
+    executed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ThreadPool::submit(Task task){
+    bool on_worker = tls_pool == this;
+
+    // Workers may still schedule follow-up work while the pool drains
+    if(stopping.load(std::memory_order_acquire) && !on_worker){
+        LOG_WARNING("[ThreadPool] Attempted to submit task to stopped ThreadPool");
+        return;
+    }
+
+    size_t index = on_worker ? tls_index : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+    // Counted before the push so a parked worker never misses it; a worker
+    // that wakes in between just retries
+    pending.fetch_add(1);
+    {
+        auto& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    if(idle.load() > 0){
+        {
+            std::lock_guard<std::mutex> lock(park_mtx);
+        }
+        park_cv.notify_one();
+    }
+}
+
+ThreadPool::TimerHandle ThreadPool::submitAfter(std::chrono::milliseconds delay, Task task){
+    if(delay.count() <= 0){
+        submit(std::move(task));
+        return TimerHandle{};
+    }
+
+    TimerHandle timer;
+    timer.deadline = std::chrono::steady_clock::now() + delay;
+    bool earliest;
     {
-        std::lock_guard<std::mutex> lock(mtx);
-        if(stop.load()){
-            std::cerr << "[WARNING] Attempted to submit task to stopped ThreadPool" << std::endl;
+        std::lock_guard<std::mutex> lock(timer_mtx);
+        if(stopping.load()){
+            return TimerHandle{};
+        }
+        timer.id = next_timer_id++;
+        auto it = timers.emplace(std::make_pair(timer.deadline, timer.id), std::move(task)).first;
+        earliest = it == timers.begin();
+    }
+    if(earliest){
+        timer_cv.notify_one();
+    }
+    return timer;
+}
+
+bool ThreadPool::cancel(const TimerHandle& timer){
+    if(timer.id == 0){
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(timer_mtx);
+    // The timer thread sleeps until the next deadline; a cancelled head only
+    // makes it wake early once
+    return timers.erase(std::make_pair(timer.deadline, timer.id)) > 0;
+}
+
+ThreadPool::StrandStripe& ThreadPool::stripeOf(uint64_t key){
+    // Keys are usually pointers; mix the bits so neighbours spread out
+    return stripes[(key * 0x9E3779B97F4A7C15ull) >> 58];
+}
+
+void ThreadPool::submitOrdered(uint64_t key, Task task){
+    enqueueStrand(key, StrandTask{std::move(task), nullptr});
+}
+
+void ThreadPool::submitOrderedAsync(uint64_t key, AsyncTask task){
+    enqueueStrand(key, StrandTask{nullptr, std::move(task)});
+}
+
+void ThreadPool::enqueueStrand(uint64_t key, StrandTask entry){
+    if(stopping.load(std::memory_order_acquire) && tls_pool != this){
+        LOG_WARNING("[ThreadPool] Attempted to submit task to stopped ThreadPool");
+        return;
+    }
+
+    auto& stripe = stripeOf(key);
+    std::shared_ptr<Strand> strand;
+    {
+        std::lock_guard<std::mutex> lock(stripe.mtx);
+        auto& slot = stripe.strands[key];
+        if(!slot){
+            slot = std::make_shared<Strand>();
+        }
+        slot->tasks.push_back(std::move(entry));
+        if(slot->scheduled){
             return;
         }
-        tasks.push(std::move(task));
+        slot->scheduled = true;
+        strand = slot;
     }
-    cv.notify_one();
+
+    submit([this, key, strand]{ runStrand(key, strand); });
 }
 
-ThreadPool::~ThreadPool(){
-    stop.store(true, std::memory_order_release);
-    cv.notify_all();
-    
+void ThreadPool::runStrand(uint64_t key, std::shared_ptr<Strand> strand){
+    auto& stripe = stripeOf(key);
+
+    for(size_t n = 0; n < STRAND_BATCH; n++){
+        StrandTask entry;
+        {
+            std::lock_guard<std::mutex> lock(stripe.mtx);
+            strand->in_turn = false;
+            if(strand->suspended){
+                // resumeStrand() schedules the next turn
+                return;
+            }
+            if(strand->tasks.empty()){
+                strand->scheduled = false;
+                auto it = stripe.strands.find(key);
+                if(it != stripe.strands.end() && it->second == strand){
+                    stripe.strands.erase(it);
+                }
+                return;
+            }
+            entry = std::move(strand->tasks.front());
+            strand->tasks.pop_front();
+            strand->in_turn = true;
+            strand->suspended = static_cast<bool>(entry.async_task);
+        }
+
+        try{
+            if(entry.async_task){
+                entry.async_task([this, key, strand]{ resumeStrand(key, strand); });
+            }
+            else{
+                entry.task();
+            }
+        }
+        catch(const std::exception& e){
+            LOG_ERROR_STREAM("[ThreadPool] Task exception: " << e.what());
+        }
+        catch(...){
+            LOG_ERROR("[ThreadPool] Unknown task exception");
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stripe.mtx);
+        strand->in_turn = false;
+        if(strand->suspended){
+            return;
+        }
+    }
+
+    // Give other keys a turn; the strand stays scheduled meanwhile
+    submit([this, key, strand]{ runStrand(key, strand); });
+}
+
+void ThreadPool::resumeStrand(uint64_t key, std::shared_ptr<Strand> strand){
+    bool reschedule;
+    {
+        std::lock_guard<std::mutex> lock(stripeOf(key).mtx);
+        strand->suspended = false;
+        // Resumed from inside its own turn: the running loop carries on
+        reschedule = !strand->in_turn;
+    }
+    if(reschedule){
+        submit([this, key, strand]{ runStrand(key, strand); });
+    }
+}
+
+void ThreadPool::stop(){
+    bool expected = false;
+    if(!stopping.compare_exchange_strong(expected, true, std::memory_order_acq_rel)){
+        return;
+    }
+
+    // Pending timers are dropped
+    {
+        std::lock_guard<std::mutex> lock(timer_mtx);
+        timers.clear();
+    }
+    timer_cv.notify_all();
+    if(timer_thread.joinable()){
+        timer_thread.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(park_mtx);
+    }
+    park_cv.notify_all();
+
     for(auto& t : workers){
         if(t.joinable()){
             t.join();
         }
     }
-}
\ No newline at end of file
+}
@@ -1,12 +1,16 @@
 #include "BaseThreadHandler.h"
+#include "Logger.h"
+#include "QueueAwaitable.h"
 
 BaseThreadHandler::BaseThreadHandler(MessageHandlerPtr message_handler,
-                                     std::shared_ptr<MessageQueue<HandlerRequestPtr>> request_queue,
+                                     ThreadPoolPtr executor,
                                      std::shared_ptr<MessageQueue<HandlerResponsePtr>> response_queue,
-                                     const std::string& handler_name)
+                                     const std::string& handler_name,
+                                     ReactorGroupPtr reactor_group)
     : message_handler(message_handler),
-      request_queue(request_queue),
+      executor(executor),
       response_queue(response_queue),
+      reactor_group(reactor_group),
       handler_name(handler_name) {}
 
 BaseThreadHandler::~BaseThreadHandler(){
@@ -15,7 +19,6 @@ BaseThreadHandler::~BaseThreadHandler(){
 
 void BaseThreadHandler::start(){
     running.store(true);
-    worker_thread = std::thread([this]() { run(); });
 }
 
 void BaseThreadHandler::stop(){
@@ -23,12 +26,53 @@ void BaseThreadHandler::stop(){
     if(!running.compare_exchange_strong(expected, false, std::memory_order_acq_rel)){
         return;
     }
-    
-    if(request_queue){
-        request_queue->stop();
+    LOG_INFO_STREAM("[" << handler_name << "] Stopped");
+}
+
+void BaseThreadHandler::dispatch(HandlerRequestPtr req){
+    if(!req || !req->connection){
+        LOG_WARNING("Received null request or connection");
+        return;
+    }
+    if(!running.load()){
+        return;
     }
-    
-    if(worker_thread.joinable()){
-        worker_thread.join();
+
+    // Keyed by connection so one client's commands never overtake each other
+    uint64_t key = reinterpret_cast<uintptr_t>(req->connection.get());
+    executor->submitOrderedAsync(key, [this, req](ThreadPool::Resume resume){
+        process(req).start(
+            [resume]{ resume(); },
+            [this, resume](std::exception_ptr){
+                LOG_ERROR_STREAM("[" << handler_name << "] Request failed");
+                resume();
+            });
+    });
+}
+
+Task<void> BaseThreadHandler::process(HandlerRequestPtr req){
+    std::string response;
+    try{
+        response = co_await message_handler->handleMessageTask(req->connection, req->command, reactor_group);
     }
-}
\ No newline at end of file
+    catch(const std::exception& e){
+        LOG_ERROR_STREAM("[" << handler_name << "] " << e.what());
+        response = "Error: Internal server error";
+    }
+
+    if(response.empty()){
+        co_return;
+    }
+
+    auto resp = std::make_shared<HandlerResponse>();
+    resp->connection = req->connection;
+    resp->response_message = std::move(response);
+    resp->fd = req->fd;
+    resp->exclude_fd = -1;
+    resp->user_destination = -1;
+    route(*req, *resp);
+
+    if(running.load()){
+        co_await sendTo(response_queue, resp);
+    }
+}
@@ -1,11 +1,112 @@
 #include "TCPServer.h"
+#include "MpscMessageQueue.h"
+#include "SpscMessageQueue.h"
+#include "PendingMessageCompactor.h"
+#include "SqliteOfflineStore.h"
+#include "SegmentedLogStore.h"
 
 // Configuration constants
 namespace Config {
     constexpr int QUEUE_POP_TIMEOUT_MS = 100;
     constexpr int MONITOR_INTERVAL_SEC = 30;
     constexpr size_t QUEUE_WARNING_THRESHOLD = 50;
+    constexpr size_t QUEUE_CAPACITY = 16384;
     constexpr uint16_t SERVER_PORT = 8080;
+    constexpr size_t DEFAULT_REACTOR_COUNT = 1;
+    constexpr size_t EXECUTOR_THREADS = 0;          // 0 = one worker per core
+    constexpr EventBackend DEFAULT_BACKEND = EventBackend::EPOLL;
+    constexpr DurabilityProfile DEFAULT_DURABILITY = DurabilityProfile::BALANCED;
+    constexpr std::chrono::milliseconds ACK_TIMER_RESOLUTION{100};
+    constexpr std::chrono::seconds COMPACTION_INTERVAL{300};
+}
+
+// Startup options, overridable from the command line:
+//   --reactors <N>   number of reactor shards (EventLoop + EpollThread)
+//   --pin-cpus       pin reactor shard i to CPU i % hardware_concurrency
+//   --backend <name> reactor backend: epoll (default) or io_uring
+//   --durability <name>  SQLite profile: strict, balanced (default) or fast
+//   --retain-acked <seconds>   keep acknowledged pending_messages rows (default 3600)
+//   --retain-failed <seconds>  keep failed pending_messages rows (default 604800)
+//   --offline-store <name>     pending message store: sqlite (default) or log
+struct ServerOptions{
+    size_t reactor_count = Config::DEFAULT_REACTOR_COUNT;
+    bool pin_cpus = false;
+    EventBackend backend = Config::DEFAULT_BACKEND;
+    DurabilityProfile durability = Config::DEFAULT_DURABILITY;
+    CompactionConfig compaction;
+    bool offline_log = false;
+};
+
+static void setRetention(CompactionConfig& config, const std::string& status, const char* value){
+    long seconds = std::atol(value);
+    if(seconds < 0){
+        std::cerr << "[WARNING] Negative retention for " << status << " ignored" << std::endl;
+        return;
+    }
+    for(RetentionRule& rule : config.retention){
+        if(rule.status == status){
+            rule.keep = std::chrono::seconds(seconds);
+        }
+    }
+}
+
+static ServerOptions parseOptions(int argc, char* argv[]){
+    ServerOptions options;
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(arg == "--reactors" && i + 1 < argc){
+            int n = std::atoi(argv[++i]);
+            options.reactor_count = n > 0 ? static_cast<size_t>(n) : Config::DEFAULT_REACTOR_COUNT;
+        }
+        else if(arg == "--pin-cpus"){
+            options.pin_cpus = true;
+        }
+        else if(arg == "--backend" && i + 1 < argc){
+            std::string name = argv[++i];
+            if(name == "io_uring"){
+                options.backend = EventBackend::IO_URING;
+            }
+            else if(name == "epoll"){
+                options.backend = EventBackend::EPOLL;
+            }
+            else{
+                std::cerr << "[WARNING] Unknown backend: " << name << ", using epoll" << std::endl;
+            }
+        }
+        else if(arg == "--durability" && i + 1 < argc){
+            std::string name = argv[++i];
+            auto profile = parseDurabilityProfile(name);
+            if(profile.has_value()){
+                options.durability = profile.value();
+            }
+            else{
+                std::cerr << "[WARNING] Unknown durability profile: " << name << ", using "
+                          << durabilityProfileName(Config::DEFAULT_DURABILITY) << std::endl;
+            }
+        }
+        else if(arg == "--retain-acked" && i + 1 < argc){
+            setRetention(options.compaction, "acknowledged", argv[++i]);
+        }
+        else if(arg == "--retain-failed" && i + 1 < argc){
+            setRetention(options.compaction, "failed", argv[++i]);
+        }
+        else if(arg == "--offline-store" && i + 1 < argc){
+            std::string name = argv[++i];
+            if(name == "log"){
+                options.offline_log = true;
+            }
+            else if(name == "sqlite"){
+                options.offline_log = false;
+            }
+            else{
+                std::cerr << "[WARNING] Unknown offline store: " << name << ", using sqlite" << std::endl;
+            }
+        }
+        else{
+            std::cerr << "[WARNING] Unknown option: " << arg << std::endl;
+        }
+    }
+    return options;
 }
 
 std::atomic<bool> g_shutdown_requested{false};
@@ -15,7 +116,10 @@ void signalHandler(int signum){
     g_shutdown_requested.store(true, std::memory_order_release);
 }
 
-int main(){
+int main(int argc, char* argv[]){
+    ServerOptions options = parseOptions(argc, argv);
+    options.compaction.interval = Config::COMPACTION_INTERVAL;
+
     struct sigaction sa;
     sa.sa_handler = signalHandler;
     sigemptyset(&sa.sa_mask);
@@ -41,17 +145,41 @@ int main(){
         // 0. START DATABASE THREAD
         LOG_DEBUG("Starting database thread...");
         auto db_thread = std::make_shared<DataBaseThread>();
+        db_thread->setDurabilityProfile(options.durability);
         db_thread->start();
         LOG_DEBUG("Database thread started");
         
-        // 0. INITIALIZE ACK MANAGER WITH DATABASE
-        LOG_DEBUG("Initializing ACK manager with database...");
+        // 0. OPEN OFFLINE MESSAGE STORE
+        OfflineMessageStorePtr offline_store;
+        SegmentedLogStorePtr offline_log;
+        if(options.offline_log){
+            SegmentedLogConfig log_config;
+            log_config.sync_writes = options.durability == DurabilityProfile::STRICT;
+            offline_log = std::make_shared<SegmentedLogStore>(log_config);
+            if(!offline_log->start()){
+                throw std::runtime_error("Offline message log failed to open");
+            }
+            offline_store = offline_log;
+        }
+        else{
+            offline_store = std::make_shared<SqliteOfflineStore>(db_thread);
+        }
+
+        // 0. INITIALIZE ACK MANAGER WITH OFFLINE STORE
+        LOG_DEBUG("Initializing ACK manager with offline store...");
         auto& ackMgr = MessageAckManager::getInstance();
-        ackMgr.setDatabaseThread(db_thread);
+        ackMgr.setOfflineStore(offline_store);
+        ackMgr.setTimerResolution(Config::ACK_TIMER_RESOLUTION);
         
-        // 0. Load any pending messages from previous session
-        //ackMgr.loadPendingMessagesFromDB();
+        // 0. Recover pending messages from previous session
+        if(!ackMgr.recoverPendingMessages()){
+            throw std::runtime_error("Pending message recovery failed");
+        }
         LOG_DEBUG("ACK manager initialized");
+
+        // 0. START PENDING MESSAGE COMPACTION
+        auto compactor = std::make_shared<PendingMessageCompactor>(db_thread, options.compaction);
+        compactor->start();
         
         // 0. START ACK MANAGER THREAD
         LOG_DEBUG("Starting ACK manager thread...");
@@ -62,21 +190,22 @@ int main(){
         // 1. CREATE CORE COMPONENTS
         LOG_DEBUG("Creating core components...");
         
-        auto epoll_instance = std::make_shared<EpollInstance>();
-        LOG_DEBUG("EpollInstance created");
+        auto reactor_group = std::make_shared<ReactorGroup>(options.reactor_count, options.pin_cpus, options.backend);
+        LOG_DEBUG_STREAM("ReactorGroup created with " << reactor_group->size() << " shard(s)");
         
         // 2. CREATE MESSAGE QUEUES
         LOG_DEBUG("Creating message queues...");
-        auto to_incoming_queue = std::make_shared<MessageQueue<Message>>();
-        auto to_register_queue = std::make_shared<MessageQueue<HandlerRequestPtr>>();
-        auto to_login_queue = std::make_shared<MessageQueue<HandlerRequestPtr>>();
-        auto to_logout_queue = std::make_shared<MessageQueue<HandlerRequestPtr>>();
-        auto to_public_chat_room_queue = std::make_shared<MessageQueue<HandlerRequestPtr>>();
-        auto to_list_users_queue = std::make_shared<MessageQueue<HandlerRequestPtr>>();
-        auto to_join_public_chat_room_queue = std::make_shared<MessageQueue<HandlerRequestPtr>>();
-        auto to_leave_public_chat_room_queue = std::make_shared<MessageQueue<HandlerRequestPtr>>();
-        auto to_private_chat_queue = std::make_shared<MessageQueue<HandlerRequestPtr>>();
-        auto to_response_queue = std::make_shared<MessageQueue<HandlerResponsePtr>>();
+        // Queue variant per edge: the reactor shards feed the router, and
+        // the executor workers plus the router report to the Responser. The
+        // DB and offline store queues stay unbounded; see DataBaseThread.
+        std::shared_ptr<MessageQueue<Message>> to_incoming_queue;
+        if(reactor_group->size() > 1){
+            to_incoming_queue = std::make_shared<MpscMessageQueue<Message>>(Config::QUEUE_CAPACITY);
+        }
+        else{
+            to_incoming_queue = std::make_shared<SpscMessageQueue<Message>>(Config::QUEUE_CAPACITY);
+        }
+        auto to_response_queue = std::make_shared<MpscMessageQueue<HandlerResponsePtr>>(Config::QUEUE_CAPACITY);
         LOG_DEBUG("Message queues created");
         
         // 3. CREATE HANDLERS
@@ -91,34 +220,40 @@ int main(){
         auto private_chat_handler = std::make_shared<PrivateChatHandler>();
         LOG_DEBUG("Handlers created");
 
-        // 4. CREATE HANDLER THREADS
+        // 4. CREATE EXECUTOR AND HANDLER ADAPTERS
+        LOG_DEBUG("Creating executor...");
+        auto executor = std::make_shared<ThreadPool>(Config::EXECUTOR_THREADS);
+        LOG_DEBUG_STREAM("Executor created with " << executor->size() << " worker(s)");
+
         LOG_DEBUG("Creating Threads Handlers...");
-        auto register_thread = std::make_shared<RegisterAccountThreadHandler>(register_handler, to_register_queue, to_response_queue);
-        auto login_thread = std::make_shared<LoginChatThreadHandler>(login_handler, to_login_queue, to_response_queue);
-        auto logout_thread = std::make_shared<LogoutChatThreadHandler>(logout_handler, to_logout_queue, to_response_queue);
-        auto public_chat_room_thread = std::make_shared<PublicChatThreadHandler>(public_chat_room_handler, to_public_chat_room_queue, to_response_queue);
-        auto list_users_thread = std::make_shared<ListUsersThreadHandler>(list_users_handler, to_list_users_queue, to_response_queue, epoll_instance);
-        auto join_public_chat_room_thread = std::make_shared<JoinPublicChatThreadHandler>(join_public_chat_room_handler, to_join_public_chat_room_queue, to_response_queue);
-        auto leave_public_chat_room_thread = std::make_shared<LeavePublicChatThreadHandler>(leave_public_chat_room_handler, to_leave_public_chat_room_queue, to_response_queue);
-        auto private_chat_thread = std::make_shared<PrivateChatThreadHandler>(private_chat_handler, to_private_chat_queue, to_response_queue, epoll_instance);
+        auto register_thread = std::make_shared<RegisterAccountThreadHandler>(register_handler, executor, to_response_queue);
+        auto login_thread = std::make_shared<LoginChatThreadHandler>(login_handler, executor, to_response_queue);
+        auto logout_thread = std::make_shared<LogoutChatThreadHandler>(logout_handler, executor, to_response_queue);
+        auto public_chat_room_thread = std::make_shared<PublicChatThreadHandler>(public_chat_room_handler, executor, to_response_queue);
+        auto list_users_thread = std::make_shared<ListUsersThreadHandler>(list_users_handler, executor, to_response_queue, reactor_group);
+        auto join_public_chat_room_thread = std::make_shared<JoinPublicChatThreadHandler>(join_public_chat_room_handler, executor, to_response_queue);
+        auto leave_public_chat_room_thread = std::make_shared<LeavePublicChatThreadHandler>(leave_public_chat_room_handler, executor, to_response_queue);
+        auto private_chat_thread = std::make_shared<PrivateChatThreadHandler>(private_chat_handler, executor, to_response_queue, reactor_group);
         LOG_DEBUG("Threads Handlers created");
 
         LOG_DEBUG("Creating ChatControllerThread...");
-        auto router = std::make_shared<ChatControllerThread>(to_incoming_queue, to_response_queue, epoll_instance);
-        router->registerHandlerQueue(CommandType::REGISTER, to_register_queue);
-        router->registerHandlerQueue(CommandType::LOGIN, to_login_queue);
-        router->registerHandlerQueue(CommandType::LOGOUT, to_logout_queue);
-        router->registerHandlerQueue(CommandType::PUBLIC_CHAT, to_public_chat_room_queue);
-        router->registerHandlerQueue(CommandType::LIST_ONLINE_USERS, to_list_users_queue);
-        router->registerHandlerQueue(CommandType::JOIN_PUBLIC_CHAT_ROOM, to_join_public_chat_room_queue);
-        router->registerHandlerQueue(CommandType::LEAVE_PUBLIC_CHAT_ROOM, to_leave_public_chat_room_queue);
-        router->registerHandlerQueue(CommandType::LIST_USERS_IN_PUBLIC_CHAT_ROOM, to_public_chat_room_queue);
-        router->registerHandlerQueue(CommandType::PRIVATE_CHAT, to_private_chat_queue);
+        auto router = std::make_shared<ChatControllerThread>(to_incoming_queue, to_response_queue, reactor_group);
+        router->registerHandler(CommandType::REGISTER, register_thread);
+        router->registerHandler(CommandType::LOGIN, login_thread);
+        router->registerHandler(CommandType::LOGOUT, logout_thread);
+        router->registerHandler(CommandType::PUBLIC_CHAT, public_chat_room_thread);
+        router->registerHandler(CommandType::LIST_ONLINE_USERS, list_users_thread);
+        router->registerHandler(CommandType::JOIN_PUBLIC_CHAT_ROOM, join_public_chat_room_thread);
+        router->registerHandler(CommandType::LEAVE_PUBLIC_CHAT_ROOM, leave_public_chat_room_thread);
+        router->registerHandler(CommandType::LIST_USERS_IN_PUBLIC_CHAT_ROOM, public_chat_room_thread);
+        router->registerHandler(CommandType::PRIVATE_CHAT, private_chat_thread);
         LOG_DEBUG("ChatControllerThread created and configured");
         
         // 6. CREATE RESPONSE DISPATCHER
         LOG_DEBUG("Creating response dispatcher...");
-        auto response_dispatcher = std::make_shared<Responser>(to_response_queue, epoll_instance);
+        auto response_dispatcher = std::make_shared<Responser>(to_response_queue, reactor_group);
+        ackMgr.setResponseDispatcher(response_dispatcher);
+        ackMgr.setExecutor(executor);
         LOG_DEBUG("Responser created");
         
         // 7. CREATE TCP SERVER
@@ -128,10 +263,18 @@ int main(){
         addr.sin_addr.s_addr = INADDR_ANY;
         addr.sin_port = htons(Config::SERVER_PORT);
         
-        auto server = std::make_shared<TCPServer>(addr, epoll_instance, to_incoming_queue);
+        // One listener per shard; SO_REUSEPORT lets the kernel balance accepts
+        bool reuse_port = reactor_group->size() > 1;
+        std::vector<TCPServerPtr> servers;
+        for(size_t i = 0; i < reactor_group->size(); i++){
+            servers.push_back(std::make_shared<TCPServer>(addr, reactor_group->getShard(i), to_incoming_queue, reuse_port));
+            servers.back()->setResponser(response_dispatcher);
+        }
 
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        server->startServer();
+        for(auto& server : servers){
+            server->startServer();
+        }
         LOG_DEBUG("TCP Server started successfully");
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
@@ -147,8 +290,7 @@ int main(){
         private_chat_thread->start();
         router->start();        
         response_dispatcher->start();
-        EpollThread epoll_thread(epoll_instance);
-        epoll_thread.start();
+        reactor_group->start();
         LOG_DEBUG("Worker threads started");
         
         LOG_INFO("╔════════════════════════════════════╗");
@@ -158,39 +300,86 @@ int main(){
         
         // 9. MAIN THREAD: MONITORING
         int monitor_count = 0;
-        while(!epoll_instance->isStopped() && !g_shutdown_requested.load()){
+        while(!reactor_group->isStopped() && !g_shutdown_requested.load()){
             std::this_thread::sleep_for(std::chrono::seconds(Config::MONITOR_INTERVAL_SEC));
             
             size_t in_size = to_incoming_queue->size();
-            size_t pub_size = to_join_public_chat_room_queue->size();
+            size_t pending_tasks = executor->getPendingCount();
             size_t resp_size = to_response_queue->size();
             
             LOG_DEBUG_STREAM("[STATS #" << ++monitor_count << "] "
                            << "Incoming:" << in_size << " "
-                           << "Public:" << pub_size << " "
+                           << "Tasks:" << pending_tasks << " "
                            << "Response:" << resp_size);
+            LOG_DEBUG_STREAM("[STATS #" << monitor_count << "] Batch sizes "
+                           << "Incoming{" << to_incoming_queue->formatBatchHistogram() << "} "
+                           << "Response{" << to_response_queue->formatBatchHistogram() << "} "
+                           << "DB{" << db_thread->getBatchHistogram() << "}");
+            LOG_DEBUG_STREAM("[STATS #" << monitor_count << "] Executor "
+                           << "Workers:" << executor->size() << " "
+                           << "Executed:" << executor->getExecutedCount() << " "
+                           << "Stolen:" << executor->getStolenCount());
+            LOG_DEBUG_STREAM("[STATS #" << monitor_count << "] DB "
+                           << "Commits:" << db_thread->getCommitCount() << " "
+                           << "Writes:" << db_thread->getGroupedWriteCount() << " "
+                           << "Reads:" << db_thread->getReadCount() << " on " << db_thread->getReaderCount() << " readers");
+            auto& credentials = db_thread->getCredentialCache();
+            LOG_DEBUG_STREAM("[STATS #" << monitor_count << "] Credential cache "
+                           << "Size:" << credentials.size() << " "
+                           << "Hits:" << credentials.getHitCount() << " "
+                           << "NegativeHits:" << credentials.getNegativeHitCount() << " "
+                           << "Misses:" << credentials.getMissCount() << " "
+                           << "Evictions:" << credentials.getEvictionCount());
+            LOG_DEBUG_STREAM("[STATS #" << monitor_count << "] Compaction "
+                           << "Passes:" << compactor->getPassCount() << " "
+                           << "Deleted:" << compactor->getDeletedRows() << " "
+                           << "Reclaimed pages:" << compactor->getReclaimedPages());
+            if(offline_log){
+                auto log_stats = offline_log->getStats();
+                LOG_DEBUG_STREAM("[STATS #" << monitor_count << "] Offline log "
+                               << "Appended:" << log_stats.appended << " "
+                               << "Completed:" << log_stats.completed << " "
+                               << "Undelivered:" << log_stats.undelivered << " "
+                               << "Segments:" << log_stats.segments << " "
+                               << "Reclaimed:" << log_stats.reclaimed_segments << " "
+                               << "KiB:" << log_stats.disk_bytes / 1024);
+            }
             
             // Warning if queues are getting full
             if(in_size > Config::QUEUE_WARNING_THRESHOLD || 
-               pub_size > Config::QUEUE_WARNING_THRESHOLD || 
+               pending_tasks > Config::QUEUE_WARNING_THRESHOLD || 
                resp_size > Config::QUEUE_WARNING_THRESHOLD){
                 LOG_WARNING_STREAM("High queue usage detected - "
                                  << "In:" << in_size << " "
-                                 << "Pub:" << pub_size << " "
+                                 << "Tasks:" << pending_tasks << " "
                                  << "Resp:" << resp_size);
             }
+
+            for(auto& server : servers){
+                const auto& stats = server->getStats();
+                auto shard = reactor_group->getShard(server->getShardId());
+                LOG_DEBUG_STREAM("[STATS #" << monitor_count << "] Shard " << server->getShardId() << " "
+                               << "Accepted:" << stats.accepted.load(std::memory_order_relaxed) << " "
+                               << "Active:" << shard->getConnectionCount() << " "
+                               << "BytesIn:" << shard->getBytesRead() << " "
+                               << "Writes:" << shard->getWriteCalls() << " "
+                               << "SegPerWrite:" << shard->getSegmentsPerWrite() << " "
+                               << "Messages:" << stats.messages_routed.load(std::memory_order_relaxed));
+            }
         }
         
         // 10. GRACEFUL SHUTDOWN
         LOG_DEBUG("Stopping server...");
         LOG_INFO("Initiating graceful shutdown...");
         
-        server->stopServer();
+        for(auto& server : servers){
+            server->stopServer();
+        }
         LOG_DEBUG("Server stopped");
 
         std::this_thread::sleep_for(std::chrono::milliseconds(1000)); 
 
-        epoll_thread.stop();
+        reactor_group->stop();
         LOG_DEBUG("Epoll stopped");
 
         std::this_thread::sleep_for(std::chrono::milliseconds(1000));
@@ -222,12 +411,23 @@ int main(){
         private_chat_thread->stop();
         LOG_DEBUG("PrivateChatThreadHandler stopped");
 
+        executor->stop();
+        LOG_DEBUG("Executor stopped");
+
         response_dispatcher->stop();
         LOG_DEBUG("Response Dispatcher stopped");
 
         ackMgrThread->stop();
         LOG_DEBUG("ACK manager thread stopped");
 
+        if(offline_log){
+            offline_log->stop();
+            LOG_DEBUG("Offline log stopped");
+        }
+
+        compactor->stop();
+        LOG_DEBUG("Compactor stopped");
+
         db_thread->stop();
         LOG_DEBUG("Database thread stopped");
 